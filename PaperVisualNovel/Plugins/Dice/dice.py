@@ -0,0 +1,73 @@
+# coding=utf-8
+# 常驻工作进程示例：从标准输入读取带长度前缀的 JSON 请求，逐条回复
+# 帧格式：4 字节小端长度 + JSON 文本
+import json
+import os
+import random
+import re
+import struct
+import sys
+
+# 与解释器控制台编码一致
+ENCODING = "gbk" if os.name == "nt" else "utf-8"
+
+
+def read_exact(stream, size):
+    data = b""
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def write_frame(stream, message):
+    payload = json.dumps(message, ensure_ascii=False).encode(ENCODING)
+    stream.write(struct.pack("<I", len(payload)))
+    stream.write(payload)
+    stream.flush()
+
+
+def roll(args):
+    match = re.fullmatch(r"\s*(\d*)[dD](\d+)\s*([+-]\s*\d+)?\s*", args or "1d6")
+    if not match:
+        raise ValueError("expected dice notation like 2d6+1, got: " + args)
+    count = int(match.group(1) or 1)
+    sides = int(match.group(2))
+    bonus = int(match.group(3).replace(" ", "")) if match.group(3) else 0
+    if not (1 <= count <= 100 and 1 <= sides <= 1000):
+        raise ValueError("dice out of range: " + args)
+    rolls = [random.randint(1, sides) for _ in range(count)]
+    total = sum(rolls) + bonus
+    detail = " + ".join(str(r) for r in rolls)
+    if bonus:
+        detail += " %+d" % bonus
+    text = "掷骰 %s: %s = %d" % (args.strip(), detail, total)
+    # 结果同时写入脚本变量，可直接用于 if 判断
+    return text, {"dice": total, "dice_rolls": detail}
+
+
+def main():
+    stdin = sys.stdin.buffer
+    stdout = sys.stdout.buffer
+    while True:
+        header = read_exact(stdin, 4)
+        if header is None:
+            return  # 解释器关闭了管道
+        (size,) = struct.unpack("<I", header)
+        payload = read_exact(stdin, size)
+        if payload is None:
+            return
+        request = json.loads(payload.decode(ENCODING))
+        response = {"id": request.get("id"), "ok": True}
+        try:
+            response["output"], response["vars"] = roll(request.get("args", ""))
+        except ValueError as error:
+            response["ok"] = False
+            response["error"] = str(error)
+        write_frame(stdout, response)
+
+
+if __name__ == "__main__":
+    main()
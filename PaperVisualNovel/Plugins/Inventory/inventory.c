@@ -0,0 +1,93 @@
+/* inventory.c
+ * 原生插件示例：物品栏计数，注册 give / take 两个脚本命令
+ *   give <物品> [数量]   物品数量写入整型变量 item_<物品>
+ *   take <物品> [数量]   数量足够时扣除，变量 item_ok 为 1，否则为 0
+ *   plugin Inventory "<物品>"   把物品数量写入变量 item_count
+ */
+#include "pvn_plugin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const PvnHostApi* host_api = NULL;
+
+/* 解析 "<物品> [数量]"，变量名写入 var_name */
+static int parse_item(const char* args, char* var_name, size_t size, int* amount) {
+    char item[64];
+    *amount = 1;
+    if (sscanf(args, "%63s %d", item, amount) < 1 || *amount < 0) {
+        return -1;
+    }
+    snprintf(var_name, size, "item_%s", item);
+    return 0;
+}
+
+static int give(PvnHost* host, const char* args, void* user_data) {
+    char var_name[80];
+    int amount;
+    (void)user_data;
+    if (parse_item(args, var_name, sizeof(var_name), &amount) != 0) {
+        host_api->fail(host, "usage: give <item> [amount]");
+        return 1;
+    }
+    host_api->setInt(host, var_name, host_api->getInt(host, var_name) + amount);
+    return 0;
+}
+
+static int take(PvnHost* host, const char* args, void* user_data) {
+    char var_name[80];
+    int amount;
+    int owned;
+    (void)user_data;
+    if (parse_item(args, var_name, sizeof(var_name), &amount) != 0) {
+        host_api->fail(host, "usage: take <item> [amount]");
+        return 1;
+    }
+    owned = host_api->getInt(host, var_name);
+    if (owned < amount) {
+        host_api->setInt(host, "item_ok", 0);
+        return 0;
+    }
+    host_api->setInt(host, var_name, owned - amount);
+    host_api->setInt(host, "item_ok", 1);
+    return 0;
+}
+
+static int init(PvnHost* host) {
+    if (host_api->registerCommand(host, "give", give, NULL) != 0 ||
+        host_api->registerCommand(host, "take", take, NULL) != 0) {
+        host_api->fail(host, "cannot register give / take");
+        return 1;
+    }
+    return 0;
+}
+
+static int run(PvnHost* host, const char* args) {
+    char var_name[80];
+    int amount;
+    if (parse_item(args, var_name, sizeof(var_name), &amount) != 0) {
+        host_api->fail(host, "usage: plugin Inventory \"<item>\"");
+        return 1;
+    }
+    host_api->setInt(host, "item_count", host_api->getInt(host, var_name));
+    return 0;
+}
+
+static const PvnPlugin plugin = {
+    PVN_PLUGIN_API_VERSION,
+    sizeof(PvnPlugin),
+    "Inventory",
+    "1.0.0",
+    init,
+    run,
+    NULL
+};
+
+PVN_PLUGIN_EXPORT const PvnPlugin* pvn_plugin_entry(const PvnHostApi* api) {
+    /* 解释器的函数表比本插件编译时的版本旧时不加载 */
+    if (api->apiVersion < PVN_PLUGIN_API_VERSION || api->size < sizeof(PvnHostApi)) {
+        return NULL;
+    }
+    host_api = api;
+    return &plugin;
+}
@@ -0,0 +1,90 @@
+﻿// autosave.cpp
+#include "autosave.h"
+#include "config.h"
+#include "fileutils.h"
+#include "ui.h"
+
+namespace {
+    int readIntCfg(const std::string& key, int defaultValue) {
+        return std::max(0, ConfigStore::instance().getInt(key, defaultValue));
+    }
+
+    std::string slotName(int slot) {
+        return "autosave_" + std::to_string(slot);
+    }
+
+    // 执行前需要保存的命令：选择和可能改变游戏状态的插件调用
+    bool savesBefore(OpCode op) {
+        return op == OpCode::CHOOSE || op == OpCode::PLUGIN ||
+            op == OpCode::PLUGIN_ASYNC || op == OpCode::NATIVE_COMMAND;
+    }
+}
+
+AutosaveOptions loadAutosaveOptions() {
+    AutosaveOptions options;
+    options.everyLines = static_cast<size_t>(readIntCfg("AutosaveLines", static_cast<int>(options.everyLines)));
+    options.everySeconds = readIntCfg("AutosaveSeconds", options.everySeconds);
+    options.slots = readIntCfg("AutosaveSlots", options.slots);
+    return options;
+}
+
+AutosaveScheduler::AutosaveScheduler(const std::string& scriptPath, const AutosaveOptions& options)
+    : scriptPath(scriptPath), options(options), lastSave(std::chrono::steady_clock::now()) {
+    if (options.slots <= 0) {
+        return;
+    }
+
+    // 从空槽位或最旧的槽位开始轮换，保留上一次游戏最近的几个自动存档
+    fs::path saveDir = fs::path(scriptPath).parent_path() / "saves";
+    fs::file_time_type oldest = fs::file_time_type::max();
+    for (int slot = 1; slot <= options.slots; slot++) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(saveDir / (slotName(slot) + ".sav"), ec);
+        if (ec) {
+            nextSlot = slot;
+            break;
+        }
+        if (mtime < oldest) {
+            oldest = mtime;
+            nextSlot = slot;
+        }
+    }
+}
+
+void AutosaveScheduler::beforeInstruction(const Instruction& instruction, size_t currentLine, const GameState& gameState) {
+    if (options.slots <= 0) {
+        return;
+    }
+
+    // 刚保存过（没有执行新的行）或上一次自动存档还在写入时不保存
+    if (linesSinceSave > 0 && !writing->load()) {
+        if (options.beforeChoice && savesBefore(instruction.op)) {
+            snapshot(currentLine, gameState, instruction.op == OpCode::CHOOSE ? "choose" : "plugin");
+            return;
+        }
+        if (options.everyLines > 0 && linesSinceSave >= options.everyLines) {
+            snapshot(currentLine, gameState, "lines");
+            return;
+        }
+        if (options.everySeconds > 0 &&
+            std::chrono::steady_clock::now() - lastSave >= std::chrono::seconds(options.everySeconds)) {
+            snapshot(currentLine, gameState, "timer");
+            return;
+        }
+    }
+
+    linesSinceSave++;
+}
+
+void AutosaveScheduler::snapshot(size_t currentLine, const GameState& gameState, const char* reason) {
+    // 保存的是即将执行的行，读档后从该行继续
+    writing->store(true);
+    saveGame(scriptPath, currentLine, gameState, slotName(nextSlot), [writing = writing](bool) {
+        writing->store(false);
+    });
+    LOG_DEBUG(LogCode::GAME_SAVED, "Autosave (", reason, ") to slot ", nextSlot, " at line ", currentLine + 1);
+
+    nextSlot = nextSlot % options.slots + 1;
+    linesSinceSave = 1;
+    lastSave = std::chrono::steady_clock::now();
+}
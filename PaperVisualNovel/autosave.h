@@ -0,0 +1,56 @@
+﻿// autosave.h
+#pragma once
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include "compiler.h"
+#include "gamestate.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+/**
+ * @brief 自动存档设置（data.cfg）
+ *
+ * AutosaveLines   每执行多少行保存一次，0 表示不按行数保存
+ * AutosaveSeconds 每隔多少秒保存一次，0 表示不按时间保存
+ * AutosaveSlots   轮换使用的存档槽位数（autosave_1 ... autosave_M），0 表示关闭自动存档
+ */
+struct AutosaveOptions {
+    size_t everyLines = 500;
+    int everySeconds = 60;
+    bool beforeChoice = true;   // 在 choose / 插件命令之前保存
+    int slots = 3;
+};
+
+/**
+ * @brief 从 data.cfg 读取自动存档设置，未配置的项使用默认值
+ */
+AutosaveOptions loadAutosaveOptions();
+
+/**
+ * @brief 解释器循环中的自动存档调度
+ *
+ * 每条指令执行前调用 beforeInstruction，满足行数、时间或命令条件时
+ * 复制一份游戏状态交给后台写入线程，执行线程不等待写盘；
+ * 上一次自动存档还没写完时跳过本次，写入跟不上时不会堆积存档任务
+ */
+class AutosaveScheduler {
+public:
+    AutosaveScheduler(const std::string& scriptPath, const AutosaveOptions& options);
+
+    void beforeInstruction(const Instruction& instruction, size_t currentLine, const GameState& gameState);
+
+private:
+    void snapshot(size_t currentLine, const GameState& gameState, const char* reason);
+
+    std::string scriptPath;
+    AutosaveOptions options;
+    size_t linesSinceSave = 0;
+    std::chrono::steady_clock::time_point lastSave;
+    int nextSlot = 1;
+    std::shared_ptr<std::atomic<bool>> writing = std::make_shared<std::atomic<bool>>(false);
+};
+
+#endif // AUTOSAVE_H
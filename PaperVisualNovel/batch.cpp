@@ -0,0 +1,353 @@
+﻿// batch.cpp
+#include "batch.h"
+#include "compiler.h"
+#include "fileutils.h"
+#include "platform.h"
+#include "ui.h"
+#include "pluginhost.h"
+#include "nativeplugin.h"
+#include "scriptindex.h"
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <set>
+
+namespace {
+    /**
+     * @brief 丢弃所有输出的缓冲区
+     */
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    /**
+     * @brief 批处理平台：不等待、不输出，选择与输入来自预设文件或随机策略
+     */
+    class BatchPlatform : public Platform {
+    public:
+        explicit BatchPlatform(std::vector<std::string> inputs)
+            : host(createDefaultPlatform()), inputs(std::move(inputs)) {
+        }
+
+        void beginRun(unsigned int seed) {
+            rng.seed(seed);
+            cursor = 0;
+        }
+
+        size_t messageCount() const { return messages; }
+
+        void write(const std::string&) override {}
+        void clearScreen() override {}
+        void setTitle(const std::string&) override {}
+        void waitForKey() override {}
+        void sleepMs(int) override {}
+
+        std::string readKey() override {
+            return "ENTER";
+        }
+
+        // 文字动画立即完成
+        std::string readKeyTimeout(int) override {
+            return "ENTER";
+        }
+
+        bool readLine(std::string& line) override {
+            line = cursor < inputs.size() ? inputs[cursor++] : "";
+            return true;
+        }
+
+        int chooseOption(size_t optionCount) override {
+            if (optionCount == 0) {
+                return -1;
+            }
+
+            if (cursor < inputs.size()) {
+                const std::string& preset = inputs[cursor++];
+                try {
+                    int choice = std::stoi(preset);
+                    if (choice >= 1 && choice <= static_cast<int>(optionCount)) {
+                        return choice;
+                    }
+                }
+                catch (const std::exception&) {
+                }
+                Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                    "Batch preset choice \"" + preset + "\" is invalid, using random choice");
+            }
+
+            std::uniform_int_distribution<int> dist(1, static_cast<int>(optionCount));
+            return dist(rng);
+        }
+
+        void showMessage(const std::string& text, const std::string& title, MessageLevel level) override {
+            // 多次运行中相同的提示只显示一次
+            messages++;
+            if (shownMessages.insert(text).second) {
+                host->showMessage(text, title, level);
+            }
+        }
+
+        bool openFile(const std::string&, std::string&) override {
+            return true;
+        }
+
+        std::string decodeText(std::string raw) override {
+            return host->decodeText(std::move(raw));
+        }
+
+    private:
+        std::unique_ptr<Platform> host;     // 用于编码转换和错误提示
+        std::vector<std::string> inputs;
+        size_t cursor = 0;
+        std::mt19937 rng;
+        size_t messages = 0;
+        std::set<std::string> shownMessages;
+    };
+
+    /**
+     * @brief 读取预设输入文件（忽略以 # 开头的注释行）
+     */
+    bool readInputs(const std::string& path, std::vector<std::string>& inputs) {
+        ScriptSource source;
+        if (!source.load(path)) {
+            return false;
+        }
+        for (std::string_view line : source.lines()) {
+            if (!line.empty() && line[0] == '#') {
+                continue;
+            }
+            inputs.push_back(trim(std::string(line)));
+        }
+        return true;
+    }
+
+    BatchRunResult runOnce(const CompiledScript& script, const std::vector<std::string_view>& lines,
+        const std::string& scriptPath, size_t maxSteps) {
+        BatchRunResult result;
+        GameState gameState;
+
+        g_currentGameInfo = { scriptPath, 0, &gameState };
+
+        auto runStart = std::chrono::high_resolution_clock::now();
+        size_t currentLine = 0;
+
+        while (currentLine < lines.size()) {
+            if (result.executedLines >= maxSteps) {
+                result.stepLimitHit = true;
+                break;
+            }
+            result.executedLines++;
+            g_currentGameInfo.currentLine = currentLine;
+
+            const Instruction& instruction = script.code[currentLine];
+
+            // 批处理不写入结局记录文件，只记录达成的结局
+            if (instruction.op == OpCode::ENDNAME) {
+                if (!instruction.name.empty()) {
+                    result.ending = instruction.name;
+                }
+                currentLine++;
+                continue;
+            }
+
+            auto [status, nextLine] = executeInstruction(instruction, lines[currentLine],
+                gameState, currentLine);
+            if (status == -1 || status == -2) {
+                break;
+            }
+            currentLine = nextLine;
+        }
+
+        auto runEnd = std::chrono::high_resolution_clock::now();
+        result.elapsedMs = std::chrono::duration<double, std::milli>(runEnd - runStart).count();
+        result.choices = gameState.getChoiceHistory();
+
+        g_currentGameInfo = { "", 0, nullptr };
+        PluginTasks::instance().discardAll();
+        return result;
+    }
+
+    void printRun(int index, const BatchRunResult& result) {
+        std::cout << "运行 " << index + 1 << ": ";
+        if (result.stepLimitHit) {
+            std::cout << "超过步数上限";
+        }
+        else if (result.ending.empty()) {
+            std::cout << "未达成结局";
+        }
+        else {
+            std::cout << "结局 " << result.ending;
+        }
+        std::cout << "  行数 " << result.executedLines
+            << "  选择 " << result.choices.size() << " 次";
+
+        if (!result.choices.empty()) {
+            std::cout << ": ";
+            for (size_t i = 0; i < result.choices.size(); i++) {
+                if (i > 0) std::cout << " > ";
+                std::cout << result.choices[i];
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+// ==================== 命令行参数 ====================
+
+bool parseBatchArgs(int argc, char* argv[], BatchOptions& options, std::string& error) {
+    // argv[1] 为 --batch
+    if (argc < 3) {
+        error = "用法: --batch <脚本.pgn> [--inputs <文件>] [--seed <n>] [--runs <n>] [--max-steps <n>]";
+        return false;
+    }
+    options.scriptPath = argv[2];
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            error = "参数缺少取值: " + arg;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try {
+            if (arg == "--inputs") {
+                options.inputsPath = value;
+            }
+            else if (arg == "--seed") {
+                options.seed = static_cast<unsigned int>(std::stoul(value));
+                options.hasSeed = true;
+            }
+            else if (arg == "--runs") {
+                options.runs = std::stoi(value);
+                if (options.runs < 1) {
+                    error = "运行次数必须为正数";
+                    return false;
+                }
+            }
+            else if (arg == "--max-steps") {
+                options.maxSteps = static_cast<size_t>(std::stoull(value));
+            }
+            else {
+                error = "未知参数: " + arg;
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            error = "无效的参数值: " + arg + " " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ==================== 批处理运行 ====================
+
+int runBatch(const BatchOptions& options) {
+    Log(LogGrade::INFO, LogCode::GAME_START, "Batch run: " + options.scriptPath);
+
+    std::vector<std::string> inputs;
+    if (!options.inputsPath.empty() && !readInputs(options.inputsPath, inputs)) {
+        std::cerr << "错误：无法读取输入文件 " << options.inputsPath << std::endl;
+        return 2;
+    }
+
+    auto batchPlatform = std::make_unique<BatchPlatform>(std::move(inputs));
+    BatchPlatform& batch = *batchPlatform;
+    setPlatform(std::move(batchPlatform));
+
+    ScriptSource source;
+    if (!source.load(options.scriptPath)) {
+        std::cerr << "错误：无法打开脚本文件 " << options.scriptPath << std::endl;
+        return 2;
+    }
+
+    fs::path scriptFile(options.scriptPath);
+    std::string where = scriptFile.parent_path().string();
+    if (!where.empty()) {
+        where += PVN_PATH_SEP;
+    }
+
+    const std::vector<std::string_view>& lines = source.lines();
+    ScriptIndex index = buildScriptIndex(lines);
+    NativePlugins::instance().loadDependencies(index.plugins);
+    CompiledScript script = compileScript(lines, index, where);
+
+    unsigned int seed = options.hasSeed ? options.seed : static_cast<unsigned int>(time(nullptr));
+    std::vector<BatchRunResult> results;
+    results.reserve(options.runs);
+
+    // 运行期间丢弃脚本输出
+    NullBuffer nullBuffer;
+    std::streambuf* originalBuffer = std::cout.rdbuf(&nullBuffer);
+
+    auto batchStart = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < options.runs; i++) {
+        unsigned int runSeed = seed + static_cast<unsigned int>(i);
+        batch.beginRun(runSeed);
+        srand(runSeed);
+        results.push_back(runOnce(script, lines, options.scriptPath, options.maxSteps));
+    }
+    auto batchEnd = std::chrono::high_resolution_clock::now();
+
+    std::cout.rdbuf(originalBuffer);
+
+    // ==================== 统计报告 ====================
+
+    double totalMs = std::chrono::duration<double, std::milli>(batchEnd - batchStart).count();
+    size_t totalLines = 0;
+    size_t totalChoices = 0;
+    int unfinished = 0;
+    std::map<std::string, int> endingCounts;
+
+    for (const auto& result : results) {
+        totalLines += result.executedLines;
+        totalChoices += result.choices.size();
+        if (result.stepLimitHit) {
+            unfinished++;
+        }
+        endingCounts[result.ending]++;
+    }
+
+    double seconds = totalMs / 1000.0;
+    std::cout << "==============================" << std::endl;
+    std::cout << "批处理运行: " << options.scriptPath << std::endl;
+    std::cout << "运行次数: " << options.runs << "  随机种子: " << seed << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    // 运行次数较少时逐次列出
+    if (options.runs <= 20) {
+        for (size_t i = 0; i < results.size(); i++) {
+            printRun(static_cast<int>(i), results[i]);
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "结局分布:" << std::endl;
+    for (const auto& [ending, count] : endingCounts) {
+        std::cout << "  " << (ending.empty() ? "(未达成结局)" : ending) << ": " << count << std::endl;
+    }
+    std::cout << std::endl;
+
+    std::cout << "执行行数: " << totalLines << std::endl;
+    std::cout << "选择次数: " << totalChoices << std::endl;
+    std::cout << "总用时: " << static_cast<long long>(totalMs) << "ms" << std::endl;
+    if (seconds > 0) {
+        std::cout << "速度: " << static_cast<long long>(totalLines / seconds) << " 行/秒, "
+            << static_cast<long long>(options.runs / seconds * 60) << " 次/分钟" << std::endl;
+    }
+    if (batch.messageCount() > 0) {
+        std::cout << "错误提示: " << batch.messageCount() << " 次" << std::endl;
+    }
+    if (unfinished > 0) {
+        std::cout << "超过步数上限: " << unfinished << " 次" << std::endl;
+    }
+
+    Log(LogGrade::INFO, LogCode::GAME_START,
+        "Batch finished: " + std::to_string(options.runs) + " runs, " +
+        std::to_string(totalLines) + " lines in " + std::to_string(static_cast<long long>(totalMs)) + "ms");
+
+    return unfinished > 0 ? 1 : 0;
+}
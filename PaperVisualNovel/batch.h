@@ -0,0 +1,46 @@
+﻿// batch.h
+#pragma once
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief 批处理运行参数
+ *
+ * 命令行格式：--batch <脚本.pgn> [--inputs <文件>] [--seed <n>] [--runs <n>] [--max-steps <n>]
+ */
+struct BatchOptions {
+    std::string scriptPath;         // 要运行的脚本
+    std::string inputsPath;         // 预设输入文件（可选），每行依次供 choose / input 使用
+    unsigned int seed = 0;          // 随机种子（choose 随机策略与 random 命令）
+    bool hasSeed = false;           // 未指定时使用当前时间
+    int runs = 1;                   // 运行次数，第 i 次使用 seed + i
+    size_t maxSteps = 1000000;      // 单次运行最多执行的行数（防止死循环）
+};
+
+/**
+ * @brief 单次批处理运行的结果
+ */
+struct BatchRunResult {
+    size_t executedLines = 0;               // 执行的行数
+    std::vector<std::string> choices;       // 依次做出的选择
+    std::string ending;                     // 达成的结局（为空表示未达成）
+    bool stepLimitHit = false;              // 是否因超过步数上限而中止
+    double elapsedMs = 0;                   // 用时
+};
+
+/**
+ * @brief 解析 --batch 之后的命令行参数
+ * @param error 解析失败时的错误描述
+ */
+bool parseBatchArgs(int argc, char* argv[], BatchOptions& options, std::string& error);
+
+/**
+ * @brief 以无人值守方式运行脚本并输出统计报告
+ * @return 0 表示所有运行均正常结束
+ */
+int runBatch(const BatchOptions& options);
+
+#endif // BATCH_H
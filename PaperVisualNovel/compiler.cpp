@@ -0,0 +1,1008 @@
+﻿// compiler.cpp
+#include "compiler.h"
+#include "fileutils.h"
+#include "platform.h"
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+// ==================== 辅助函数 ====================
+
+static bool parseColorName(const std::string& name, color& out) {
+    if (name == "black") out = black;
+    else if (name == "blue") out = blue;
+    else if (name == "green") out = green;
+    else if (name == "aqua") out = aqua;
+    else if (name == "red") out = red;
+    else if (name == "purple") out = purple;
+    else if (name == "yellow") out = yellow;
+    else if (name == "white") out = white;
+    else return false;
+    return true;
+}
+
+static int resolveJump(const std::string& target, const std::map<std::string, int>& labels,
+    size_t lineCount) {
+    bool isLabel;
+    int jumpLine = parseJumpTarget(target, labels, isLabel);
+    if (jumpLine > 0 && jumpLine <= static_cast<int>(lineCount)) {
+        return jumpLine;
+    }
+    return -1;
+}
+
+static void appendLiteral(std::vector<TextSegment>& segments, const std::string& text) {
+    if (text.empty()) return;
+    if (!segments.empty() && !segments.back().isVar) {
+        segments.back().text += text;
+        return;
+    }
+    segments.push_back({ text, false });
+}
+
+static Instruction makeError(const std::string& cmd, const ScriptError& error) {
+    Instruction instruction;
+    instruction.op = OpCode::ERR;
+    instruction.cmd = cmd;
+    instruction.error = error;
+    return instruction;
+}
+
+/**
+ * @brief 拆分 say 文本中的 ${var} 引用
+ */
+static std::vector<TextSegment> splitSayText(const std::string& text) {
+    std::vector<TextSegment> segments;
+    size_t pos = 0;
+
+    while (pos < text.length()) {
+        size_t var_start = text.find("${", pos);
+
+        if (var_start == std::string::npos) {
+            appendLiteral(segments, text.substr(pos));
+            break;
+        }
+
+        appendLiteral(segments, text.substr(pos, var_start - pos));
+        size_t var_end = text.find("}", var_start);
+        if (var_end == std::string::npos) {
+            appendLiteral(segments, text.substr(var_start));
+            break;
+        }
+
+        std::string varName = text.substr(var_start + 2, var_end - var_start - 2);
+        segments.push_back({ varName, true, VariableTable::instance().intern(varName) });
+        pos = var_end + 1;
+    }
+
+    return segments;
+}
+
+std::vector<TextSegment> splitPluginArgs(const std::string& runArgs, const std::string& where) {
+    std::vector<TextSegment> segments;
+    std::string literal = "";
+    size_t pos = 0;
+    bool inEscape = false;
+
+    while (pos < runArgs.length()) {
+        if (inEscape) {
+            literal += runArgs[pos];
+            inEscape = false;
+            pos++;
+            continue;
+        }
+
+        if (runArgs[pos] == '\\') {
+            if (pos + 1 < runArgs.length()) {
+                char nextChar = runArgs[pos + 1];
+                if (nextChar == '$' || nextChar == '{' || nextChar == '}') {
+                    literal += nextChar;
+                    pos += 2;
+                }
+                else {
+                    literal += runArgs[pos];
+                    inEscape = true;
+                    pos++;
+                }
+            }
+            else {
+                literal += runArgs[pos];
+                pos++;
+            }
+        }
+        else if (pos < runArgs.length() - 5 && runArgs.substr(pos, 6) == "$file{") {
+            size_t braceStart = pos + 5;
+            size_t braceEnd = std::string::npos;
+            int braceDepth = 1;
+
+            for (size_t i = braceStart + 1; i < runArgs.length(); i++) {
+                if (runArgs[i] == '\\') {
+                    i++;
+                    continue;
+                }
+
+                if (runArgs[i] == '{') {
+                    braceDepth++;
+                }
+                else if (runArgs[i] == '}') {
+                    braceDepth--;
+                    if (braceDepth == 0) {
+                        braceEnd = i;
+                        break;
+                    }
+                }
+            }
+
+            if (braceEnd != std::string::npos) {
+                std::string rawPath = runArgs.substr(braceStart + 1, braceEnd - braceStart - 1);
+                std::string relativePath = "";
+
+                for (size_t i = 0; i < rawPath.length(); i++) {
+                    if (rawPath[i] == '\\' && i + 1 < rawPath.length()) {
+                        if (rawPath[i + 1] == '\\' || rawPath[i + 1] == '{' || rawPath[i + 1] == '}') {
+                            relativePath += rawPath[i + 1];
+                            i++;
+                        }
+                        else {
+                            relativePath += rawPath[i];
+                        }
+                    }
+                    else {
+                        relativePath += rawPath[i];
+                    }
+                }
+
+                std::string absolutePath;
+                if (!where.empty()) {
+                    absolutePath = where + relativePath;
+
+                    // 统一为当前系统的路径分隔符
+                    std::replace(absolutePath.begin(), absolutePath.end(),
+                        PVN_PATH_SEP_CHAR == '/' ? '\\' : '/', PVN_PATH_SEP_CHAR);
+
+                    size_t dotDotPos;
+                    while ((dotDotPos = absolutePath.find(PVN_PATH_SEP ".." PVN_PATH_SEP)) != std::string::npos) {
+                        size_t prevSlash = absolutePath.rfind(PVN_PATH_SEP_CHAR, dotDotPos - 1);
+                        if (prevSlash != std::string::npos) {
+                            absolutePath = absolutePath.substr(0, prevSlash) +
+                                absolutePath.substr(dotDotPos + 3);
+                        }
+                        else {
+                            break;
+                        }
+                    }
+
+                    LOG_DEBUG(LogCode::PLUGIN_LOADED,
+                        "Converted $file{", rawPath, "} to: ", absolutePath);
+                    literal += absolutePath;
+                }
+                else {
+                    Log(LogGrade::WARNING, LogCode::PLUGIN_LOADED,
+                        "Cannot convert $file{} path: 'where' path is empty");
+                    literal += relativePath;
+                }
+
+                pos = braceEnd + 1;
+            }
+            else {
+                literal += runArgs.substr(pos, 6);
+                pos += 6;
+            }
+        }
+        else if (pos < runArgs.length() - 3 && runArgs.substr(pos, 4) == "$log") {
+            std::error_code ec;
+            fs::path currentDir = fs::current_path(ec);
+            if (!ec) {
+                std::string logPath = currentDir.string() + PVN_PATH_SEP "pvn_engine.log";
+                LOG_DEBUG(LogCode::PLUGIN_LOADED, "Converted $log to: ", logPath);
+                literal += logPath;
+            }
+            else {
+                Log(LogGrade::WARNING, LogCode::PLUGIN_LOADED,
+                    "Failed to get current directory for $log conversion");
+                literal += "pvn_engine.log";
+            }
+
+            pos += 4;
+        }
+        else if (pos < runArgs.length() - 2 && runArgs.substr(pos, 2) == "${") {
+            size_t varEnd = std::string::npos;
+            int braceDepth = 1;
+
+            for (size_t i = pos + 2; i < runArgs.length(); i++) {
+                if (runArgs[i] == '\\') {
+                    i++;
+                    continue;
+                }
+
+                if (runArgs[i] == '{') {
+                    braceDepth++;
+                }
+                else if (runArgs[i] == '}') {
+                    braceDepth--;
+                    if (braceDepth == 0) {
+                        varEnd = i;
+                        break;
+                    }
+                }
+            }
+
+            if (varEnd != std::string::npos) {
+                appendLiteral(segments, literal);
+                literal.clear();
+                std::string varName = runArgs.substr(pos + 2, varEnd - pos - 2);
+                segments.push_back({ varName, true, VariableTable::instance().intern(varName) });
+                pos = varEnd + 1;
+            }
+            else {
+                literal += runArgs[pos];
+                pos++;
+            }
+        }
+        else {
+            literal += runArgs[pos];
+            pos++;
+        }
+    }
+
+    appendLiteral(segments, literal);
+    return segments;
+}
+
+// ==================== 各命令编译 ====================
+
+static Instruction compileSay(size_t lineIndex, std::stringstream& ss) {
+    Instruction instruction;
+    instruction.op = OpCode::SAY;
+
+    std::string rest;
+    getline(ss, rest);
+
+    size_t start = rest.find_first_not_of(" ");
+    if (start == std::string::npos) {
+        instruction.op = OpCode::NOP;
+        return instruction;
+    }
+    rest = rest.substr(start);
+
+    std::string text = "";
+    double time_val = 0.5;
+    std::string incolor = "white";
+
+    if (rest[0] == '"') {
+        size_t quote_end = 0;
+        bool escaped = false;
+        size_t errorPos = 0;
+
+        for (size_t i = 1; i < rest.length(); i++) {
+            errorPos = i;
+            if (escaped) {
+                switch (rest[i]) {
+                case '"': text += '"'; break;
+                case 'n': text += '\n'; break;
+                case 't': text += '\t'; break;
+                case 'r': text += '\r'; break;
+                case '\\': text += '\\'; break;
+                default: text += rest[i]; break;
+                }
+                escaped = false;
+            }
+            else if (rest[i] == '\\') {
+                escaped = true;
+            }
+            else if (rest[i] == '"') {
+                quote_end = i;
+                break;
+            }
+            else {
+                text += rest[i];
+            }
+        }
+
+        if (quote_end == 0) {
+            return makeError("say", {
+                LogCode::PARSE_ERROR,
+                "Missing closing quote in say command at line " + std::to_string(lineIndex + 1),
+                "ParseError",
+                "Unterminated string literal at 'say' command",
+                errorPos,
+                "Add closing double quote (\") at the end of the string. "
+                "Use \\\" to include double quotes inside the string.",
+                "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3001.md",
+                "错误：say命令中的字符串缺少结束引号"
+            });
+        }
+
+        std::string remaining = rest.substr(quote_end + 1);
+        std::stringstream remainingSS(remaining);
+        std::vector<std::string> tokens;
+        std::string token;
+
+        while (remainingSS >> token) {
+            tokens.push_back(token);
+        }
+
+        if (!tokens.empty()) {
+            std::string last_token = tokens.back();
+            color parsed;
+
+            if (parseColorName(last_token, parsed)) {
+                incolor = last_token;
+                tokens.pop_back();
+            }
+
+            if (!tokens.empty()) {
+                last_token = tokens.back();
+                try {
+                    time_val = std::stod(last_token);
+                    tokens.pop_back();
+                }
+                catch (const std::exception&) {
+                    time_val = 0.5;
+                }
+            }
+        }
+    }
+    else {
+        std::stringstream rest_ss(rest);
+        std::vector<std::string> tokens;
+        std::string token;
+
+        while (rest_ss >> token) {
+            tokens.push_back(token);
+        }
+
+        if (!tokens.empty()) {
+            std::vector<std::string> text_parts;
+
+            while (!tokens.empty()) {
+                std::string token = tokens.back();
+                color parsed;
+
+                if (parseColorName(token, parsed)) {
+                    if (incolor == "white") {
+                        incolor = token;
+                        tokens.pop_back();
+                        continue;
+                    }
+                }
+
+                char* end;
+                double time_test = strtod(token.c_str(), &end);
+                if (end != token.c_str() && *end == '\0') {
+                    if (time_val == 0.5) {
+                        time_val = time_test;
+                        tokens.pop_back();
+                        continue;
+                    }
+                }
+
+                text_parts.insert(text_parts.begin(), token);
+                tokens.pop_back();
+            }
+
+            for (size_t i = 0; i < text_parts.size(); i++) {
+                if (i > 0) text += " ";
+                text += text_parts[i];
+            }
+        }
+    }
+
+    instruction.segments = splitSayText(text);
+    instruction.time = time_val;
+    parseColorName(incolor, instruction.textColor);
+    return instruction;
+}
+
+static Instruction compileInput(const std::string& line, size_t lineIndex, std::stringstream& ss) {
+    Instruction instruction;
+    instruction.op = OpCode::INPUT;
+
+    std::string prompt, varName;
+
+    if (line.find('"') != std::string::npos) {
+        size_t firstQuote = line.find('"');
+        size_t secondQuote = line.find('"', firstQuote + 1);
+
+        if (secondQuote == std::string::npos) {
+            return makeError("input", {
+                LogCode::PARSE_ERROR,
+                "Invalid input command: missing closing quote at line " + std::to_string(lineIndex + 1),
+                "ParseError",
+                "Unterminated string literal at 'input' command",
+                firstQuote + 1,
+                "Add closing double quote (\") at the end of the prompt string.",
+                "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3001.md",
+                "错误：input命令格式不正确，缺少结束引号"
+            });
+        }
+
+        prompt = line.substr(firstQuote + 1, secondQuote - firstQuote - 1);
+        std::string rest = line.substr(secondQuote + 1);
+
+        std::stringstream restSS(rest);
+        if (!(restSS >> varName)) {
+            ScriptError error;
+            error.logMessage = "Invalid input command: missing variable name at line " + std::to_string(lineIndex + 1);
+            error.boxMessage = "错误：input命令格式不正确，缺少变量名";
+            return makeError("input", error);
+        }
+    }
+    else {
+        std::string rest;
+        getline(ss, rest);
+        std::stringstream restSS(rest);
+
+        if (!(restSS >> prompt >> varName)) {
+            ScriptError error;
+            error.logMessage = "Invalid input command: missing parameters at line " + std::to_string(lineIndex + 1);
+            error.boxMessage = "错误：input命令格式不正确，参数不足";
+            return makeError("input", error);
+        }
+    }
+
+    if (varName.empty()) {
+        ScriptError error;
+        error.logMessage = "Invalid input command: empty variable name at line " + std::to_string(lineIndex + 1);
+        error.boxMessage = "错误：input命令变量名不能为空";
+        return makeError("input", error);
+    }
+
+    instruction.text = prompt;
+    instruction.name = varName;
+    instruction.slot = VariableTable::instance().intern(varName);
+    return instruction;
+}
+
+static Instruction compileChoose(const std::string& line, size_t lineIndex, size_t lineCount,
+    const std::map<std::string, int>& labels) {
+    Instruction instruction;
+    instruction.op = OpCode::CHOOSE;
+
+    std::stringstream ss(line);
+    std::string cmdWord;
+    int optionCount = 0;
+
+    ss >> cmdWord >> optionCount;
+
+    for (int i = 0; i < optionCount; i++) {
+        std::string optionStr;
+        if (ss >> optionStr) {
+            ChoiceOption option;
+            size_t colonPos = optionStr.find(':');
+            if (colonPos != std::string::npos) {
+                option.label = optionStr.substr(0, colonPos);
+                option.text = optionStr.substr(colonPos + 1);
+            }
+            else {
+                option.label = optionStr;
+                option.text = optionStr;
+            }
+            option.jumpLine = resolveJump(option.label, labels, lineCount);
+            instruction.options.push_back(option);
+            instruction.menuOptions.push_back(std::to_string(i + 1) + ". " + option.text);
+        }
+    }
+
+    // 没有选项时菜单无法选择，执行到该行时报告错误并继续
+    if (instruction.options.empty()) {
+        ScriptError error;
+        error.logMessage = "Invalid choose command: no options at line " + std::to_string(lineIndex + 1);
+        error.boxMessage = "错误：choose命令没有可选的选项";
+        return makeError(cmdWord, error);
+    }
+
+    return instruction;
+}
+
+static Instruction compileIf(size_t lineIndex, size_t lineCount,
+    const std::map<std::string, int>& labels, std::stringstream& ss) {
+    Instruction instruction;
+    instruction.op = OpCode::IF;
+
+    std::string conditionExpr;
+    getline(ss, conditionExpr);
+
+    size_t lastSpace = conditionExpr.find_last_of(' ');
+    if (lastSpace == std::string::npos) {
+        return makeError("if", {
+            LogCode::CONDITION_INVALID,
+            "Invalid IF command format at line " + std::to_string(lineIndex + 1) +
+                ", condition expression: " + conditionExpr,
+            "ConditionError",
+            "Missing jump target in 'if' command",
+            conditionExpr.length(),
+            "Add a jump target (line number or label) at the end of the condition. "
+            "Example: if a > 10 end_label",
+            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3005.md",
+            "错误：if命令格式不正确"
+        });
+    }
+
+    std::string target = conditionExpr.substr(lastSpace + 1);
+    conditionExpr = conditionExpr.substr(0, lastSpace);
+
+    conditionExpr.erase(0, conditionExpr.find_first_not_of(" "));
+    conditionExpr.erase(conditionExpr.find_last_not_of(" ") + 1);
+
+    instruction.condition = compileCondition(conditionExpr);
+    instruction.text = target;
+    instruction.jumpLine = resolveJump(target, labels, lineCount);
+    return instruction;
+}
+
+static Instruction compilePlugin(size_t lineIndex, std::stringstream& ss,
+    const std::string& where) {
+    Instruction instruction;
+    instruction.op = OpCode::PLUGIN;
+
+    std::string pluginName, runArgs, resultVar;
+
+    std::string rest;
+    getline(ss, rest);
+
+    // plugin async <插件名> "<参数>" <变量名>：后面还有插件名时 async 才是关键字
+    std::string_view afterAsync;
+    bool async = false;
+    if (firstToken(rest, &afterAsync) == "async") {
+        std::string_view next = firstToken(afterAsync);
+        if (!next.empty() && next.front() != '"') {
+            async = true;
+            rest = std::string(afterAsync);
+        }
+    }
+
+    size_t firstQuote = std::string::npos;
+    bool escaped = false;
+
+    for (size_t i = 0; i < rest.length(); i++) {
+        if (escaped) {
+            escaped = false;
+            continue;
+        }
+
+        if (rest[i] == '\\') {
+            escaped = true;
+            continue;
+        }
+
+        if (rest[i] == '"') {
+            firstQuote = i;
+            break;
+        }
+    }
+
+    if (firstQuote == std::string::npos) {
+        std::stringstream restSS(rest);
+        if (!(restSS >> pluginName)) {
+            ScriptError error;
+            error.logMessage = "Invalid plugin command format: missing plugin name at line " +
+                std::to_string(lineIndex + 1);
+            error.boxMessage = "错误：plugin命令格式不正确，缺少插件名";
+            return makeError("plugin", error);
+        }
+        runArgs = "";
+        if (async) {
+            restSS >> resultVar;
+        }
+    }
+    else {
+        std::string beforeQuote = rest.substr(0, firstQuote);
+        std::stringstream beforeSS(beforeQuote);
+        if (!(beforeSS >> pluginName)) {
+            ScriptError error;
+            error.logMessage = "Invalid plugin command format: missing plugin name before quotes at line " +
+                std::to_string(lineIndex + 1);
+            error.boxMessage = "错误：plugin命令格式不正确，引号前缺少插件名";
+            return makeError("plugin", error);
+        }
+
+        escaped = false;
+        size_t secondQuote = std::string::npos;
+
+        for (size_t i = firstQuote + 1; i < rest.length(); i++) {
+            if (escaped) {
+                escaped = false;
+                continue;
+            }
+
+            if (rest[i] == '\\') {
+                escaped = true;
+                continue;
+            }
+
+            if (rest[i] == '"') {
+                secondQuote = i;
+                break;
+            }
+        }
+
+        if (secondQuote == std::string::npos) {
+            return makeError("plugin", {
+                LogCode::PARSE_ERROR,
+                "Invalid plugin command format: missing closing quote at line " +
+                    std::to_string(lineIndex + 1),
+                "ParseError",
+                "Unterminated string literal in 'plugin' command",
+                firstQuote + 1,
+                "Add closing double quote (\") at the end of the arguments.",
+                "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3001.md",
+                "错误：plugin命令格式不正确，缺少结束引号"
+            });
+        }
+
+        std::string rawArgs = rest.substr(firstQuote + 1, secondQuote - firstQuote - 1);
+
+        std::string unescapedArgs;
+        escaped = false;
+
+        for (size_t i = 0; i < rawArgs.length(); i++) {
+            if (escaped) {
+                switch (rawArgs[i]) {
+                case '"': unescapedArgs += '"'; break;
+                case '\\': unescapedArgs += '\\'; break;
+                case 'n': unescapedArgs += '\n'; break;
+                case 't': unescapedArgs += '\t'; break;
+                case 'r': unescapedArgs += '\r'; break;
+                default: unescapedArgs += rawArgs[i]; break;
+                }
+                escaped = false;
+            }
+            else if (rawArgs[i] == '\\') {
+                escaped = true;
+            }
+            else {
+                unescapedArgs += rawArgs[i];
+            }
+        }
+
+        runArgs = unescapedArgs;
+
+        std::string afterQuote = rest.substr(secondQuote + 1);
+        if (async) {
+            std::stringstream afterSS(afterQuote);
+            afterSS >> resultVar;
+            if (!std::getline(afterSS, afterQuote)) {
+                afterQuote.clear();
+            }
+        }
+        size_t nonSpacePos = afterQuote.find_first_not_of(" \t\r\n");
+        if (nonSpacePos != std::string::npos) {
+            Log(LogGrade::WARNING, LogCode::PARSE_ERROR,
+                "Extra characters after closing quote in plugin command: " +
+                afterQuote.substr(nonSpacePos));
+        }
+    }
+
+    instruction.name = trim(pluginName);
+    if (!runArgs.empty()) {
+        instruction.segments = splitPluginArgs(runArgs, where);
+    }
+
+    if (async) {
+        if (resultVar.empty()) {
+            ScriptError error;
+            error.logMessage = "Invalid plugin async command: missing result variable at line " +
+                std::to_string(lineIndex + 1);
+            error.boxMessage = "错误：plugin async命令格式不正确，缺少结果变量名";
+            return makeError("plugin", error);
+        }
+        instruction.op = OpCode::PLUGIN_ASYNC;
+        instruction.text = resultVar;
+        instruction.slot = VariableTable::instance().intern(resultVar);
+    }
+    return instruction;
+}
+
+// ==================== 内置命令 ====================
+
+static Instruction unknownCommand(const std::string& cmd, const std::string& line) {
+    return makeError(cmd, {
+        LogCode::COMMAND_UNKNOWN,
+        "Unknown command: " + cmd,
+        "CommandError",
+        "Unknown PGN command",
+        line.find(cmd),
+        "Check the command spelling or refer to the documentation for valid commands",
+        "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3002.md",
+        "错误：未知的PGN命令 - " + cmd
+    });
+}
+
+static Instruction compileEnd(CommandContext&) {
+    Instruction instruction;
+    instruction.op = OpCode::END;
+    return instruction;
+}
+
+static Instruction compileEndName(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::ENDNAME;
+    std::string endingName;
+    getline(context.args, endingName);
+
+    size_t start = endingName.find_first_not_of(" ");
+    if (start != std::string::npos) {
+        endingName = endingName.substr(start);
+    }
+    instruction.name = endingName;
+
+    const std::string& where = context.where;
+    size_t novelPos = where.find("Novel" PVN_PATH_SEP);
+    if (novelPos != std::string::npos) {
+        size_t startPos = novelPos + 6;
+        size_t endPos = where.find(PVN_PATH_SEP, startPos);
+        if (endPos != std::string::npos) {
+            instruction.text = where.substr(startPos, endPos - startPos);
+        }
+    }
+    return instruction;
+}
+
+static Instruction compileWait(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::WAIT;
+    instruction.hasValue = static_cast<bool>(context.args >> instruction.value);
+    return instruction;
+}
+
+static Instruction compileSayVar(CommandContext& context) {
+    Instruction instruction;
+    std::string incolor;
+    if (context.args >> instruction.name >> instruction.time >> incolor) {
+        instruction.op = OpCode::SAYVAR;
+        instruction.slot = VariableTable::instance().intern(instruction.name);
+        parseColorName(incolor, instruction.textColor);
+        return instruction;
+    }
+    // 参数不完整时按未知命令处理
+    return unknownCommand(context.cmd, context.line);
+}
+
+static Instruction compileShow(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::SHOW;
+    std::string file_to_show;
+    if (context.args >> file_to_show) {
+        instruction.hasValue = true;
+        instruction.name = context.where + "archive" PVN_PATH_SEP + file_to_show;
+    }
+    return instruction;
+}
+
+static Instruction compileCls(CommandContext&) {
+    Instruction instruction;
+    instruction.op = OpCode::CLS;
+    return instruction;
+}
+
+static Instruction compileRandom(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::RANDOM;
+    if (context.args >> instruction.name >> instruction.value >> instruction.value2) {
+        instruction.hasValue = true;
+        instruction.slot = VariableTable::instance().intern(instruction.name);
+        if (instruction.value > instruction.value2) {
+            std::swap(instruction.value, instruction.value2);
+        }
+    }
+    return instruction;
+}
+
+static Instruction compileSet(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::SET;
+    if (context.args >> instruction.name >> instruction.text >> instruction.value) {
+        instruction.slot = VariableTable::instance().intern(instruction.name);
+        const std::string& op = instruction.text;
+        if (op == "=") instruction.setOp = SetOp::ASSIGN;
+        else if (op == "+=") instruction.setOp = SetOp::ADD;
+        else if (op == "-=") instruction.setOp = SetOp::SUB;
+        else if (op == "*=") instruction.setOp = SetOp::MUL;
+        else if (op == "/=") instruction.setOp = SetOp::DIV;
+        else instruction.setOp = SetOp::INVALID;
+    }
+    return instruction;
+}
+
+static Instruction compileJump(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::JUMP;
+    if (context.args >> instruction.text) {
+        instruction.hasValue = true;
+        instruction.jumpLine = resolveJump(instruction.text, context.labels, context.lineCount);
+    }
+    return instruction;
+}
+
+static Instruction compileAwait(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::AWAIT;
+    if (!(context.args >> instruction.name)) {
+        ScriptError error;
+        error.logMessage = "Invalid await command format: missing variable name at line " +
+            std::to_string(context.lineIndex + 1);
+        error.boxMessage = "错误：await命令格式不正确，缺少变量名";
+        return makeError(context.cmd, error);
+    }
+    instruction.slot = VariableTable::instance().intern(instruction.name);
+    return instruction;
+}
+
+static Instruction compileUse(CommandContext& context) {
+    Instruction instruction;
+    instruction.op = OpCode::USE;
+    std::stringstream& ss = context.args;
+    if (!(ss >> instruction.name)) {
+        ScriptError error;
+        error.logMessage = "Invalid use command format: missing plugin name at line " +
+            std::to_string(context.lineIndex + 1);
+        error.boxMessage = "错误：use命令格式不正确，缺少插件名";
+        return makeError(context.cmd, error);
+    }
+
+    std::string pluginVersion;
+    if (ss >> pluginVersion) {
+        std::string remaining;
+        getline(ss, remaining);
+        if (!remaining.empty() && remaining[0] == ' ') {
+            remaining = remaining.substr(1);
+        }
+        if (!remaining.empty()) {
+            pluginVersion += " " + remaining;
+        }
+    }
+    instruction.text = pluginVersion;
+    return instruction;
+}
+
+// ==================== 命令表 ====================
+
+CommandTable& CommandTable::instance() {
+    static CommandTable table;
+    return table;
+}
+
+void CommandTable::addBuiltin(std::initializer_list<const char*> names, CommandCompiler compile) {
+    for (const char* name : names) {
+        entries[name] = { compile, -1, true };
+    }
+}
+
+CommandTable::CommandTable() {
+    addBuiltin({ "end", "END" }, compileEnd);
+    addBuiltin({ "endname", "ENDNAME" }, compileEndName);
+    addBuiltin({ "wait", "WAIT" }, compileWait);
+    addBuiltin({ "say", "SAY" }, [](CommandContext& context) {
+        return compileSay(context.lineIndex, context.args);
+    });
+    addBuiltin({ "input", "INPUT" }, [](CommandContext& context) {
+        return compileInput(context.line, context.lineIndex, context.args);
+    });
+    addBuiltin({ "sayvar", "SAYVAR" }, compileSayVar);
+    addBuiltin({ "show", "SHOW" }, compileShow);
+    addBuiltin({ "choose", "CHOOSE" }, [](CommandContext& context) {
+        return compileChoose(context.line, context.lineIndex, context.lineCount, context.labels);
+    });
+    addBuiltin({ "cls", "clean", "CLS", "CLEAN" }, compileCls);
+    addBuiltin({ "random", "RANDOM" }, compileRandom);
+    addBuiltin({ "set", "SET" }, compileSet);
+    addBuiltin({ "jump", "JUMP" }, compileJump);
+    addBuiltin({ "if", "IF" }, [](CommandContext& context) {
+        return compileIf(context.lineIndex, context.lineCount, context.labels, context.args);
+    });
+    addBuiltin({ "plugin", "PLUGIN", "runplugin", "RUNPLUGIN" }, [](CommandContext& context) {
+        return compilePlugin(context.lineIndex, context.args, context.where);
+    });
+    addBuiltin({ "await", "AWAIT" }, compileAwait);
+    addBuiltin({ "use", "USE" }, compileUse);
+}
+
+bool CommandTable::add(const std::string& name, CommandCompiler compile, int data) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return entries.emplace(name, CommandEntry{ compile, data, false }).second;
+}
+
+void CommandTable::remove(const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it != entries.end() && !it->second.builtin) {
+        entries.erase(it);
+    }
+}
+
+bool CommandTable::has(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return entries.find(name) != entries.end();
+}
+
+bool CommandTable::find(const std::string& name, CommandEntry& entry) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+// ==================== 单行编译 ====================
+
+Instruction compileLine(const std::string& line, size_t lineIndex, size_t lineCount,
+    const std::map<std::string, int>& labels, const std::string& where) {
+    std::stringstream ss(line);
+    std::string cmd;
+    ss >> cmd;
+
+    if (cmd.empty() || cmd == "//" || cmd == "#" || cmd.back() == ':') {
+        Instruction instruction;
+        instruction.op = OpCode::NOP;
+        instruction.cmd = cmd;
+        return instruction;
+    }
+
+    CommandEntry entry;
+    if (!CommandTable::instance().find(cmd, entry)) {
+        return unknownCommand(cmd, line);
+    }
+
+    CommandContext context{ cmd, line, ss, lineIndex, lineCount, labels, where, entry.data };
+    Instruction instruction = entry.compile(context);
+    instruction.cmd = cmd;
+    return instruction;
+}
+
+// ==================== 脚本编译 ====================
+
+CompiledScript compileScript(const std::vector<std::string_view>& lines, const std::string& where) {
+    return compileScript(lines, buildScriptIndex(lines), where);
+}
+
+CompiledScript compileScript(const std::vector<std::string_view>& lines, const ScriptIndex& index,
+    const std::string& where) {
+    auto compileStart = std::chrono::high_resolution_clock::now();
+
+    CompiledScript script;
+    script.labels = index.labels;
+    script.code.reserve(lines.size());
+
+    int errorCount = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        script.code.push_back(compileLine(std::string(lines[i]), i, lines.size(), script.labels, where));
+        if (script.code.back().op == OpCode::ERR) {
+            errorCount++;
+        }
+    }
+
+    auto compileEnd = std::chrono::high_resolution_clock::now();
+    auto compileTime = std::chrono::duration_cast<std::chrono::milliseconds>(compileEnd - compileStart).count();
+
+    Log(LogGrade::INFO, LogCode::TOKEN_COMPLETE,
+        "Compiled " + std::to_string(lines.size()) + " lines (" +
+        std::to_string(errorCount) + " deferred errors, took " +
+        std::to_string(compileTime) + "ms)");
+
+    return script;
+}
+
+// ==================== 文本展开 ====================
+
+std::string expandSegments(const std::vector<TextSegment>& segments, const GameState& gameState) {
+    std::string result;
+    for (const auto& segment : segments) {
+        if (!segment.isVar) {
+            result += segment.text;
+            continue;
+        }
+
+        const std::string& stringValue = gameState.getStringVar(segment.slot);
+        if (!stringValue.empty()) {
+            result += stringValue;
+        }
+        else {
+            result += std::to_string(gameState.getVar(segment.slot));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,215 @@
+﻿// compiler.h
+#pragma once
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "header.h"
+#include "parser.h"
+#include "condition.h"
+#include "scriptindex.h"
+#include "ui.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <shared_mutex>
+#include <sstream>
+#include <unordered_map>
+
+/**
+ * @brief 指令操作码
+ */
+enum class OpCode {
+    NOP,        // 空行、注释、标签
+    END,        // end
+    ENDNAME,    // endname
+    WAIT,       // wait
+    SAY,        // say
+    INPUT,      // input
+    SAYVAR,     // sayvar
+    SHOW,       // show
+    CHOOSE,     // choose
+    CLS,        // cls / clean
+    RANDOM,     // random
+    SET,        // set
+    JUMP,       // jump
+    IF,         // if
+    PLUGIN,     // plugin / runplugin
+    PLUGIN_ASYNC, // plugin async（后台运行，结果稍后写入字符串变量）
+    AWAIT,      // await
+    USE,        // use
+    NATIVE_COMMAND, // 原生插件注册的命令
+    ERR         // 编译期发现的错误，执行到该行时再报告
+};
+
+/**
+ * @brief set命令的运算符
+ */
+enum class SetOp {
+    NONE,       // 参数不完整
+    ASSIGN,     // =
+    ADD,        // +=
+    SUB,        // -=
+    MUL,        // *=
+    DIV,        // /=
+    INVALID     // 无法识别的运算符
+};
+
+/**
+ * @brief 预拆分的文本片段（字面量或 ${var} 引用）
+ */
+struct TextSegment {
+    std::string text;       // 字面文本或变量名
+    bool isVar = false;     // 是否为变量引用
+    int slot = -1;          // 变量槽位（VariableTable）
+};
+
+/**
+ * @brief 延迟到执行期报告的脚本错误
+ */
+struct ScriptError {
+    LogCode code = LogCode::PARSE_ERROR;
+    std::string logMessage;     // 写入日志的内容
+    std::string errorType;      // formatErrorOutput 的错误类型，为空时不输出
+    std::string message;        // formatErrorOutput 的错误描述
+    size_t position = std::string::npos;
+    std::string hint;
+    std::string docUrl;
+    std::string boxMessage;     // 弹窗内容
+};
+
+/**
+ * @brief 单行编译结果
+ *
+ * 每种操作码只使用其中的一部分字段
+ */
+struct Instruction {
+    OpCode op = OpCode::NOP;
+    std::string cmd;                        // 原始命令字
+    std::string name;                       // 变量名 / 插件名 / 结局名 / 文件路径
+    int slot = -1;                          // 变量槽位（set / random / input / sayvar / plugin async / await），原生插件命令编号
+    std::string text;                       // 跳转目标原文 / 提示文本 / 版本号 / 运算符原文 / 结果变量名
+    std::vector<TextSegment> segments;      // say 文本或 plugin / 原生插件命令参数
+    std::vector<ChoiceOption> options;      // choose 选项
+    std::vector<std::string> menuOptions;   // choose 预生成的菜单文本
+    CompiledCondition condition;            // if 条件（已编译为字节码）
+    double time = 0.5;                      // 打字机时间
+    color textColor = white;                // 文本颜色
+    int value = 0;                          // wait毫秒 / set值 / random下限
+    int value2 = 0;                         // random上限
+    bool hasValue = false;                  // wait / jump 参数是否存在
+    SetOp setOp = SetOp::NONE;
+    int jumpLine = -1;                      // 已解析的跳转行号（1-based，-1表示无效）
+    ScriptError error;                      // op == ERR 时使用
+};
+
+/**
+ * @brief 编译后的脚本
+ */
+struct CompiledScript {
+    std::vector<Instruction> code;          // 与脚本行一一对应
+    std::map<std::string, int> labels;      // 标签映射表
+};
+
+// ==================== 命令表 ====================
+
+/**
+ * @brief 编译一条命令时的上下文
+ */
+struct CommandContext {
+    const std::string& cmd;                     // 命令字
+    const std::string& line;                    // 源代码行
+    std::stringstream& args;                    // 已读过命令字的行输入流
+    size_t lineIndex;                           // 行号（0-based）
+    size_t lineCount;                           // 脚本总行数
+    const std::map<std::string, int>& labels;   // 标签映射表
+    const std::string& where;                   // 脚本所在目录路径
+    int data;                                   // 登记命令时附带的数据（原生插件命令编号）
+};
+
+/**
+ * @brief 命令的编译函数
+ */
+using CommandCompiler = Instruction (*)(CommandContext& context);
+
+/**
+ * @brief 命令表中的一项
+ */
+struct CommandEntry {
+    CommandCompiler compile = nullptr;
+    int data = -1;              // 编译时通过 CommandContext::data 传回
+    bool builtin = false;       // 内置命令不可覆盖或移除
+};
+
+/**
+ * @brief 命令表：命令字 → 编译函数
+ *
+ * 内置命令（含大写别名）在首次访问时登记，原生插件加载时登记自己注册的命令，
+ * 两者共用同一张哈希表。compileLine 对每行只查一次表，编译结果的操作码在执行时
+ * 由 executeInstruction 的 switch 直接分派，命令增多不会拖慢编译和执行
+ */
+class CommandTable {
+public:
+    static CommandTable& instance();
+
+    /**
+     * @brief 登记命令
+     * @return 命令字已被占用时返回 false
+     */
+    bool add(const std::string& name, CommandCompiler compile, int data = -1);
+
+    // 移除非内置命令（卸载原生插件时调用）
+    void remove(const std::string& name);
+
+    bool has(const std::string& name) const;
+
+    /**
+     * @brief 查找命令
+     * @return 未登记时返回 false
+     */
+    bool find(const std::string& name, CommandEntry& entry) const;
+
+private:
+    CommandTable();
+    CommandTable(const CommandTable&) = delete;
+    CommandTable& operator=(const CommandTable&) = delete;
+
+    void addBuiltin(std::initializer_list<const char*> names, CommandCompiler compile);
+
+    mutable std::shared_mutex mutex;    // 原生插件可能在后台调用中首次加载并登记命令
+    std::unordered_map<std::string, CommandEntry> entries;
+};
+
+/**
+ * @brief 预处理插件参数：转义、$file{}、$log 在编译期展开，${var} 保留为变量片段
+ */
+std::vector<TextSegment> splitPluginArgs(const std::string& runArgs, const std::string& where);
+
+/**
+ * @brief 编译单行PGN命令
+ * @param line 源代码行
+ * @param lineIndex 行号（0-based）
+ * @param lineCount 脚本总行数（用于校验跳转目标）
+ * @param labels 标签映射表
+ * @param where 脚本所在目录路径
+ */
+Instruction compileLine(const std::string& line, size_t lineIndex, size_t lineCount,
+    const std::map<std::string, int>& labels, const std::string& where);
+
+/**
+ * @brief 编译整个脚本
+ * @param index 加载时建立的脚本索引（提供标签表）
+ */
+CompiledScript compileScript(const std::vector<std::string_view>& lines, const ScriptIndex& index,
+    const std::string& where);
+
+/**
+ * @brief 编译整个脚本（内部建立索引）
+ */
+CompiledScript compileScript(const std::vector<std::string_view>& lines, const std::string& where);
+
+/**
+ * @brief 展开文本片段中的变量引用
+ */
+std::string expandSegments(const std::vector<TextSegment>& segments, const GameState& gameState);
+
+#endif // COMPILER_H
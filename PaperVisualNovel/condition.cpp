@@ -3,7 +3,7 @@
 #include <cctype>
 #include <algorithm>
 
-// ==================== ʽִ ====================
+// ==================== 条件表达式分词 ====================
 
 std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
     std::vector<ConditionToken> tokens;
@@ -14,10 +14,10 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
 
         if (std::isspace(c)) {
             if (!current.empty()) {
-                // ǰtoken
+                // 处理当前token
                 ConditionToken token;
 
-                // ǷΪ
+                // 检查是否为操作符
                 if (current == "&&") {
                     token.type = ConditionToken::OPERATOR;
                     token.value = current;
@@ -67,7 +67,7 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
                     token.value = current;
                 }
                 else {
-                    // ǷΪ
+                    // 检查是否为数字
                     bool isNumber = true;
                     for (char ch : current) {
                         if (!std::isdigit(ch) && ch != '-' && ch != '+') {
@@ -92,20 +92,20 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
             continue;
         }
 
-        // 
+        // 处理操作符
         if (c == '&' || c == '|' || c == '=' || c == '!' || c == '<' || c == '>' ||
             c == '(' || c == ')') {
 
             if (!current.empty()) {
-                // ǰtoken
+                // 处理当前token
                 ConditionToken token;
-                token.type = ConditionToken::VAR; // Ǳ
+                token.type = ConditionToken::VAR; // 假设是变量
                 token.value = current;
                 tokens.push_back(token);
                 current.clear();
             }
 
-            // 
+            // 处理操作符
             std::string opStr(1, c);
             if (i + 1 < expr.length()) {
                 char next = expr[i + 1];
@@ -116,7 +116,7 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
                     (c == '<' && next == '=') ||
                     (c == '>' && next == '=')) {
                     opStr += next;
-                    i++; // һַ
+                    i++; // 跳过下一个字符
                 }
             }
 
@@ -177,7 +177,7 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
         }
     }
 
-    // һtoken
+    // 处理最后一个token
     if (!current.empty()) {
         ConditionToken token;
         token.type = ConditionToken::VAR;
@@ -188,7 +188,7 @@ std::vector<ConditionToken> tokenizeCondition(const std::string& expr) {
     return tokens;
 }
 
-// ==================== ȡȼ ====================
+// ==================== 获取操作符优先级 ====================
 
 int getOpPriority(ConditionOp op) {
     switch (op) {
@@ -199,13 +199,13 @@ int getOpPriority(ConditionOp op) {
     }
 }
 
-// ==================== 򵥱ʽ ====================
+// ==================== 计算简单表达式 ====================
 
 bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op, 
                              const std::string& rightStr, const GameState& gameState) {
     int leftVal, rightVal;
 
-    // ȡֵ
+    // 获取左值
     if (std::isdigit(leftStr[0]) || 
         (leftStr[0] == '-' && leftStr.length() > 1 && std::isdigit(leftStr[1]))) {
         leftVal = std::stoi(leftStr);
@@ -214,7 +214,7 @@ bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op,
         leftVal = gameState.getVar(leftStr);
     }
 
-    // ȡֵ
+    // 获取右值
     if (std::isdigit(rightStr[0]) || 
         (rightStr[0] == '-' && rightStr.length() > 1 && std::isdigit(rightStr[1]))) {
         rightVal = std::stoi(rightStr);
@@ -223,7 +223,7 @@ bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op,
         rightVal = gameState.getVar(rightStr);
     }
 
-    // бȽ
+    // 进行比较
     switch (op) {
     case OP_EQ: return leftVal == rightVal;
     case OP_NE: return leftVal != rightVal;
@@ -235,7 +235,7 @@ bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op,
     }
 }
 
-// ==================== ݹʽ ====================
+// ==================== 递归计算条件表达式 ====================
 
 bool evaluateCondition(const std::vector<ConditionToken>& tokens, 
                        const GameState& gameState, size_t& index) {
@@ -251,7 +251,7 @@ bool evaluateCondition(const std::vector<ConditionToken>& tokens,
             values.push_back(subResult);
         }
         else if (token.type == ConditionToken::VAR || token.type == ConditionToken::NUMBER) {
-            // 򵥱Ƚϱʽ
+            // 处理简单比较表达式
             if (index + 2 < tokens.size()) {
                 const auto& opToken = tokens[index + 1];
                 const auto& rightToken = tokens[index + 2];
@@ -267,13 +267,13 @@ bool evaluateCondition(const std::vector<ConditionToken>& tokens,
                 }
             }
 
-            // ǵǷΪ棨㣩
+            // 如果是单个变量，检查是否为真（非零）
             if (token.type == ConditionToken::VAR) {
                 int varVal = gameState.getVar(token.value);
                 values.push_back(varVal != 0);
             }
             else {
-                // ֱתΪbool
+                // 数字直接转为bool
                 int numVal = std::stoi(token.value);
                 values.push_back(numVal != 0);
             }
@@ -289,12 +289,12 @@ bool evaluateCondition(const std::vector<ConditionToken>& tokens,
             break;
         }
         else {
-            // token
+            // 跳过其他token
             index++;
         }
     }
 
-    // Ҽ߼㣨&& ȼ ||
+    // 从左到右计算逻辑运算（&& 优先级高于 ||）
     bool result = values.empty() ? false : values[0];
     size_t opIndex = 0;
 
@@ -312,4 +312,190 @@ bool evaluateCondition(const std::vector<ConditionToken>& tokens,
     }
 
     return result;
-}
\ No newline at end of file
+}
+// ==================== 条件表达式编译 ====================
+
+namespace {
+    struct ConditionCompiler {
+        int slotOf(const std::string& name) {
+            return VariableTable::instance().intern(name);
+        }
+
+        // 比较运算的操作数：与 evaluateSimpleCondition 相同，以数字开头的视为常量
+        bool emitOperand(const std::string& text, std::vector<CondInstr>& out) {
+            bool isLiteral = !text.empty() &&
+                (std::isdigit(static_cast<unsigned char>(text[0])) ||
+                 (text[0] == '-' && text.length() > 1 && std::isdigit(static_cast<unsigned char>(text[1]))));
+
+            if (!isLiteral) {
+                out.push_back({ CondOpCode::PUSH_VAR, slotOf(text) });
+                return true;
+            }
+            try {
+                out.push_back({ CondOpCode::PUSH_CONST, std::stoi(text) });
+                return true;
+            }
+            catch (const std::exception&) {
+                return false;
+            }
+        }
+
+        /**
+         * @brief 编译一层括号内的表达式，结构与 evaluateCondition 一一对应
+         *
+         * 逻辑运算从左到右依次结合，多余的值或运算符被忽略
+         */
+        bool compileGroup(const std::vector<ConditionToken>& tokens, size_t& index,
+            std::vector<CondInstr>& out) {
+            std::vector<std::vector<CondInstr>> values;
+            std::vector<ConditionOp> ops;
+
+            while (index < tokens.size()) {
+                const auto& token = tokens[index];
+
+                if (token.type == ConditionToken::PAREN_OPEN) {
+                    index++;
+                    std::vector<CondInstr> sub;
+                    if (!compileGroup(tokens, index, sub)) {
+                        return false;
+                    }
+                    values.push_back(std::move(sub));
+                }
+                else if (token.type == ConditionToken::VAR || token.type == ConditionToken::NUMBER) {
+                    if (index + 2 < tokens.size()) {
+                        const auto& opToken = tokens[index + 1];
+                        const auto& rightToken = tokens[index + 2];
+
+                        if (opToken.type == ConditionToken::OPERATOR &&
+                            (opToken.op >= OP_EQ && opToken.op <= OP_GE)) {
+                            std::vector<CondInstr> value;
+                            if (!emitOperand(token.value, value) || !emitOperand(rightToken.value, value)) {
+                                return false;
+                            }
+                            value.push_back({ static_cast<CondOpCode>(
+                                static_cast<int>(CondOpCode::CMP_EQ) + (opToken.op - OP_EQ)), 0 });
+                            values.push_back(std::move(value));
+                            index += 3;
+                            continue;
+                        }
+                    }
+
+                    if (token.type == ConditionToken::VAR) {
+                        values.push_back({ { CondOpCode::PUSH_VAR, slotOf(token.value) },
+                                           { CondOpCode::TRUTHY, 0 } });
+                    }
+                    else {
+                        try {
+                            values.push_back({ { CondOpCode::PUSH_CONST, std::stoi(token.value) != 0 } });
+                        }
+                        catch (const std::exception&) {
+                            return false;
+                        }
+                    }
+                    index++;
+                }
+                else if (token.type == ConditionToken::OPERATOR &&
+                        (token.op == OP_AND || token.op == OP_OR)) {
+                    ops.push_back(token.op);
+                    index++;
+                }
+                else if (token.type == ConditionToken::PAREN_CLOSE) {
+                    index++;
+                    break;
+                }
+                else {
+                    index++;
+                }
+            }
+
+            if (values.empty()) {
+                out.push_back({ CondOpCode::PUSH_CONST, 0 });
+                return true;
+            }
+
+            out.insert(out.end(), values[0].begin(), values[0].end());
+            for (size_t i = 1; i < values.size() && i - 1 < ops.size(); i++) {
+                out.insert(out.end(), values[i].begin(), values[i].end());
+                out.push_back({ ops[i - 1] == OP_AND ? CondOpCode::AND : CondOpCode::OR, 0 });
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief 计算字节码运行所需的栈深度
+     */
+    size_t stackDepth(const std::vector<CondInstr>& code) {
+        size_t depth = 0;
+        size_t maxDepth = 0;
+        for (const CondInstr& instr : code) {
+            switch (instr.op) {
+            case CondOpCode::PUSH_CONST:
+            case CondOpCode::PUSH_VAR:
+                depth++;
+                break;
+            case CondOpCode::TRUTHY:
+                break;
+            default:
+                depth--;
+                break;
+            }
+            maxDepth = std::max(maxDepth, depth);
+        }
+        return maxDepth;
+    }
+}
+
+CompiledCondition compileCondition(const std::string& expr) {
+    CompiledCondition result;
+    std::vector<ConditionToken> tokens = tokenizeCondition(expr);
+
+    ConditionCompiler compiler;
+    size_t index = 0;
+    if (compiler.compileGroup(tokens, index, result.code) &&
+        stackDepth(result.code) <= kConditionStackSize) {
+        result.compiled = true;
+        return result;
+    }
+
+    // 保留Token，执行期按原方式求值（与原行为一致，包括异常）
+    result.code.clear();
+    result.tokens = std::move(tokens);
+    return result;
+}
+
+// ==================== 条件字节码求值 ====================
+
+bool evaluateCompiledCondition(const CompiledCondition& condition, const GameState& gameState) {
+    if (!condition.compiled) {
+        size_t index = 0;
+        return evaluateCondition(condition.tokens, gameState, index);
+    }
+
+    int stack[kConditionStackSize];
+    size_t top = 0;
+
+    for (const CondInstr& instr : condition.code) {
+        switch (instr.op) {
+        case CondOpCode::PUSH_CONST:
+            stack[top++] = instr.operand;
+            break;
+        case CondOpCode::PUSH_VAR:
+            stack[top++] = gameState.getVar(instr.operand);
+            break;
+        case CondOpCode::TRUTHY:
+            stack[top - 1] = stack[top - 1] != 0;
+            break;
+        case CondOpCode::CMP_EQ: top--; stack[top - 1] = stack[top - 1] == stack[top]; break;
+        case CondOpCode::CMP_NE: top--; stack[top - 1] = stack[top - 1] != stack[top]; break;
+        case CondOpCode::CMP_LT: top--; stack[top - 1] = stack[top - 1] < stack[top]; break;
+        case CondOpCode::CMP_GT: top--; stack[top - 1] = stack[top - 1] > stack[top]; break;
+        case CondOpCode::CMP_LE: top--; stack[top - 1] = stack[top - 1] <= stack[top]; break;
+        case CondOpCode::CMP_GE: top--; stack[top - 1] = stack[top - 1] >= stack[top]; break;
+        case CondOpCode::AND: top--; stack[top - 1] = stack[top - 1] && stack[top]; break;
+        case CondOpCode::OR:  top--; stack[top - 1] = stack[top - 1] || stack[top]; break;
+        }
+    }
+
+    return top > 0 && stack[top - 1] != 0;
+}
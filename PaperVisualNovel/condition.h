@@ -8,7 +8,7 @@
 #include <string>
 
 /**
- * @brief 
+ * @brief 条件运算符类型
  */
 enum ConditionOp {
     OP_NONE = 0,
@@ -23,7 +23,7 @@ enum ConditionOp {
 };
 
 /**
- * @brief ʽTokenṹ
+ * @brief 条件表达式Token结构
  */
 struct ConditionToken {
     enum Type {
@@ -38,7 +38,46 @@ struct ConditionToken {
     ConditionOp op;
 };
 
-// ʽ
+/**
+ * @brief 条件字节码操作码（后缀表达式，操作数为 int 栈）
+ */
+enum class CondOpCode : unsigned char {
+    PUSH_CONST,     // 压入常量
+    PUSH_VAR,       // 压入变量值（operand 为变量槽位）
+    TRUTHY,         // 栈顶转为 0/1
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_GT,
+    CMP_LE,
+    CMP_GE,
+    AND,
+    OR
+};
+
+/**
+ * @brief 条件字节码指令
+ */
+struct CondInstr {
+    CondOpCode op;
+    int operand;    // 常量值或变量槽位（VariableTable）
+};
+
+/**
+ * @brief 编译后的条件表达式
+ *
+ * 无法编译（数字越界、嵌套过深）时保留Token，执行期按原方式求值
+ */
+struct CompiledCondition {
+    std::vector<CondInstr> code;
+    std::vector<ConditionToken> tokens;     // 仅在 compiled == false 时使用
+    bool compiled = false;
+};
+
+// 条件求值栈深度上限
+constexpr size_t kConditionStackSize = 32;
+
+// 条件表达式解析函数
 std::vector<ConditionToken> tokenizeCondition(const std::string& expr);
 int getOpPriority(ConditionOp op);
 bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op, 
@@ -46,4 +85,8 @@ bool evaluateSimpleCondition(const std::string& leftStr, ConditionOp op,
 bool evaluateCondition(const std::vector<ConditionToken>& tokens, 
                        const GameState& gameState, size_t& index);
 
+// 条件表达式编译与求值
+CompiledCondition compileCondition(const std::string& expr);
+bool evaluateCompiledCondition(const CompiledCondition& condition, const GameState& gameState);
+
 #endif // CONDITION_H
\ No newline at end of file
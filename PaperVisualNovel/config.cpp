@@ -0,0 +1,251 @@
+﻿// config.cpp
+#include "config.h"
+#include "platform.h"
+#include "ui.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace {
+    const char* const kConfigFile = "data.cfg";
+
+    // 两次检查配置文件是否变化的最小间隔
+    constexpr auto kReloadCheckInterval = std::chrono::seconds(1);
+
+    // 解析 "key = value" 行，注释和空行返回 false
+    bool splitLine(const std::string& line, std::string& key, std::string& value) {
+        std::string trimmedLine = trim(line);
+        if (trimmedLine.empty() || trimmedLine[0] == '#' || trimmedLine[0] == ';') {
+            return false;
+        }
+
+        size_t equalsPos = trimmedLine.find('=');
+        if (equalsPos == std::string::npos) {
+            return false;
+        }
+
+        key = trim(trimmedLine.substr(0, equalsPos));
+        value = trim(trimmedLine.substr(equalsPos + 1));
+        if (value.length() >= 2 &&
+            ((value.front() == '"' && value.back() == '"') ||
+                (value.front() == '\'' && value.back() == '\''))) {
+            value = value.substr(1, value.length() - 2);
+        }
+        return !key.empty();
+    }
+}
+
+ConfigStore& ConfigStore::instance() {
+    static ConfigStore store;
+    return store;
+}
+
+ConfigStore::Value ConfigStore::parseValue(const std::string& text) {
+    Value value;
+    value.text = text;
+
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "1" || lower == "true" || lower == "yes" || lower == "on") {
+        value.hasBool = true;
+        value.boolValue = true;
+    }
+    else if (lower == "0" || lower == "false" || lower == "no" || lower == "off") {
+        value.hasBool = true;
+        value.boolValue = false;
+    }
+
+    try {
+        size_t used = 0;
+        value.intValue = std::stoi(text, &used);
+        value.hasInt = used == text.size();
+    }
+    catch (const std::exception&) {
+        value.hasInt = false;
+    }
+    return value;
+}
+
+void ConfigStore::load() {
+    values.clear();
+    lines.clear();
+    stamp = getFileStamp(kConfigFile);
+
+    std::ifstream inFile(kConfigFile);
+    if (!inFile.is_open()) {
+        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
+            std::string("Failed to open configuration file: ") + kConfigFile);
+
+        formatErrorOutput(
+            logCodeToString(LogCode::FILE_OPEN_FAILED),
+            "FileError",
+            "Cannot open configuration file",
+            "",
+            0,
+            std::string::npos,
+            "Make sure data.cfg exists in the application directory",
+            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3004.md"
+        );
+
+        platform().showMessage(std::string("错误：无法打开配置文件\n") + kConfigFile,
+            "文件错误", MessageLevel::ERR);
+        return;
+    }
+
+    std::string line;
+    while (std::getline(inFile, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        lines.push_back(line);
+
+        std::string key;
+        std::string value;
+        if (splitLine(line, key, value)) {
+            values[key] = parseValue(value);
+        }
+    }
+
+    Log(LogGrade::INFO, LogCode::GAME_START,
+        "Configuration loaded: " + std::to_string(values.size()) + " keys from " + kConfigFile);
+}
+
+void ConfigStore::refresh() {
+    auto now = std::chrono::steady_clock::now();
+    if (loaded && now - lastCheck < kReloadCheckInterval) {
+        return;
+    }
+    lastCheck = now;
+
+    if (loaded && getFileStamp(kConfigFile) == stamp) {
+        return;
+    }
+
+    // 外部修改后重新加载，保留尚未写入的修改
+    std::map<std::string, Value> pending;
+    for (const auto& key : dirtyKeys) {
+        pending[key] = values[key];
+    }
+    if (loaded) {
+        Log(LogGrade::INFO, LogCode::GAME_START, "Configuration file changed, reloading");
+    }
+    load();
+    for (auto& [key, value] : pending) {
+        values[key] = std::move(value);
+    }
+    loaded = true;
+}
+
+const ConfigStore::Value* ConfigStore::find(const std::string& key) {
+    refresh();
+    auto it = values.find(key);
+    return it != values.end() ? &it->second : nullptr;
+}
+
+bool ConfigStore::has(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find(key) != nullptr;
+}
+
+std::string ConfigStore::getString(const std::string& key, const std::string& defaultValue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Value* value = find(key);
+    return value != nullptr ? value->text : defaultValue;
+}
+
+bool ConfigStore::getBool(const std::string& key, bool defaultValue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Value* value = find(key);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    if (!value->hasBool) {
+        Log(LogGrade::WARNING, LogCode::PARSE_ERROR, "Invalid boolean value for " + key + ": " + value->text);
+        return defaultValue;
+    }
+    return value->boolValue;
+}
+
+int ConfigStore::getInt(const std::string& key, int defaultValue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Value* value = find(key);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    if (!value->hasInt) {
+        Log(LogGrade::WARNING, LogCode::PARSE_ERROR, "Invalid value for " + key + ": " + value->text);
+        return defaultValue;
+    }
+    return value->intValue;
+}
+
+void ConfigStore::set(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refresh();
+    values[key] = parseValue(value);
+    if (std::find(dirtyKeys.begin(), dirtyKeys.end(), key) == dirtyKeys.end()) {
+        dirtyKeys.push_back(key);
+    }
+}
+
+void ConfigStore::setBool(const std::string& key, bool value) {
+    set(key, value ? "1" : "0");
+}
+
+void ConfigStore::setInt(const std::string& key, int value) {
+    set(key, std::to_string(value));
+}
+
+bool ConfigStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (dirtyKeys.empty()) {
+        return true;
+    }
+    return writeFile();
+}
+
+bool ConfigStore::writeFile() {
+    // 就地替换已有的键，保留等号前的原文（含缩进和对齐）
+    std::vector<std::string> written = lines;
+    std::vector<std::string> remaining = dirtyKeys;
+    for (auto& line : written) {
+        std::string key;
+        std::string value;
+        if (!splitLine(line, key, value)) {
+            continue;
+        }
+        auto it = std::find(remaining.begin(), remaining.end(), key);
+        if (it != remaining.end()) {
+            line = line.substr(0, line.find('=') + 1) + " " + values[key].text;
+            remaining.erase(it);
+        }
+    }
+    for (const auto& key : remaining) {
+        written.push_back(key + " = " + values[key].text);
+    }
+
+    std::string data;
+    for (const auto& line : written) {
+        data += line;
+        data += '\n';
+    }
+
+    const std::string tempPath = std::string(kConfigFile) + ".tmp";
+    if (!writeFileDurable(tempPath, data, false) || !replaceFileAtomic(tempPath, kConfigFile)) {
+        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
+            std::string("Failed to write configuration file: ") + kConfigFile);
+        platform().showMessage(std::string("错误：无法写入文件 ") + kConfigFile,
+            "错误", MessageLevel::ERR);
+        return false;
+    }
+
+    Log(LogGrade::INFO, LogCode::GAME_SAVED,
+        "Configuration file updated: " + std::to_string(dirtyKeys.size()) + " keys, " +
+        std::to_string(data.size()) + " bytes written");
+
+    lines = std::move(written);
+    dirtyKeys.clear();
+    stamp = getFileStamp(kConfigFile);
+    return true;
+}
@@ -0,0 +1,73 @@
+﻿// config.h
+#pragma once
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "fileutils.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 配置存储（data.cfg）
+ *
+ * 首次访问时把配置文件解析为键值表，之后的读取只查内存。
+ * 每隔一段时间检查一次文件的大小和修改时间，外部修改后自动重新加载。
+ * set 只修改内存并记录待写入的键，flush 时合并为一次原子写入（临时文件 + 改名），
+ * 保留文件中的注释和行顺序。修改不会在析构时自动写入，退出前需调用 flush
+ */
+class ConfigStore {
+public:
+    static ConfigStore& instance();
+
+    bool has(const std::string& key);
+    std::string getString(const std::string& key, const std::string& defaultValue = "");
+    // 1 / true / yes / on 为真，0 / false / no / off 为假，其他值返回默认值
+    bool getBool(const std::string& key, bool defaultValue = false);
+    int getInt(const std::string& key, int defaultValue = 0);
+
+    void set(const std::string& key, const std::string& value);
+    void setBool(const std::string& key, bool value);
+    void setInt(const std::string& key, int value);
+
+    /**
+     * @brief 把 set 修改过的键写回配置文件
+     * @return 没有待写入的修改或写入成功时返回 true
+     */
+    bool flush();
+
+private:
+    ConfigStore() = default;
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    /**
+     * @brief 解析后的配置值，读取时无需再次转换
+     */
+    struct Value {
+        std::string text;
+        bool hasBool = false;
+        bool boolValue = false;
+        bool hasInt = false;
+        int intValue = 0;
+    };
+
+    static Value parseValue(const std::string& text);
+
+    void refresh();             // 需要时（首次访问或文件已变化）重新加载，调用方持有锁
+    void load();
+    bool writeFile();
+    const Value* find(const std::string& key);
+
+    std::mutex mutex;
+    std::map<std::string, Value> values;
+    std::vector<std::string> lines;         // 文件原始内容，写回时保留注释和顺序
+    std::vector<std::string> dirtyKeys;     // set 后尚未写入文件的键
+    FileStamp stamp;
+    bool loaded = false;
+    std::chrono::steady_clock::time_point lastCheck;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,621 @@
+﻿// explorer.cpp
+#include "explorer.h"
+#include "compiler.h"
+#include "fileutils.h"
+#include "platform.h"
+#include "ui.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+    constexpr size_t kMaxSegmentSteps = 100000;     // 两个分叉点之间最多执行的行数
+    constexpr int kMaxRandomBranches = 64;          // random 最多分叉的取值个数
+    constexpr size_t kMemoShards = 64;
+
+    /**
+     * @brief 选择路径节点，子状态共享父路径
+     */
+    struct PathNode {
+        std::shared_ptr<const PathNode> parent;
+        std::string step;
+    };
+
+    /**
+     * @brief 待推进的分支状态
+     */
+    struct ExploreItem {
+        size_t line = 0;
+        GameState state;
+        std::shared_ptr<const PathNode> path;
+        size_t depth = 0;
+        bool reachedEnding = false;     // 本路径是否已达成结局
+    };
+
+    std::vector<std::string> unwindPath(const std::shared_ptr<const PathNode>& path) {
+        std::vector<std::string> steps;
+        for (const PathNode* node = path.get(); node != nullptr; node = node->parent.get()) {
+            steps.push_back(node->step);
+        }
+        return std::vector<std::string>(steps.rbegin(), steps.rend());
+    }
+
+    // ==================== 状态去重 ====================
+
+    uint64_t fnv1a(uint64_t hash, const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff;   // 分隔符，避免 "ab"+"c" 与 "a"+"bc" 相同
+        hash *= 1099511628211ULL;
+        return hash;
+    }
+
+    /**
+     * @brief 计算 (行号, 变量状态) 的哈希，选择历史不影响后续流程，不参与计算
+     */
+    uint64_t stateKey(size_t line, const GameState& state) {
+        uint64_t hash = 14695981039346656037ULL;
+        hash = fnv1a(hash, std::to_string(line));
+        const std::vector<IntSlot>& variables = state.getVariableSlots();
+        for (size_t slot = 0; slot < variables.size(); slot++) {
+            if (variables[slot].isSet) {
+                hash = fnv1a(hash, std::to_string(slot));
+                hash = fnv1a(hash, std::to_string(variables[slot].value));
+            }
+        }
+        hash = fnv1a(hash, "$");
+        const std::vector<StringSlot>& stringVars = state.getStringVariableSlots();
+        for (size_t slot = 0; slot < stringVars.size(); slot++) {
+            if (stringVars[slot].isSet) {
+                hash = fnv1a(hash, std::to_string(slot));
+                hash = fnv1a(hash, stringVars[slot].value);
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * @brief 分片加锁的已访问状态集合
+     */
+    class VisitedSet {
+    public:
+        bool insert(uint64_t key) {
+            Shard& shard = shards[key % kMemoShards];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            return shard.keys.insert(key).second;
+        }
+
+    private:
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_set<uint64_t> keys;
+        };
+        Shard shards[kMemoShards];
+    };
+
+    // ==================== 分析上下文 ====================
+
+    class Explorer {
+    public:
+        Explorer(const CompiledScript& script, const ExploreOptions& options)
+            : script(script), options(options), visitedLines(script.code.size()) {
+        }
+
+        ExploreReport run();
+
+    private:
+        void advance(ExploreItem item, std::vector<ExploreItem>& children);
+        bool enterForkPoint(const ExploreItem& item);
+        void reachEnding(const ExploreItem& item, size_t line);
+        void recordIssue(std::vector<std::pair<std::string, size_t>>& list,
+            const std::string& name, size_t line);
+        void runLevel(std::vector<ExploreItem>& frontier, std::vector<ExploreItem>& next);
+
+        const CompiledScript& script;
+        const ExploreOptions& options;
+
+        std::vector<std::atomic<bool>> visitedLines;
+        VisitedSet visitedStates;
+        std::atomic<size_t> exploredStates{ 0 };
+        std::atomic<size_t> endlessPaths{ 0 };
+        std::atomic<bool> truncated{ false };
+        std::atomic<bool> sampledRandom{ false };
+
+        std::mutex reportMutex;
+        std::map<std::string, ReachableEnding> endings;     // 已到达的结局
+        std::map<std::string, size_t> endingDepth;
+        std::vector<std::pair<std::string, size_t>> brokenJumps;
+        std::set<size_t> loopLines;
+    };
+
+    void Explorer::recordIssue(std::vector<std::pair<std::string, size_t>>& list,
+        const std::string& name, size_t line) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        std::pair<std::string, size_t> issue{ name, line + 1 };
+        if (std::find(list.begin(), list.end(), issue) == list.end()) {
+            list.push_back(issue);
+        }
+    }
+
+    bool Explorer::enterForkPoint(const ExploreItem& item) {
+        if (!visitedStates.insert(stateKey(item.line, item.state))) {
+            return false;
+        }
+        if (exploredStates.fetch_add(1) >= options.maxStates) {
+            truncated = true;
+            return false;
+        }
+        return true;
+    }
+
+    void Explorer::reachEnding(const ExploreItem& item, size_t line) {
+        const std::string& name = script.code[line].name;
+        std::lock_guard<std::mutex> lock(reportMutex);
+
+        // 逐层推进，先到达的深度最小；同层时取字典序较小的路径，保证结果稳定
+        auto it = endingDepth.find(name);
+        std::vector<std::string> path = unwindPath(item.path);
+        if (it == endingDepth.end() || item.depth < it->second ||
+            (item.depth == it->second && path < endings[name].path)) {
+            endingDepth[name] = item.depth;
+            endings[name] = { name, line + 1, std::move(path) };
+        }
+    }
+
+    /**
+     * @brief 从当前位置确定性地执行到下一个分叉点或结束
+     */
+    void Explorer::advance(ExploreItem item, std::vector<ExploreItem>& children) {
+        const std::vector<Instruction>& code = script.code;
+        GameState& state = item.state;
+        size_t steps = 0;
+
+        while (item.line < code.size()) {
+            if (++steps > kMaxSegmentSteps) {
+                std::lock_guard<std::mutex> lock(reportMutex);
+                loopLines.insert(item.line + 1);
+                return;
+            }
+
+            size_t line = item.line;
+            visitedLines[line].store(true, std::memory_order_relaxed);
+            const Instruction& instruction = code[line];
+
+            switch (instruction.op) {
+            case OpCode::END:
+                if (!item.reachedEnding) {
+                    endlessPaths++;
+                }
+                return;
+
+            case OpCode::ENDNAME:
+                if (!instruction.name.empty()) {
+                    reachEnding(item, line);
+                    item.reachedEnding = true;
+                }
+                item.line++;
+                break;
+
+            case OpCode::CHOOSE: {
+                if (!enterForkPoint(item)) {
+                    return;
+                }
+                for (const ChoiceOption& option : instruction.options) {
+                    if (option.jumpLine <= 0) {
+                        recordIssue(brokenJumps, option.label, line);
+                        continue;
+                    }
+                    ExploreItem child{ static_cast<size_t>(option.jumpLine - 1), state,
+                        std::make_shared<PathNode>(PathNode{ item.path, option.text }), item.depth + 1,
+                        item.reachedEnding };
+                    child.state.recordChoice(option.text);
+                    children.push_back(std::move(child));
+                }
+                return;
+            }
+
+            case OpCode::RANDOM: {
+                int range = instruction.value2 - instruction.value + 1;
+                if (!instruction.hasValue || range <= 0) {
+                    item.line++;
+                    break;
+                }
+                if (!enterForkPoint(item)) {
+                    return;
+                }
+
+                // 范围过大时均匀取样，包含上下限
+                int branches = range;
+                if (range > kMaxRandomBranches) {
+                    branches = kMaxRandomBranches;
+                    sampledRandom = true;
+                }
+                for (int i = 0; i < branches; i++) {
+                    int value = instruction.value;
+                    if (branches > 1) {
+                        value += static_cast<int>(static_cast<long long>(range - 1) * i / (branches - 1));
+                    }
+                    ExploreItem child{ line + 1, state,
+                        std::make_shared<PathNode>(PathNode{ item.path, instruction.name + "=" + std::to_string(value) }),
+                        item.depth + 1, item.reachedEnding };
+                    child.state.setVar(instruction.slot, value);
+                    children.push_back(std::move(child));
+                }
+                return;
+            }
+
+            case OpCode::INPUT:
+            case OpCode::AWAIT:
+                state.setStringVar(instruction.slot, "");
+                item.line++;
+                break;
+
+            case OpCode::SET: {
+                int slot = instruction.slot;
+                int value = instruction.value;
+                switch (instruction.setOp) {
+                case SetOp::ASSIGN:
+                    state.setVar(slot, value);
+                    break;
+                case SetOp::ADD:
+                    state.addVar(slot, value);
+                    break;
+                case SetOp::SUB:
+                    state.addVar(slot, -value);
+                    break;
+                case SetOp::MUL:
+                    if (state.hasVar(slot)) {
+                        state.setVar(slot, state.getVar(slot) * value);
+                    }
+                    break;
+                case SetOp::DIV:
+                    if (state.hasVar(slot) && value != 0) {
+                        state.setVar(slot, state.getVar(slot) / value);
+                    }
+                    break;
+                default:
+                    break;
+                }
+                item.line++;
+                break;
+            }
+
+            case OpCode::JUMP:
+                if (instruction.hasValue && instruction.jumpLine > 0) {
+                    item.line = instruction.jumpLine - 1;
+                }
+                else {
+                    if (instruction.hasValue) {
+                        recordIssue(brokenJumps, instruction.text, line);
+                    }
+                    item.line++;
+                }
+                break;
+
+            case OpCode::IF: {
+                if (evaluateCompiledCondition(instruction.condition, state)) {
+                    if (instruction.jumpLine > 0) {
+                        item.line = instruction.jumpLine - 1;
+                        break;
+                    }
+                    recordIssue(brokenJumps, instruction.text, line);
+                }
+                item.line++;
+                break;
+            }
+
+            default:
+                // say / wait / show / cls / plugin / use 等不影响流程
+                item.line++;
+                break;
+            }
+        }
+
+        if (!item.reachedEnding) {
+            endlessPaths++;
+        }
+    }
+
+    // ==================== 工作窃取线程池 ====================
+
+    /**
+     * @brief 并行推进一层状态
+     *
+     * 每个工作线程从自己队列的尾部取任务，空闲时从其他线程队列的头部窃取。
+     * 新产生的子状态属于下一层，各线程先收集到本地，本层结束后再合并。
+     */
+    void Explorer::runLevel(std::vector<ExploreItem>& frontier, std::vector<ExploreItem>& next) {
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<ExploreItem> items;
+        };
+
+        size_t workerCount = std::min<size_t>(options.threads, frontier.size());
+        std::vector<WorkerQueue> queues(workerCount);
+        for (size_t i = 0; i < frontier.size(); i++) {
+            queues[i % workerCount].items.push_back(std::move(frontier[i]));
+        }
+        frontier.clear();
+
+        std::vector<std::vector<ExploreItem>> results(workerCount);
+
+        auto worker = [&](size_t self) {
+            while (true) {
+                ExploreItem item;
+                bool found = false;
+                {
+                    std::lock_guard<std::mutex> lock(queues[self].mutex);
+                    if (!queues[self].items.empty()) {
+                        item = std::move(queues[self].items.back());
+                        queues[self].items.pop_back();
+                        found = true;
+                    }
+                }
+                for (size_t offset = 1; !found && offset < workerCount; offset++) {
+                    WorkerQueue& victim = queues[(self + offset) % workerCount];
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (!victim.items.empty()) {
+                        item = std::move(victim.items.front());
+                        victim.items.pop_front();
+                        found = true;
+                    }
+                }
+                // 本层任务不会再增加，所有队列为空即可退出
+                if (!found) {
+                    return;
+                }
+                advance(std::move(item), results[self]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workerCount; i++) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto& result : results) {
+            for (auto& item : result) {
+                next.push_back(std::move(item));
+            }
+        }
+    }
+
+    ExploreReport Explorer::run() {
+        std::vector<ExploreItem> frontier(1);
+        std::vector<ExploreItem> next;
+
+        while (!frontier.empty() && !truncated) {
+            runLevel(frontier, next);
+            std::swap(frontier, next);
+        }
+
+        ExploreReport report;
+        report.exploredStates = std::min(exploredStates.load(), options.maxStates);
+        report.endlessPaths = endlessPaths;
+        report.truncated = truncated;
+        report.sampledRandom = sampledRandom;
+        report.brokenJumps = brokenJumps;
+        std::sort(report.brokenJumps.begin(), report.brokenJumps.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; });
+        report.loopLines.assign(loopLines.begin(), loopLines.end());
+
+        const std::vector<Instruction>& code = script.code;
+        for (size_t i = 0; i < code.size(); i++) {
+            bool visited = visitedLines[i].load();
+            if (code[i].op == OpCode::ENDNAME && !code[i].name.empty() && !visited &&
+                endings.find(code[i].name) == endings.end()) {
+                report.unreachableEndings.push_back({ code[i].name, i + 1 });
+            }
+            if (!visited && code[i].op != OpCode::NOP) {
+                report.unreachableLines.push_back(i + 1);
+            }
+        }
+
+        // 标签指向其下一行，标签所在行之后的指令都未执行才算死标签
+        for (const auto& [label, targetLine] : script.labels) {
+            size_t labelIndex = static_cast<size_t>(targetLine - 1);
+            if (labelIndex < code.size() && !visitedLines[labelIndex].load()) {
+                report.deadLabels.push_back({ label, static_cast<size_t>(targetLine) });
+            }
+        }
+        std::sort(report.deadLabels.begin(), report.deadLabels.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; });
+
+        for (auto& [name, ending] : endings) {
+            report.reachableEndings.push_back(std::move(ending));
+        }
+        std::sort(report.reachableEndings.begin(), report.reachableEndings.end(),
+            [](const ReachableEnding& a, const ReachableEnding& b) { return a.line < b.line; });
+
+        return report;
+    }
+
+    /**
+     * @brief 将行号列表压缩为区间，如 "3-5, 9"
+     */
+    std::string formatLineRanges(const std::vector<size_t>& lines) {
+        std::string result;
+        for (size_t i = 0; i < lines.size();) {
+            size_t j = i;
+            while (j + 1 < lines.size() && lines[j + 1] == lines[j] + 1) {
+                j++;
+            }
+            if (!result.empty()) {
+                result += ", ";
+            }
+            result += std::to_string(lines[i]);
+            if (j > i) {
+                result += "-" + std::to_string(lines[j]);
+            }
+            i = j + 1;
+        }
+        return result;
+    }
+}
+
+// ==================== 命令行参数 ====================
+
+bool parseExploreArgs(int argc, char* argv[], ExploreOptions& options, std::string& error) {
+    // argv[1] 为 --explore
+    if (argc < 3) {
+        error = "用法: --explore <脚本.pgn> [--threads <n>] [--max-states <n>]";
+        return false;
+    }
+    options.scriptPath = argv[2];
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            error = "参数缺少取值: " + arg;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try {
+            if (arg == "--threads") {
+                options.threads = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--max-states") {
+                options.maxStates = static_cast<size_t>(std::stoull(value));
+            }
+            else {
+                error = "未知参数: " + arg;
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            error = "无效的参数值: " + arg + " " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ==================== 分支覆盖分析 ====================
+
+ExploreReport exploreScript(const std::vector<std::string_view>& lines, const std::string& where,
+    const ExploreOptions& options) {
+    ExploreOptions resolved = options;
+    if (resolved.threads == 0) {
+        resolved.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ScriptIndex index = buildScriptIndex(lines);
+    CompiledScript script = compileScript(lines, index, where);
+    Explorer explorer(script, resolved);
+    ExploreReport report = explorer.run();
+
+    // 同名标签只有最后一个生效，前面的跳转不到
+    report.duplicateLabels = index.duplicateLabels;
+    std::sort(report.duplicateLabels.begin(), report.duplicateLabels.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second; });
+    return report;
+}
+
+int runExplore(const ExploreOptions& options) {
+    Log(LogGrade::INFO, LogCode::GAME_START, "Explore: " + options.scriptPath);
+
+    ScriptSource source;
+    if (!source.load(options.scriptPath)) {
+        std::cerr << "错误：无法打开脚本文件 " << options.scriptPath << std::endl;
+        return 2;
+    }
+
+    fs::path scriptFile(options.scriptPath);
+    std::string where = scriptFile.parent_path().string();
+    if (!where.empty()) {
+        where += PVN_PATH_SEP;
+    }
+
+    unsigned int threads = options.threads > 0 ? options.threads
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    ExploreReport report = exploreScript(source.lines(), where, options);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+
+    size_t totalEndings = report.reachableEndings.size() + report.unreachableEndings.size();
+
+    std::cout << "==============================" << std::endl;
+    std::cout << "分支覆盖分析: " << options.scriptPath << std::endl;
+    std::cout << "线程数: " << threads << "  探索状态: " << report.exploredStates
+        << "  用时: " << elapsedMs << "ms" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    std::cout << "可达结局 (" << report.reachableEndings.size() << "/" << totalEndings << "):" << std::endl;
+    for (const auto& ending : report.reachableEndings) {
+        std::cout << "  " << ending.name << "（第 " << ending.line << " 行，"
+            << ending.path.size() << " 次选择）";
+        for (size_t i = 0; i < ending.path.size(); i++) {
+            std::cout << (i == 0 ? ": " : " > ") << ending.path[i];
+        }
+        std::cout << std::endl;
+    }
+
+    if (!report.unreachableEndings.empty()) {
+        std::cout << "不可达结局:" << std::endl;
+        for (const auto& [name, line] : report.unreachableEndings) {
+            std::cout << "  " << name << "（第 " << line << " 行）" << std::endl;
+        }
+    }
+
+    if (!report.brokenJumps.empty()) {
+        std::cout << "无效跳转目标:" << std::endl;
+        for (const auto& [target, line] : report.brokenJumps) {
+            std::cout << "  第 " << line << " 行: " << target << std::endl;
+        }
+    }
+
+    if (!report.duplicateLabels.empty()) {
+        std::cout << "被同名标签覆盖的标签:" << std::endl;
+        for (const auto& [label, line] : report.duplicateLabels) {
+            std::cout << "  " << label << "（第 " << line << " 行）" << std::endl;
+        }
+    }
+
+    if (!report.deadLabels.empty()) {
+        std::cout << "未被访问的标签:" << std::endl;
+        for (const auto& [label, line] : report.deadLabels) {
+            std::cout << "  " << label << "（第 " << line << " 行）" << std::endl;
+        }
+    }
+
+    if (!report.unreachableLines.empty()) {
+        std::cout << "不可达的行: " << formatLineRanges(report.unreachableLines) << std::endl;
+    }
+    if (!report.loopLines.empty()) {
+        std::cout << "疑似死循环: 第 " << formatLineRanges(report.loopLines) << " 行" << std::endl;
+    }
+    if (report.endlessPaths > 0) {
+        std::cout << "未达成结局即结束的路径: " << report.endlessPaths << std::endl;
+    }
+    if (report.sampledRandom) {
+        std::cout << "注意: random 范围超过 " << kMaxRandomBranches << " 个取值时只取样分析" << std::endl;
+    }
+    if (report.truncated) {
+        std::cout << "注意: 已达到状态数上限 " << options.maxStates << "，结果不完整" << std::endl;
+    }
+
+    Log(LogGrade::INFO, LogCode::GAME_START,
+        "Explore finished: " + std::to_string(report.reachableEndings.size()) + "/" +
+        std::to_string(totalEndings) + " endings reachable, " +
+        std::to_string(report.exploredStates) + " states in " + std::to_string(elapsedMs) + "ms");
+
+    return report.unreachableEndings.empty() && report.brokenJumps.empty() &&
+        report.duplicateLabels.empty() ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+﻿// explorer.h
+#pragma once
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 分支覆盖分析参数
+ *
+ * 命令行格式：--explore <脚本.pgn> [--threads <n>] [--max-states <n>]
+ */
+struct ExploreOptions {
+    std::string scriptPath;         // 要分析的脚本
+    unsigned int threads = 0;       // 工作线程数，0 表示使用硬件线程数
+    size_t maxStates = 200000;      // 最多探索的分支状态数（防止状态爆炸）
+};
+
+/**
+ * @brief 可达结局及到达它的最短选择路径
+ */
+struct ReachableEnding {
+    std::string name;
+    size_t line = 0;                        // endname 所在行（1-based）
+    std::vector<std::string> path;          // 依次做出的选择（random 记为 变量=值）
+};
+
+/**
+ * @brief 分支覆盖分析结果
+ */
+struct ExploreReport {
+    std::vector<ReachableEnding> reachableEndings;
+    std::vector<std::pair<std::string, size_t>> unreachableEndings;     // 结局名, 行号
+    std::vector<std::pair<std::string, size_t>> deadLabels;             // 标签名, 行号
+    std::vector<std::pair<std::string, size_t>> duplicateLabels;        // 被后面同名标签覆盖的标签, 行号
+    std::vector<std::pair<std::string, size_t>> brokenJumps;            // 跳转目标, 行号
+    std::vector<size_t> unreachableLines;                               // 行号（1-based）
+    std::vector<size_t> loopLines;                                      // 无选择的死循环所在行
+    size_t exploredStates = 0;      // 探索过的分支状态数
+    size_t endlessPaths = 0;        // 未达成结局即结束的路径数
+    bool truncated = false;         // 是否因状态数上限而提前停止
+    bool sampledRandom = false;     // random 范围过大时只取样部分取值
+};
+
+/**
+ * @brief 解析 --explore 之后的命令行参数
+ */
+bool parseExploreArgs(int argc, char* argv[], ExploreOptions& options, std::string& error);
+
+/**
+ * @brief 穷举脚本的所有分支
+ *
+ * 在每个 choose 和 random 处复制 GameState 分叉，按选择次数逐层扩展，
+ * 同一层的状态由工作窃取线程池并行推进，并按 (行号, 变量状态哈希) 去重。
+ * 插件和 input 不可预测，分析时视为无副作用（input 得到空字符串）。
+ */
+ExploreReport exploreScript(const std::vector<std::string_view>& lines, const std::string& where,
+    const ExploreOptions& options);
+
+/**
+ * @brief 运行分支覆盖分析并输出报告
+ * @return 0 表示所有结局可达，且没有无效跳转和重复标签
+ */
+int runExplore(const ExploreOptions& options);
+
+#endif // EXPLORER_H
@@ -1,7 +1,11 @@
 ﻿// fileutils.cpp
 #include "fileutils.h"
 #include "ui.h"
-#include <Windows.h>
+#include "platform.h"
+#include "scriptindex.h"
+#include "savefile.h"
+#include "pluginhost.h"
+#include "pluginregistry.h"
 #include <chrono>
 #include <iomanip>
 #include <sstream>
@@ -9,11 +13,14 @@
 #include <iostream>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 // 辅助函数：去除字符串两端的空白字符
 std::string trim(const std::string& str) {
     size_t first = str.find_first_not_of(" \t");
-    Log(LogGrade::DEBUG, LogCode::PERFORMANCE, "Trimming string: " + str);
+    LOG_DEBUG(LogCode::PERFORMANCE, "Trimming string: ", str);
     if (std::string::npos == first) {
         return "";
     }
@@ -21,14 +28,30 @@ std::string trim(const std::string& str) {
     return str.substr(first, (last - first + 1));
 }
 
+std::string_view firstToken(std::string_view line, std::string_view* rest) {
+    size_t start = 0;
+    while (start < line.size() && std::isspace(static_cast<unsigned char>(line[start]))) {
+        start++;
+    }
+    size_t end = start;
+    while (end < line.size() && !std::isspace(static_cast<unsigned char>(line[end]))) {
+        end++;
+    }
+    if (rest) {
+        *rest = line.substr(end);
+    }
+    return line.substr(start, end - start);
+}
+
 // ==================== 存档管理 ====================
 
 bool saveGame(const std::string& scriptPath, size_t currentLine,
-    const GameState& gameState, const std::string& saveName) {
+    const GameState& gameState, const std::string& saveName,
+    std::function<void(bool)> onComplete) {
     auto saveStartTime = std::chrono::high_resolution_clock::now();
 
-    Log(LogGrade::INFO, LogCode::GAME_SAVED,
-        "Attempting to save game: " + scriptPath + " (save name: " + saveName + ")");
+    LOG_INFO(LogCode::GAME_SAVED,
+        "Attempting to save game: ", scriptPath, " (save name: ", saveName, ")");
 
     // 构建存档路径
     fs::path scriptFilePath(scriptPath);
@@ -36,18 +59,21 @@ bool saveGame(const std::string& scriptPath, size_t currentLine,
 
     // 创建存档目录（如果不存在）
     if (!fs::exists(saveDir)) {
-        Log(LogGrade::DEBUG, LogCode::GAME_SAVED,
-            "Save directory does not exist, creating: " + saveDir.string());
+        LOG_DEBUG(LogCode::GAME_SAVED,
+            "Save directory does not exist, creating: ", saveDir.string());
         if (!fs::create_directory(saveDir)) {
             Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
                 "Failed to create save directory: " + saveDir.string());
+            if (onComplete) {
+                onComplete(false);
+            }
             return false;
         }
     }
 
     // 存档文件路径
     fs::path savePath = saveDir / (saveName + ".sav");
-    Log(LogGrade::DEBUG, LogCode::GAME_SAVED, "Save file path: " + savePath.string());
+    LOG_DEBUG(LogCode::GAME_SAVED, "Save file path: ", savePath.string());
 
     // 构建存档数据
     SaveData saveData;
@@ -58,40 +84,29 @@ bool saveGame(const std::string& scriptPath, size_t currentLine,
     // 获取当前时间
     time_t now = time(nullptr);
     tm timeInfo;
-    localtime_s(&timeInfo, &now);
+    safeLocalTime(now, timeInfo);
     char timeStr[100];
     strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeInfo);
     saveData.saveTime = timeStr;
 
-    // 序列化存档
-    std::ofstream fout(savePath);
-    if (!fout.is_open()) {
-        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-            "Cannot open save file for writing: " + savePath.string());
-        return false;
-    }
-
-    fout << "[SAVE_INFO]" << std::endl;
-    fout << "script_path=" << scriptPath << std::endl;
-    fout << "current_line=" << currentLine << std::endl;
-    fout << "save_time=" << saveData.saveTime << std::endl;
-    fout << std::endl;
-
-    // 写入游戏状态
-    std::string serializedState = gameState.serialize();
-    fout << serializedState;
-
-    size_t saveSize = fout.tellp();
-    fout.close();
-
-    auto saveEndTime = std::chrono::high_resolution_clock::now();
-    auto saveTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(saveEndTime - saveStartTime).count();
-
-    
-    Log(LogGrade::INFO, LogCode::GAME_SAVED,
-        "Game saved successfully: " + savePath.string() +
-        " (" + std::to_string(saveSize) + " bytes, took " + std::to_string(saveTimeMs) + "ms)");
+    // 二进制存档：同一存档连续保存时只追加变化部分，由后台线程写入
+    std::string savePathStr = savePath.string();
+    writeSaveFile(savePathStr, std::move(saveData), [savePathStr, saveStartTime, onComplete](bool ok, size_t saveSize) {
+        auto saveEndTime = std::chrono::high_resolution_clock::now();
+        auto saveTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(saveEndTime - saveStartTime).count();
 
+        if (ok) {
+            LOG_INFO(LogCode::GAME_SAVED,
+                "Game saved successfully: ", savePathStr,
+                " (", saveSize, " bytes, took ", saveTimeMs, "ms)");
+        }
+        else {
+            Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Game save failed: " + savePathStr);
+        }
+        if (onComplete) {
+            onComplete(ok);
+        }
+    });
     return true;
 }
 
@@ -101,6 +116,19 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
     Log(LogGrade::INFO, LogCode::GAME_LOADED,
         "Attempting to load save file: " + savePath);
 
+    if (isBinarySaveFile(savePath)) {
+        if (!readSaveFile(savePath, saveData)) {
+            return false;
+        }
+        auto loadEndTime = std::chrono::high_resolution_clock::now();
+        auto loadTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(loadEndTime - loadStartTime).count();
+        Log(LogGrade::INFO, LogCode::GAME_LOADED,
+            "Save file loaded successfully: " + savePath +
+            " (took " + std::to_string(loadTimeMs) + "ms)");
+        return true;
+    }
+
+    // 旧版文本存档
     std::ifstream fin(savePath);
     if (!fin.is_open()) {
         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
@@ -123,8 +151,8 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
     std::string data = buffer.str();
     fin.close();
 
-    Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-        "Save file read: " + std::to_string(data.length()) + " bytes");
+    LOG_DEBUG(LogCode::GAME_LOADED,
+        "Save file read: ", data.length(), " bytes");
 
     // 解析存档数据
     std::stringstream ss(data);
@@ -156,14 +184,14 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
 
                 if (key == "script_path") {
                     saveData.scriptPath = value;
-                    Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-                        "Loaded script_path: " + value);
+                    LOG_DEBUG(LogCode::GAME_LOADED,
+                        "Loaded script_path: ", value);
                 }
                 else if (key == "current_line") {
                     try {
                         saveData.currentLine = std::stoi(value);
-                        Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-                            "Loaded current_line: " + value);
+                        LOG_DEBUG(LogCode::GAME_LOADED,
+                            "Loaded current_line: ", value);
                     }
                     catch (...) {
                         Log(LogGrade::WARNING, LogCode::SAVE_CORRUPTED,
@@ -173,8 +201,8 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
                 }
                 else if (key == "save_time") {
                     saveData.saveTime = value;
-                    Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-                        "Loaded save_time: " + value);
+                    LOG_DEBUG(LogCode::GAME_LOADED,
+                        "Loaded save_time: ", value);
                 }
             }
         }
@@ -183,7 +211,7 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
     // 反序列化游戏状态
     try {
         saveData.gameState.deserialize(data);
-        Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
+        LOG_DEBUG(LogCode::GAME_LOADED,
             "Game state deserialized successfully");
     }
     catch (const std::exception& e) {
@@ -196,11 +224,11 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
     auto loadTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(loadEndTime - loadStartTime).count();
 
     // 记录解析统计
-    Log(LogGrade::DEBUG, LogCode::PERFORMANCE,
-        "Save file statistics: " + std::to_string(totalLines) + " total lines");
+    LOG_DEBUG(LogCode::PERFORMANCE,
+        "Save file statistics: ", totalLines, " total lines");
     for (const auto& [section, count] : sectionLineCounts) {
-        Log(LogGrade::DEBUG, LogCode::PERFORMANCE,
-            "  " + section + ": " + std::to_string(count) + " lines");
+        LOG_DEBUG(LogCode::PERFORMANCE,
+            "  ", section, ": ", count, " lines");
     }
 
     
@@ -211,28 +239,69 @@ bool loadGame(const std::string& savePath, SaveData& saveData) {
     return true;
 }
 
+std::vector<std::string> listSaveFiles(const std::string& scriptPath) {
+    fs::path saveDir = fs::path(scriptPath).parent_path() / "saves";
+    std::vector<std::string> saveFiles;
+
+    std::error_code ec;
+    if (!fs::is_directory(saveDir, ec)) {
+        return saveFiles;
+    }
+    for (const auto& entry : fs::directory_iterator(saveDir, ec)) {
+        std::string name = entry.path().filename().string();
+        // autosave.sav（菜单保存）和 autosave_<n>.sav（自动存档槽位）
+        if (entry.path().extension() == ".sav" && name.rfind("autosave", 0) == 0) {
+            saveFiles.push_back(entry.path().string());
+        }
+    }
+    return saveFiles;
+}
+
+std::string findLatestSave(const std::string& scriptPath) {
+    std::string latest;
+    fs::file_time_type latestTime = fs::file_time_type::min();
+    for (const auto& savePath : listSaveFiles(scriptPath)) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(savePath, ec);
+        if (!ec && (latest.empty() || mtime > latestTime)) {
+            latest = savePath;
+            latestTime = mtime;
+        }
+    }
+    return latest;
+}
+
 bool hasSaveFile(const std::string& scriptPath) {
-    fs::path scriptFilePath(scriptPath);
-    fs::path saveDir = scriptFilePath.parent_path() / "saves";
-    fs::path savePath = saveDir / "autosave.sav";
+    waitForPendingSaves();
 
-    bool exists = fs::exists(savePath);
-    Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-        "Checking save file: " + savePath.string() + " - " + (exists ? "exists" : "not found"));
+    std::string savePath = findLatestSave(scriptPath);
+    bool exists = !savePath.empty();
+    LOG_DEBUG(LogCode::GAME_LOADED,
+        "Checking save file for: ", scriptPath, " - ", (exists ? savePath : "not found"));
 
     return exists;
 }
 
 std::string getSaveInfo(const std::string& scriptPath) {
-    fs::path scriptFilePath(scriptPath);
-    fs::path saveDir = scriptFilePath.parent_path() / "saves";
-    fs::path savePath = saveDir / "autosave.sav";
+    waitForPendingSaves();
 
-    if (!fs::exists(savePath)) {
-        Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-            "Save info requested for non-existent file: " + savePath.string());
+    std::string latestSave = findLatestSave(scriptPath);
+    if (latestSave.empty()) {
+        LOG_DEBUG(LogCode::GAME_LOADED,
+            "Save info requested for game without saves: ", scriptPath);
         return "无存档";
     }
+    fs::path savePath(latestSave);
+
+    if (isBinarySaveFile(savePath.string())) {
+        SaveData saveData;
+        if (!readSaveFile(savePath.string(), saveData)) {
+            return "存档损坏";
+        }
+        LOG_DEBUG(LogCode::GAME_LOADED,
+            "Save info retrieved: ", saveData.saveTime);
+        return "存档时间: " + saveData.saveTime;
+    }
 
     // 读取存档时间
     std::ifstream fin(savePath);
@@ -246,8 +315,8 @@ std::string getSaveInfo(const std::string& scriptPath) {
     while (std::getline(fin, line)) {
         if (line.find("save_time=") != std::string::npos) {
             std::string timeStr = line.substr(10);
-            Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-                "Save info retrieved: " + timeStr);
+            LOG_DEBUG(LogCode::GAME_LOADED,
+                "Save info retrieved: ", timeStr);
             return "存档时间: " + timeStr;
         }
     }
@@ -257,6 +326,29 @@ std::string getSaveInfo(const std::string& scriptPath) {
     return "有存档";
 }
 
+// ==================== 文件指纹 ====================
+
+FileStamp getFileStamp(const std::string& path) {
+    FileStamp stamp;
+    std::error_code ec;
+    auto status = fs::status(path, ec);
+    if (ec || !fs::is_regular_file(status)) {
+        return stamp;
+    }
+
+    stamp.size = fs::file_size(path, ec);
+    if (ec) {
+        return FileStamp{};
+    }
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        return FileStamp{};
+    }
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    stamp.exists = true;
+    return stamp;
+}
+
 // ==================== 文件安全操作 ====================
 
 bool safeViewFile(const std::string& filepath) {
@@ -280,7 +372,7 @@ bool safeViewFile(const std::string& filepath) {
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/W2001.md"
         );
 
-        MessageBoxA(NULL, "错误：文件不存在", "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：文件不存在", "错误", MessageLevel::ERR);
         return false;
     }
 
@@ -318,10 +410,10 @@ bool safeViewFile(const std::string& filepath) {
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/W2001.md"
         );
 
-        MessageBoxA(NULL,
+        platform().showMessage(
             "安全限制：不允许打开此类型的文件",
             "安全警告",
-            MB_ICONWARNING | MB_OK);
+            MessageLevel::WARNING);
         return false;
     }
 
@@ -329,40 +421,32 @@ bool safeViewFile(const std::string& filepath) {
         auto filesize = fs::file_size(filepath);
         const size_t MAX_FILE_SIZE = 2000 * 1024 * 1024; // 2GB
 
-        Log(LogGrade::DEBUG, LogCode::PERFORMANCE,
-            "File size: " + std::to_string(filesize) + " bytes");
+        LOG_DEBUG(LogCode::PERFORMANCE,
+            "File size: ", filesize, " bytes");
 
         if (filesize > MAX_FILE_SIZE) {
             Log(LogGrade::WARNING, LogCode::FILE_NOT_FOUND,
                 "File size too large: " + std::to_string(filesize) + " bytes, max: " +
                 std::to_string(MAX_FILE_SIZE));
 
-            MessageBoxA(NULL,
+            platform().showMessage(
                 "文件过大，无法安全打开",
                 "安全警告",
-                MB_ICONWARNING | MB_OK);
+                MessageLevel::WARNING);
             return false;
         }
 
-        HINSTANCE result = ShellExecuteA(
-            NULL,
-            "open",
-            filepath.c_str(),
-            NULL,
-            NULL,
-            SW_SHOWNORMAL
-        );
+        std::string errorMsg;
+        bool opened = platform().openFile(filepath, errorMsg);
 
         auto fileOpenEnd = std::chrono::high_resolution_clock::now();
         auto fileOpenTime = std::chrono::duration_cast<std::chrono::milliseconds>(fileOpenEnd - fileOpenStart).count();
 
-        if ((INT_PTR)result <= 32) {
-            DWORD error = GetLastError();
+        if (!opened) {
             Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-                "Failed to open file: " + filepath + " Error code: " + std::to_string(error));
+                "Failed to open file: " + filepath + " " + errorMsg);
 
-            std::string errorMsg = "无法打开文件。错误代码: " + std::to_string(error);
-            MessageBoxA(NULL, errorMsg.c_str(), "错误", MB_ICONERROR | MB_OK);
+            platform().showMessage(errorMsg, "错误", MessageLevel::ERR);
             return false;
         }
 
@@ -389,7 +473,7 @@ void overwriteLine(const std::string& filename, int lineToOverwrite,
     if (!inputFile.is_open()) {
         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
             "Failed to open file for reading: " + filename);
-        MessageBoxA(NULL, "错误：无法读取设置文件", "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：无法读取设置文件", "错误", MessageLevel::ERR);
         return;
     }
 
@@ -400,21 +484,21 @@ void overwriteLine(const std::string& filename, int lineToOverwrite,
     }
     inputFile.close();
 
-    Log(LogGrade::DEBUG, LogCode::GAME_SAVED,
-        "File read: " + std::to_string(lines.size()) + " lines");
+    LOG_DEBUG(LogCode::GAME_SAVED,
+        "File read: ", lines.size(), " lines");
 
     if (lineToOverwrite > 0 && lineToOverwrite <= static_cast<int>(lines.size())) {
         std::string oldContent = lines[lineToOverwrite - 1];
         lines[lineToOverwrite - 1] = newContent;
-        Log(LogGrade::DEBUG, LogCode::GAME_SAVED,
-            "Line " + std::to_string(lineToOverwrite) +
-            " changed from: \"" + oldContent + "\" to: \"" + newContent + "\"");
+        LOG_DEBUG(LogCode::GAME_SAVED,
+            "Line ", lineToOverwrite,
+            " changed from: \"", oldContent, "\" to: \"", newContent, "\"");
     }
     else {
         Log(LogGrade::ERR, LogCode::MEMORY_ERROR,
             "Invalid line number: " + std::to_string(lineToOverwrite) +
             " (file has " + std::to_string(lines.size()) + " lines)");
-        MessageBoxA(NULL, "错误：行号无效", "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：行号无效", "错误", MessageLevel::ERR);
         return;
     }
 
@@ -422,7 +506,7 @@ void overwriteLine(const std::string& filename, int lineToOverwrite,
     if (!outputFile.is_open()) {
         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
             "Failed to open file for writing: " + filename);
-        MessageBoxA(NULL, "错误：无法写入设置", "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：无法写入设置", "错误", MessageLevel::ERR);
         return;
     }
 
@@ -447,14 +531,14 @@ std::vector<std::string> readCollectedEndings(const std::string& gameFolder) {
         "Reading collected endings for game: " + gameFolder);
 
     std::vector<std::string> endings;
-    std::string filepath = "Novel\\" + gameFolder + "\\data.inf";
+    std::string filepath = "Novel" PVN_PATH_SEP + gameFolder + PVN_PATH_SEP "data.inf";
 
-    Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-        "Endings file path: " + filepath);
+    LOG_DEBUG(LogCode::ENDING_SAVED,
+        "Endings file path: ", filepath);
 
     std::ifstream fin(filepath);
     if (!fin.is_open()) {
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
+        LOG_DEBUG(LogCode::ENDING_SAVED,
             "No endings file found, returning empty list");
         return endings;
     }
@@ -464,19 +548,20 @@ std::vector<std::string> readCollectedEndings(const std::string& gameFolder) {
     int endingsCount = 0;
 
     while (std::getline(fin, line)) {
+        line = platform().decodeText(line);
         if (line.empty()) continue;
 
         if (line == "[ENDINGS]") {
             inEndingsSection = true;
-            Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
+            LOG_DEBUG(LogCode::ENDING_SAVED,
                 "Found [ENDINGS] section");
             continue;
         }
 
         if (line[0] == '[' && line != "[ENDINGS]") {
             if (inEndingsSection) {
-                Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                    "Exiting [ENDINGS] section at: " + line);
+                LOG_DEBUG(LogCode::ENDING_SAVED,
+                    "Exiting [ENDINGS] section at: ", line);
             }
             inEndingsSection = false;
             continue;
@@ -485,8 +570,8 @@ std::vector<std::string> readCollectedEndings(const std::string& gameFolder) {
         if (inEndingsSection) {
             endings.push_back(line);
             endingsCount++;
-            Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                "Found ending: " + line);
+            LOG_DEBUG(LogCode::ENDING_SAVED,
+                "Found ending: ", line);
         }
     }
 
@@ -507,12 +592,12 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
     GameState& gameState) {
     auto saveStartTime = std::chrono::high_resolution_clock::now();
 
-    std::string filepath = "Novel\\" + gameFolder + "\\data.inf";
+    std::string filepath = "Novel" PVN_PATH_SEP + gameFolder + PVN_PATH_SEP "data.inf";
     Log(LogGrade::INFO, LogCode::ENDING_SAVED,
         "Saving ending: \"" + endingName + "\" for game: " + gameFolder);
 
-    Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-        "Endings file path: " + filepath);
+    LOG_DEBUG(LogCode::ENDING_SAVED,
+        "Endings file path: ", filepath);
 
     // 读取现有内容
     std::vector<std::string> lines;
@@ -520,14 +605,15 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
     if (fin.is_open()) {
         std::string line;
         while (std::getline(fin, line)) {
+            line = platform().decodeText(line);
             lines.push_back(line);
         }
         fin.close();
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Read " + std::to_string(lines.size()) + " lines from existing file");
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Read ", lines.size(), " lines from existing file");
     }
     else {
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
+        LOG_DEBUG(LogCode::ENDING_SAVED,
             "No existing endings file, will create new");
     }
 
@@ -538,16 +624,16 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
     for (size_t i = 0; i < lines.size(); i++) {
         if (lines[i] == "[ENDINGS]") {
             endingsSectionIndex = i;
-            Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                "Found [ENDINGS] section at line " + std::to_string(i + 1));
+            LOG_DEBUG(LogCode::ENDING_SAVED,
+                "Found [ENDINGS] section at line ", i + 1);
 
             // 检查是否已经记录了这个结局
             for (size_t j = i + 1; j < lines.size(); j++) {
                 if (lines[j][0] == '[') break;
                 if (lines[j] == endingName) {
                     hasEnding = true;
-                    Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                        "Ending already exists at line " + std::to_string(j + 1));
+                    LOG_DEBUG(LogCode::ENDING_SAVED,
+                        "Ending already exists at line ", j + 1);
                     break;
                 }
             }
@@ -559,8 +645,8 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
     if (endingsSectionIndex == -1) {
         lines.push_back("[ENDINGS]");
         endingsSectionIndex = lines.size() - 1;
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Created new [ENDINGS] section at line " + std::to_string(endingsSectionIndex + 1));
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Created new [ENDINGS] section at line ", endingsSectionIndex + 1);
     }
 
     // 如果还没有记录这个结局，添加它
@@ -571,8 +657,8 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
         }
 
         lines.insert(lines.begin() + insertPos, endingName);
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Inserted ending at line " + std::to_string(insertPos + 1));
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Inserted ending at line ", insertPos + 1);
 
         // 保存到文件
         std::ofstream fout(filepath);
@@ -600,131 +686,80 @@ void saveEnding(const std::string& gameFolder, const std::string& endingName,
         }
     }
     else {
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Ending already exists, skipping save: " + endingName);
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Ending already exists, skipping save: ", endingName);
     }
 }
 
-void loadAllEndings(const std::vector<std::string>& lines, GameState& gameState) {
-    auto loadStartTime = std::chrono::high_resolution_clock::now();
+// ==================== 脚本文件 ====================
 
-    Log(LogGrade::INFO, LogCode::ENDING_SAVED,
-        "Loading all endings from script");
+bool ScriptSource::load(const std::string& scriptPath) {
+    buffer.clear();
+    lineIndex.clear();
 
-    int endingsCount = 0;
-    int lineNumber = 0;
+    std::ifstream in(scriptPath, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
 
-    for (const auto& line : lines) {
-        lineNumber++;
-        std::stringstream ss(line);
-        std::string cmd;
-        ss >> cmd;
+    // 一次读入整个文件
+    std::error_code ec;
+    auto fileSize = fs::file_size(scriptPath, ec);
+    std::string raw;
+    if (!ec) {
+        raw.resize(static_cast<size_t>(fileSize));
+        in.read(raw.data(), static_cast<std::streamsize>(raw.size()));
+        raw.resize(static_cast<size_t>(in.gcount()));
+    }
+    else {
+        raw.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    buffer = platform().decodeText(std::move(raw));
 
-        if (cmd == "endname" || cmd == "ENDNAME") {
-            std::string endingName;
-            std::getline(ss, endingName);
+    // memchr 由标准库按向量指令实现，一遍扫描定位所有换行符
+    const char* data = buffer.data();
+    const char* end = data + buffer.size();
+    lineIndex.reserve(buffer.size() / 32 + 1);
 
-            size_t start = endingName.find_first_not_of(" ");
-            if (start != std::string::npos) {
-                endingName = endingName.substr(start);
-            }
+    const char* lineStart = data;
+    while (lineStart < end) {
+        const char* newline = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart));
+        const char* lineEnd = newline ? newline : end;
 
-            size_t end = endingName.find_last_not_of(" \t\r");
-            if (end != std::string::npos) {
-                endingName = endingName.substr(0, end + 1);
-            }
+        size_t length = lineEnd - lineStart;
+        if (length > 0 && lineStart[length - 1] == '\r') {
+            length--;
+        }
+        lineIndex.emplace_back(lineStart, length);
 
-            if (!endingName.empty()) {
-                gameState.registerEnding(endingName);
-                endingsCount++;
-                Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                    "Registered ending at line " + std::to_string(lineNumber) +
-                    ": \"" + endingName + "\"");
-            }
+        if (!newline) {
+            break;
         }
+        lineStart = newline + 1;
     }
-
-    auto loadEndTime = std::chrono::high_resolution_clock::now();
-    auto loadTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(loadEndTime - loadStartTime).count();
-
-    
-
-    Log(LogGrade::INFO, LogCode::ENDING_SAVED,
-        "Registered " + std::to_string(endingsCount) + " total endings from script" +
-        " (took " + std::to_string(loadTimeMs) + "ms)");
+    return true;
 }
 
 // ==================== 游戏统计 ====================
 
 int countTotalEndingsInScript(const std::string& scriptPath) {
-    auto countStartTime = std::chrono::high_resolution_clock::now();
-
     Log(LogGrade::INFO, LogCode::ENDING_SAVED,
         "Counting total endings in script: " + scriptPath);
 
-    std::set<std::string> uniqueEndings;
-
-    std::ifstream in(scriptPath);
-    if (!in.is_open()) {
+    ScriptIndex index;
+    if (!indexScriptFile(scriptPath, index)) {
         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
             "Cannot open script file: " + scriptPath);
         return 0;
     }
 
-    std::string line;
-    int lineNum = 0;
-    while (std::getline(in, line)) {
-        lineNum++;
-
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-
-        if (line.empty() || line[0] == '/' || line[0] == '#') {
-            continue;
-        }
-
-        std::stringstream ss(line);
-        std::string cmd;
-        ss >> cmd;
-
-        if (cmd == "endname" || cmd == "ENDNAME") {
-            std::string endingName;
-            std::getline(ss, endingName);
-
-            size_t start = endingName.find_first_not_of(" \t");
-            if (start != std::string::npos) {
-                endingName = endingName.substr(start);
-            }
-
-            size_t end = endingName.find_last_not_of(" \t\r");
-            if (end != std::string::npos) {
-                endingName = endingName.substr(0, end + 1);
-            }
-
-            if (!endingName.empty()) {
-                uniqueEndings.insert(endingName);
-                Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                    "Found ending at line " + std::to_string(lineNum) +
-                    ": \"" + endingName + "\"");
-            }
-        }
-    }
-    in.close();
-
-    auto countEndTime = std::chrono::high_resolution_clock::now();
-    auto countTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(countEndTime - countStartTime).count();
-
-   
-
     Log(LogGrade::INFO, LogCode::ENDING_SAVED,
-        "Found " + std::to_string(uniqueEndings.size()) + " unique endings in script: " + scriptPath +
-        " (took " + std::to_string(countTimeMs) + "ms)");
+        "Found " + std::to_string(index.totalEndings()) + " unique endings in script: " + scriptPath);
 
-    return uniqueEndings.size();
+    return index.totalEndings();
 }
 
-std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
+std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath, int totalEndings) {
     auto statsStartTime = std::chrono::high_resolution_clock::now();
 
     Log(LogGrade::INFO, LogCode::ENDING_SAVED,
@@ -737,11 +772,12 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
     std::string endingsFileNew = gameFolderPath + "endings.dat";
     std::ifstream finNew(endingsFileNew);
     if (finNew.is_open()) {
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Reading from new endings format: " + endingsFileNew);
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Reading from new endings format: ", endingsFileNew);
 
         std::string line;
         while (std::getline(finNew, line)) {
+            line = platform().decodeText(line);
             if (!line.empty() && line.back() == '\r') {
                 line.pop_back();
             }
@@ -751,8 +787,8 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
             }
         }
         finNew.close();
-        Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-            "Found " + std::to_string(collected) + " endings in new format");
+        LOG_DEBUG(LogCode::ENDING_SAVED,
+            "Found ", collected, " endings in new format");
     }
 
     // 方法2：如果新系统没有数据，尝试从 data.inf 读取（兼容旧系统）
@@ -760,13 +796,14 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
         std::string endingsFileOld = gameFolderPath + "data.inf";
         std::ifstream finOld(endingsFileOld);
         if (finOld.is_open()) {
-            Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                "Reading from legacy endings format: " + endingsFileOld);
+            LOG_DEBUG(LogCode::ENDING_SAVED,
+                "Reading from legacy endings format: ", endingsFileOld);
 
             std::string line;
             bool inEndingsSection = false;
 
             while (std::getline(finOld, line)) {
+                line = platform().decodeText(line);
                 if (!line.empty() && line.back() == '\r') {
                     line.pop_back();
                 }
@@ -788,17 +825,22 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
                 }
             }
             finOld.close();
-            Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-                "Found " + std::to_string(collected) + " endings in legacy format");
+            LOG_DEBUG(LogCode::ENDING_SAVED,
+                "Found ", collected, " endings in legacy format");
         }
     }
 
-    // 统计总结局数
-    for (const auto& entry : fs::directory_iterator(gameFolderPath)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".pgn") {
-            std::string pgnFile = entry.path().string();
-            total = countTotalEndingsInScript(pgnFile);
-            break;
+    // 统计总结局数（调用方已有脚本索引时直接使用）
+    if (totalEndings >= 0) {
+        total = totalEndings;
+    }
+    else {
+        for (const auto& entry : fs::directory_iterator(gameFolderPath)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".pgn") {
+                std::string pgnFile = entry.path().string();
+                total = countTotalEndingsInScript(pgnFile);
+                break;
+            }
         }
     }
 
@@ -823,10 +865,10 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
 
     
 
-    Log(LogGrade::DEBUG, LogCode::ENDING_SAVED,
-        "Collected: " + std::to_string(collected) +
-        ", Total: " + std::to_string(total) +
-        " (took " + std::to_string(statsTimeMs) + "ms)");
+    LOG_DEBUG(LogCode::ENDING_SAVED,
+        "Collected: ", collected,
+        ", Total: ", total,
+        " (took ", statsTimeMs, "ms)");
 
     return { collected, total };
 }
@@ -834,164 +876,23 @@ std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath) {
 std::string getGameFolderName(const std::string& fullPath) {
     fs::path path(fullPath);
     std::string folderName = path.filename().string();
-    Log(LogGrade::DEBUG, LogCode::GAME_LOADED,
-        "Extracted folder name: " + folderName + " from path: " + fullPath);
+    LOG_DEBUG(LogCode::GAME_LOADED,
+        "Extracted folder name: ", folderName, " from path: ", fullPath);
     return folderName;
 }
 
 // ==================== 插件管理 ====================
 
 std::vector<PluginInfo> readInstalledPlugins() {
-    auto pluginsReadStart = std::chrono::high_resolution_clock::now();
-
-    std::vector<PluginInfo> plugins;
-    std::string pluginsDir = "Plugins";
-
-    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
-        "Reading installed plugins from: " + pluginsDir);
-
-    if (!fs::exists(pluginsDir)) {
-        Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
-            "Plugins directory does not exist: " + pluginsDir);
-        return plugins;
-    }
-
-    int pluginsFound = 0;
-    int pluginsLoaded = 0;
-
-    try {
-        for (const auto& entry : fs::directory_iterator(pluginsDir)) {
-            if (entry.is_directory()) {
-                pluginsFound++;
-                std::string pluginName = entry.path().filename().string();
-                std::string aboutFilePath = entry.path().string() + "\\about.cfg";
-
-                Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-                    "Checking plugin: " + pluginName + " at " + entry.path().string());
-
-                if (fs::exists(aboutFilePath)) {
-                    PluginInfo plugin;
-                    plugin.name = pluginName;
-
-                    std::ifstream aboutFile(aboutFilePath);
-                    if (aboutFile.is_open()) {
-                        int configLines = 0;
-                        std::string line;
-
-                        while (std::getline(aboutFile, line)) {
-                            configLines++;
-                            std::string trimmedLine = trim(line);
-                            if (trimmedLine.empty() || trimmedLine[0] == '#') {
-                                continue;
-                            }
-
-                            size_t equalsPos = trimmedLine.find('=');
-                            if (equalsPos == std::string::npos) {
-                                continue;
-                            }
-
-                            std::string key = trim(trimmedLine.substr(0, equalsPos));
-                            std::string value = trim(trimmedLine.substr(equalsPos + 1));
-
-                            if (value.length() >= 2 &&
-                                ((value.front() == '"' && value.back() == '"') ||
-                                    (value.front() == '\'' && value.back() == '\''))) {
-                                value = value.substr(1, value.length() - 2);
-                            }
-
-                            if (key == "RunCommand") {
-                                plugin.runCommand = value;
-                            }
-                            else if (key == "RunFile") {
-                                plugin.runFile = value;
-                            }
-                            else if (key == "Description") {
-                                plugin.description = value;
-                            }
-                            else if (key == "Version") {
-                                plugin.version = value;
-                            }
-                            else if (key == "Author") {
-                                plugin.author = value;
-                            }
-                        }
-                        aboutFile.close();
-
-                        Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-                            "Plugin " + pluginName + " config: " +
-                            std::to_string(configLines) + " lines, " +
-                            "RunCommand=" + plugin.runCommand + ", " +
-                            "RunFile=" + plugin.runFile);
-
-                        if (!plugin.runCommand.empty() && !plugin.runFile.empty()) {
-                            plugins.push_back(plugin);
-                            pluginsLoaded++;
-                            Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
-                                "Plugin loaded: " + pluginName +
-                                (plugin.version.empty() ? "" : " v" + plugin.version));
-                        }
-                        else {
-                            Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
-                                "Plugin " + pluginName +
-                                " missing required fields (RunCommand or RunFile)");
-                        }
-                    }
-                    else {
-                        Log(LogGrade::WARNING, LogCode::FILE_OPEN_FAILED,
-                            "Cannot open about.cfg for plugin: " + pluginName);
-                    }
-                }
-                else {
-                    Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
-                        "Plugin " + pluginName + " missing about.cfg file");
-                }
-            }
-        }
-    }
-    catch (const std::exception& e) {
-        Log(LogGrade::ERR, LogCode::MEMORY_ERROR,
-            "Error reading plugins directory: " + std::string(e.what()));
-
-        formatErrorOutput(
-            logCodeToString(LogCode::MEMORY_ERROR),
-            "FileSystemError",
-            "Cannot read plugins directory",
-            "",
-            0,
-            std::string::npos,
-            "Check if the Plugins directory is accessible and not corrupted",
-            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3007.md"
-        );
-
-        MessageBoxA(NULL, "读取插件目录时出错", "错误", MB_ICONERROR | MB_OK);
-    }
-
-    auto pluginsReadEnd = std::chrono::high_resolution_clock::now();
-    auto pluginsReadTime = std::chrono::duration_cast<std::chrono::milliseconds>(pluginsReadEnd - pluginsReadStart).count();
-
-   
-
-    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
-        "Total plugins found: " + std::to_string(pluginsFound) +
-        ", loaded: " + std::to_string(pluginsLoaded) +
-        " (took " + std::to_string(pluginsReadTime) + "ms)");
-
-    return plugins;
+    return PluginRegistry::instance().list();
 }
 
 bool hasPlugin(const std::string& pluginName) {
-    std::string pluginDir = "Plugins\\" + pluginName;
-    bool exists = fs::exists(pluginDir);
-
-    Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-        "Checking plugin existence: " + pluginName +
-        " - " + (exists ? "found" : "not found"));
-
-    return exists;
+    return PluginRegistry::instance().has(pluginName);
 }
 
 std::string getPluginFullCommand(const PluginInfo& plugin) {
-    std::string pluginPath = "Plugins\\" + plugin.name + "\\";
+    std::string pluginPath = "Plugins" PVN_PATH_SEP + plugin.name + PVN_PATH_SEP;
     std::string fullCommand = plugin.runCommand;
 
     if (plugin.runCommand.find(' ') == std::string::npos &&
@@ -1000,34 +901,70 @@ std::string getPluginFullCommand(const PluginInfo& plugin) {
 
         std::string possibleExe = pluginPath + plugin.runCommand + ".exe";
         if (fs::exists(possibleExe)) {
-            Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-                "Found executable at: " + possibleExe);
+            LOG_DEBUG(LogCode::PLUGIN_LOADED,
+                "Found executable at: ", possibleExe);
             fullCommand = possibleExe;
         }
     }
 
     fullCommand += " " + pluginPath + plugin.runFile;
 
-    Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-        "Built plugin command: " + fullCommand);
+    LOG_DEBUG(LogCode::PLUGIN_LOADED,
+        "Built plugin command: ", fullCommand);
 
     return fullCommand;
 }
 
 // ==================== 插件运行 ====================
 
-bool runPlugin(const std::string& pluginName, const std::string& runArgs) {
-    auto pluginStartTime = std::chrono::high_resolution_clock::now();
+void reportPluginError(const std::string& pluginName, const std::string& errorMessage) {
+    Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED,
+        "Plugin call failed: " + pluginName + ": " + errorMessage);
+
+    formatErrorOutput(
+        logCodeToString(LogCode::PLUGIN_EXEC_FAILED),
+        "PluginError",
+        "Plugin call failed: " + errorMessage,
+        "",
+        0,
+        std::string::npos,
+        "Check that the plugin finishes within Timeout and, in worker mode, answers length-prefixed JSON requests on stdout",
+        "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3006.md"
+    );
+
+    platform().showMessage("插件执行失败：" + errorMessage,
+        "错误", MessageLevel::ERR);
+}
 
-    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
-        "Attempting to run plugin: " + pluginName +
-        (runArgs.empty() ? "" : " with args: \"" + runArgs + "\""));
+namespace {
+    /**
+     * @brief 捕获输出运行插件（worker / native 模式或 Output = vars），
+     * 显示输出文本并把返回的变量写入游戏状态
+     */
+    bool runCapturedPlugin(const PluginInfo& pluginInfo, const std::string& runArgs, GameState* gameState) {
+        auto callStart = std::chrono::high_resolution_clock::now();
 
-    std::string pluginDir = "Plugins\\" + pluginName;
+        PluginResult result = PluginHost::instance().run(pluginInfo, runArgs, gameState);
 
-    if (!fs::exists(pluginDir)) {
+        auto callTime = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - callStart).count();
+
+        if (!finishPluginCall(result, gameState)) {
+            return false;
+        }
+
+        LOG_DEBUG(LogCode::PLUGIN_LOADED,
+            "Captured plugin call finished: ", pluginInfo.name, " (took ", callTime, "us)");
+        return true;
+    }
+}
+
+bool resolvePlugin(const std::string& pluginName, PluginInfo& pluginInfo) {
+    // 插件信息来自注册表，不再每次调用都读取 about.cfg
+    PluginRecord record;
+    if (!PluginRegistry::instance().lookup(pluginName, record)) {
         Log(LogGrade::ERR, LogCode::PLUGIN_MISSING,
-            "Plugin directory not found: " + pluginDir);
+            "Plugin directory not found: Plugins" PVN_PATH_SEP + pluginName);
 
         formatErrorOutput(
             logCodeToString(LogCode::PLUGIN_MISSING),
@@ -1040,13 +977,14 @@ bool runPlugin(const std::string& pluginName, const std::string& runArgs) {
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/W2002.md"
         );
 
-        MessageBoxA(NULL, ("错误：插件目录不存在 - " + pluginName).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：插件目录不存在 - " + pluginName,
+            "错误", MessageLevel::ERR);
         return false;
     }
 
-    std::string aboutFilePath = pluginDir + "\\about.cfg";
-    if (!fs::exists(aboutFilePath)) {
+    pluginInfo = record.info;
+
+    if (!record.hasConfig) {
         Log(LogGrade::ERR, LogCode::PLUGIN_MISSING,
             "about.cfg file not found for plugin: " + pluginName);
 
@@ -1061,93 +999,58 @@ bool runPlugin(const std::string& pluginName, const std::string& runArgs) {
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/W2002.md"
         );
 
-        MessageBoxA(NULL, ("错误：插件配置文件缺失 - " + pluginName).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：插件配置文件缺失 - " + pluginName,
+            "错误", MessageLevel::ERR);
         return false;
     }
 
-    PluginInfo pluginInfo;
-    pluginInfo.name = pluginName;
-
-    std::ifstream aboutFile(aboutFilePath);
-    if (!aboutFile.is_open()) {
-        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-            "Cannot open about.cfg for plugin: " + pluginName);
-        MessageBoxA(NULL, ("错误：无法读取插件配置 - " + pluginName).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
-        return false;
-    }
-
-    std::string line;
-    bool hasRunCommand = false;
-    bool hasRunFile = false;
-    int configLines = 0;
-
-    while (std::getline(aboutFile, line)) {
-        configLines++;
-        std::string trimmedLine = trim(line);
-        if (trimmedLine.empty() || trimmedLine[0] == '#') {
-            continue;
-        }
-
-        size_t equalsPos = trimmedLine.find('=');
-        if (equalsPos == std::string::npos) {
-            continue;
-        }
-
-        std::string key = trim(trimmedLine.substr(0, equalsPos));
-        std::string value = trim(trimmedLine.substr(equalsPos + 1));
-
-        if (value.length() >= 2 &&
-            ((value.front() == '"' && value.back() == '"') ||
-                (value.front() == '\'' && value.back() == '\''))) {
-            value = value.substr(1, value.length() - 2);
-        }
-
-        if (key == "RunCommand") {
-            pluginInfo.runCommand = value;
-            hasRunCommand = true;
-        }
-        else if (key == "RunFile") {
-            pluginInfo.runFile = value;
-            hasRunFile = true;
-        }
-        else if (key == "Description") {
-            pluginInfo.description = value;
-        }
-    }
-    aboutFile.close();
-
-    Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-        "Plugin " + pluginName + " config: " + std::to_string(configLines) + " lines");
-
-    if (!hasRunCommand) {
+    if (!record.hasRunCommand) {
         Log(LogGrade::ERR, LogCode::PLUGIN_MISSING,
             "Plugin " + pluginName + " missing RunCommand in about.cfg");
-        MessageBoxA(NULL, ("错误：插件配置缺少RunCommand - " + pluginName).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：插件配置缺少RunCommand - " + pluginName,
+            "错误", MessageLevel::ERR);
         return false;
     }
 
-    if (!hasRunFile) {
+    if (!record.hasRunFile) {
         Log(LogGrade::ERR, LogCode::PLUGIN_MISSING,
             "Plugin " + pluginName + " missing RunFile in about.cfg");
-        MessageBoxA(NULL, ("错误：插件配置缺少RunFile - " + pluginName).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：插件配置缺少RunFile - " + pluginName,
+            "错误", MessageLevel::ERR);
         return false;
     }
 
     if (pluginInfo.runCommand == ".exe" || pluginInfo.runCommand == "bin" || pluginInfo.runCommand == "/") {
         pluginInfo.runCommand = "";
-        Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
+        LOG_DEBUG(LogCode::PLUGIN_LOADED,
             "Empty RunCommand detected, using direct execution");
     }
 
+    return true;
+}
+
+bool runPlugin(const std::string& pluginName, const std::string& runArgs, GameState* gameState) {
+    auto pluginStartTime = std::chrono::high_resolution_clock::now();
+
+    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+        "Attempting to run plugin: " + pluginName +
+        (runArgs.empty() ? "" : " with args: \"" + runArgs + "\""));
+
+    PluginInfo pluginInfo;
+    if (!resolvePlugin(pluginName, pluginInfo)) {
+        return false;
+    }
+    std::string pluginDir = "Plugins" PVN_PATH_SEP + pluginInfo.name;
+
+    if (pluginInfo.mode != PluginMode::CONSOLE || pluginInfo.output == PluginOutput::VARS) {
+        return runCapturedPlugin(pluginInfo, runArgs, gameState);
+    }
+
     std::string fullCommand;
     fs::path runFilePath(pluginInfo.runFile);
 
     if (runFilePath.is_relative()) {
-        fullCommand = pluginInfo.runCommand + " " + pluginDir + "\\" + pluginInfo.runFile;
+        fullCommand = pluginInfo.runCommand + " " + pluginDir + PVN_PATH_SEP + pluginInfo.runFile;
     }
     else {
         fullCommand = pluginInfo.runCommand + " " + pluginInfo.runFile;
@@ -1157,8 +1060,8 @@ bool runPlugin(const std::string& pluginName, const std::string& runArgs) {
         fullCommand += " " + runArgs;
     }
 
-    Log(LogGrade::DEBUG, LogCode::PLUGIN_LOADED,
-        "Executing plugin command: " + fullCommand);
+    LOG_DEBUG(LogCode::PLUGIN_LOADED,
+        "Executing plugin command: ", fullCommand);
 
     int result = system(fullCommand.c_str());
 
@@ -1188,195 +1091,8 @@ bool runPlugin(const std::string& pluginName, const std::string& runArgs) {
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3006.md"
         );
 
-        MessageBoxA(NULL, ("插件执行失败，错误代码: " + std::to_string(result)).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("插件执行失败，错误代码: " + std::to_string(result),
+            "错误", MessageLevel::ERR);
         return false;
     }
 }
-
-// ==================== 配置文件 ====================
-
-std::string readCfg(const std::string& key) {
-    auto cfgReadStart = std::chrono::high_resolution_clock::now();
-
-    const std::string filename = "data.cfg";
-
-    Log(LogGrade::INFO, LogCode::GAME_START,
-        "Reading configuration key: " + key + " from " + filename);
-
-    std::ifstream inFile(filename);
-    if (!inFile.is_open()) {
-        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-            "Failed to open configuration file: " + filename);
-
-        formatErrorOutput(
-            logCodeToString(LogCode::FILE_OPEN_FAILED),
-            "FileError",
-            "Cannot open configuration file",
-            "",
-            0,
-            std::string::npos,
-            "Make sure data.cfg exists in the application directory",
-            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3004.md"
-        );
-
-        MessageBoxA(NULL, ("错误：无法打开配置文件\n" + filename).c_str(),
-            "文件错误", MB_ICONERROR | MB_OK);
-        return "";
-    }
-
-    std::string line;
-    int lineNum = 0;
-    std::string value;
-
-    while (std::getline(inFile, line)) {
-        lineNum++;
-        std::string trimmedLine = trim(line);
-
-        if (trimmedLine.empty() || trimmedLine[0] == '#' || trimmedLine[0] == ';') {
-            continue;
-        }
-
-        size_t equalsPos = trimmedLine.find('=');
-        if (equalsPos == std::string::npos) {
-            Log(LogGrade::DEBUG, LogCode::GAME_START,
-                "Skipping line " + std::to_string(lineNum) + ": no equals sign");
-            continue;
-        }
-
-        std::string currentKey = trim(trimmedLine.substr(0, equalsPos));
-
-        if (currentKey == key) {
-            value = trim(trimmedLine.substr(equalsPos + 1));
-
-            if (value.length() >= 2 &&
-                ((value.front() == '"' && value.back() == '"') ||
-                    (value.front() == '\'' && value.back() == '\''))) {
-                value = value.substr(1, value.length() - 2);
-            }
-
-            Log(LogGrade::INFO, LogCode::GAME_START,
-                "Found key: " + key + " = \"" + value + "\" at line " + std::to_string(lineNum));
-            break;
-        }
-    }
-
-    inFile.close();
-
-    auto cfgReadEnd = std::chrono::high_resolution_clock::now();
-    auto cfgReadTime = std::chrono::duration_cast<std::chrono::milliseconds>(cfgReadEnd - cfgReadStart).count();
-
-    if (value.empty()) {
-        Log(LogGrade::WARNING, LogCode::FILE_NOT_FOUND,
-            "Key not found in configuration file: " + key +
-            " (scanned " + std::to_string(lineNum) + " lines, took " +
-            std::to_string(cfgReadTime) + "ms)");
-
-        formatErrorOutput(
-            logCodeToString(LogCode::FILE_NOT_FOUND),
-            "ConfigError",
-            "Configuration key not found",
-            "",
-            0,
-            std::string::npos,
-            "Add '" + key + " = value' to data.cfg file",
-            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/W2001.md"
-        );
-
-        MessageBoxA(NULL, ("错误：配置项未找到\n键名: " + key).c_str(),
-            "配置错误", MB_ICONWARNING | MB_OK);
-    }
-    else {
-        
-    }
-
-    return value;
-}
-
-void updateFirstRunFlag(bool value) {
-    auto updateStartTime = std::chrono::high_resolution_clock::now();
-
-    Log(LogGrade::INFO, LogCode::GAME_SAVED,
-        "Updating FirstRunFlag in configuration file to: " + std::string(value ? "1" : "0"));
-
-    const std::string filename = "data.cfg";
-    const std::string targetKey = "FirstRunFlag";
-
-    std::ifstream inFile(filename);
-    if (!inFile.is_open()) {
-        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-            "Failed to open configuration file for reading: " + filename);
-        MessageBoxA(NULL, ("错误：无法打开文件 " + filename).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
-        return;
-    }
-
-    std::vector<std::string> lines;
-    std::string line;
-    bool keyFound = false;
-    int lineNum = 0;
-
-    while (std::getline(inFile, line)) {
-        lineNum++;
-        if (line.find(targetKey) != std::string::npos) {
-            size_t equalsPos = line.find('=');
-            if (equalsPos != std::string::npos) {
-                std::string newLine = line.substr(0, equalsPos + 1);
-                newLine += " ";
-                newLine += (value ? "1" : "0");
-
-                lines.push_back(newLine);
-                keyFound = true;
-
-                Log(LogGrade::DEBUG, LogCode::GAME_SAVED,
-                    "Updated FirstRunFlag at line " + std::to_string(lineNum) +
-                    " from \"" + line + "\" to \"" + newLine + "\"");
-            }
-            else {
-                lines.push_back(line);
-                Log(LogGrade::WARNING, LogCode::SAVE_CORRUPTED,
-                    "Found FirstRunFlag line without equals sign at line " +
-                    std::to_string(lineNum));
-            }
-        }
-        else {
-            lines.push_back(line);
-        }
-    }
-
-    inFile.close();
-
-    if (!keyFound) {
-        Log(LogGrade::INFO, LogCode::GAME_SAVED,
-            "FirstRunFlag not found in file, appending at end");
-        lines.push_back(targetKey + " = " + (value ? "1" : "0"));
-    }
-
-    std::ofstream outFile(filename);
-    if (!outFile.is_open()) {
-        Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED,
-            "Failed to open configuration file for writing: " + filename);
-        MessageBoxA(NULL, ("错误：无法写入文件 " + filename).c_str(),
-            "错误", MB_ICONERROR | MB_OK);
-        return;
-    }
-
-    size_t bytesWritten = 0;
-    for (const auto& l : lines) {
-        outFile << l << std::endl;
-        bytesWritten += l.length() + 2;
-    }
-    outFile.close();
-
-    auto updateEndTime = std::chrono::high_resolution_clock::now();
-    auto updateTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(updateEndTime - updateStartTime).count();
-
-    
-
-    Log(LogGrade::INFO, LogCode::GAME_SAVED,
-        "Configuration file updated successfully. FirstRunFlag = " + std::string(value ? "1" : "0") +
-        " (" + std::to_string(bytesWritten) + " bytes written, took " +
-        std::to_string(updateTimeMs) + "ms)");
-
-    return;
-}
\ No newline at end of file
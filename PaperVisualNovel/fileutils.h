@@ -4,66 +4,143 @@
 #define FILEUTILS_H
 
 #include "gamestate.h"
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 
 namespace fs = std::filesystem;
 
 
-// Ϣṹ
+// 插件运行方式
+enum class PluginMode {
+    CONSOLE,    // 每次调用启动一次进程，直接输出到控制台（默认）
+    WORKER,     // 常驻工作进程，通过管道交换 JSON 消息（见 pluginhost.h）
+    NATIVE      // 进程内加载的动态库（RunCommand = native，见 nativeplugin.h）
+};
+
+// 插件标准输出的处理方式（console 模式）
+enum class PluginOutput {
+    CONSOLE,    // 直接显示在控制台（默认）
+    VARS        // 捕获后解析为变量赋值（JSON 对象或 name=value 行），其余行照常显示
+};
+
+// 插件信息结构体
 struct PluginInfo {
-    std::string name;          // ļ
-    std::string runCommand;    //  "python"
-    std::string runFile;       // ļ "test.py"
-    std::string description;   // ѡ
-    std::string version;       // 汾ѡ
-    std::string author;        // ߣѡ
+    std::string name;          // 插件文件夹名
+    std::string runCommand;    // 运行命令（如 "python"，原生插件为 "native"）
+    std::string runFile;       // 运行文件（如 "test.py"，原生插件为动态库）
+    std::string description;   // 插件描述（可选）
+    std::string version;       // 插件版本（可选）
+    std::string author;        // 作者（可选）
+    PluginMode mode = PluginMode::CONSOLE;  // 运行方式（Mode = console / worker）
+    PluginOutput output = PluginOutput::CONSOLE;    // 标准输出的处理方式（Output = console / vars）
+    int timeoutMs = 10000;     // worker 模式单次调用的超时时间（Timeout，毫秒）
 };
 
 /**
- * @brief ָ
- * @param pluginName ƣļ
- * @param runArgs вѡ
- * @return trueʾɹִУfalseʾʧ
+ * @brief 运行指定插件
+ * @param pluginName 插件名称（文件夹名）
+ * @param runArgs 运行参数（可选）
+ * @param gameState 插件返回的变量写入的游戏状态（可选，为空时忽略返回的变量）
+ * @return true表示成功执行，false表示失败
  */
-bool runPlugin(const std::string& pluginName, const std::string& runArgs = "");
+bool runPlugin(const std::string& pluginName, const std::string& runArgs = "",
+    GameState* gameState = nullptr);
+
+/**
+ * @brief 从插件注册表取出可运行的插件信息，插件缺失或配置不完整时报告错误
+ * @return 插件可以运行时返回 true
+ */
+bool resolvePlugin(const std::string& pluginName, PluginInfo& pluginInfo);
+
+// 报告插件调用失败（日志、错误提示和消息框）
+void reportPluginError(const std::string& pluginName, const std::string& errorMessage);
 
 
 std::string trim(const std::string& str);
 
-// 
+// 取出行首的命令字（空白规则与 stringstream >> 相同），rest 返回其后的剩余部分
+std::string_view firstToken(std::string_view line, std::string_view* rest = nullptr);
+
+// 插件管理函数（查询 PluginRegistry，不重复读取 about.cfg）
 std::vector<PluginInfo> readInstalledPlugins();
 bool hasPlugin(const std::string& pluginName);
 std::string getPluginFullCommand(const PluginInfo& plugin);
 
-// 浵
+// 存档管理
+// 存档在后台线程写入，返回值只表示是否已提交（存档目录无法创建时为 false）；
+// onComplete 总会被调用一次，收到写入是否成功（写完时在写入线程上调用）
 bool saveGame(const std::string& scriptPath, size_t currentLine,
-    const GameState& gameState, const std::string& saveName = "autosave");
+    const GameState& gameState, const std::string& saveName = "autosave",
+    std::function<void(bool)> onComplete = nullptr);
 
 bool hasSaveFile(const std::string& scriptPath);
 std::string getSaveInfo(const std::string& scriptPath);
+// 游戏的全部存档（菜单保存的 autosave 和自动存档槽位 autosave_<n>）
+std::vector<std::string> listSaveFiles(const std::string& scriptPath);
+// 修改时间最新的存档路径，没有存档时返回空字符串
+std::string findLatestSave(const std::string& scriptPath);
+
+/**
+ * @brief 文件指纹（用于判断缓存是否过期）
+ */
+struct FileStamp {
+    bool exists = false;
+    uintmax_t size = 0;
+    int64_t mtime = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return exists == other.exists && size == other.size && mtime == other.mtime;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+// 读取文件大小和修改时间，文件不存在时 exists 为 false
+FileStamp getFileStamp(const std::string& path);
 
-// ļȫ
+// 文件安全操作
 bool safeViewFile(const std::string& filepath);
 void overwriteLine(const std::string& filename, int lineToOverwrite, 
                    const std::string& newContent);
 
 
 
-// ļ
+// 结局文件操作
 std::vector<std::string> readCollectedEndings(const std::string& gameFolder);
 void saveEnding(const std::string& gameFolder, const std::string& endingName, 
                 GameState& gameState);
-void loadAllEndings(const std::vector<std::string>& lines, GameState& gameState);
 
-// Ϸͳ
+// 脚本文件
+/**
+ * @brief 整块读入的脚本文件及其行索引
+ *
+ * 文件一次读入单个缓冲区并完成编码转换，按换行符扫描建立 string_view 行索引，
+ * 编译、标签解析和结局统计共用同一份数据。行索引指向内部缓冲区，因此不可复制或移动
+ */
+class ScriptSource {
+public:
+    ScriptSource() = default;
+    ScriptSource(const ScriptSource&) = delete;
+    ScriptSource& operator=(const ScriptSource&) = delete;
+
+    bool load(const std::string& scriptPath);
+
+    const std::vector<std::string_view>& lines() const { return lineIndex; }
+    size_t size() const { return lineIndex.size(); }
+    std::string_view operator[](size_t index) const { return lineIndex[index]; }
+
+private:
+    std::string buffer;
+    std::vector<std::string_view> lineIndex;    // 不含换行符和行尾的 '\r'
+};
+
+// 游戏统计
 int countTotalEndingsInScript(const std::string& scriptPath);
-std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath);
+// totalEndings 为脚本中的结局总数，传入 -1 时自行扫描脚本
+std::pair<int, int> getGameEndingStats(const std::string& gameFolderPath, int totalEndings = -1);
 std::string getGameFolderName(const std::string& fullPath);
 
-// ļ
-std::string readCfg(const std::string& key);
-void updateFirstRunFlag(bool value);
-
 #endif // FILEUTILS_H
\ No newline at end of file
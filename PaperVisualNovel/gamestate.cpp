@@ -1,130 +1,290 @@
 // gamestate.cpp
 #include "gamestate.h"
 #include <sstream>
+#include <mutex>
 
-// ====================  ====================
+// ==================== 变量槽位表 ====================
+
+VariableTable& VariableTable::instance() {
+    static VariableTable table;
+    return table;
+}
+
+int VariableTable::intern(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = slots.find(name);
+        if (it != slots.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto [it, inserted] = slots.emplace(name, static_cast<int>(names.size()));
+    if (inserted) {
+        names.push_back(name);
+    }
+    return it->second;
+}
+
+int VariableTable::find(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = slots.find(name);
+    return it != slots.end() ? it->second : -1;
+}
+
+std::string VariableTable::nameOf(int slot) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return slot >= 0 && slot < static_cast<int>(names.size()) ? names[slot] : "";
+}
+
+// ==================== 变量操作 ====================
 
 void GameState::setVar(const std::string& name, int value) {
-    variables[name] = value;
+    setVar(VariableTable::instance().intern(name), value);
 }
 
 void GameState::addVar(const std::string& name, int value) {
-    if (variables.find(name) == variables.end()) {
-        variables[name] = 0;
-    }
-    variables[name] += value;
+    addVar(VariableTable::instance().intern(name), value);
 }
 
 int GameState::getVar(const std::string& name) const {
-    auto it = variables.find(name);
-    if (it != variables.end()) {
-        return it->second;
-    }
-    return 0;
+    return getVar(VariableTable::instance().find(name));
 }
 
 bool GameState::hasVar(const std::string& name) const {
-    return variables.find(name) != variables.end();
+    return hasVar(VariableTable::instance().find(name));
 }
 
 const std::map<std::string, int>& GameState::getAllVariables() const {
-    return variables;
+    // 仅供调试终端和序列化使用，每次按名字重建
+    const auto& slots = variables.read();
+    auto& view = variableView.value;
+    view.clear();
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot].isSet) {
+            view[VariableTable::instance().nameOf(static_cast<int>(slot))] = slots[slot].value;
+        }
+    }
+    return view;
+}
+
+void GameState::setVar(int slot, int value) {
+    auto& slots = variables.write();
+    if (slot >= static_cast<int>(slots.size())) {
+        slots.resize(slot + 1);
+    }
+    slots[slot] = { value, true };
+}
+
+void GameState::addVar(int slot, int value) {
+    auto& slots = variables.write();
+    if (slot >= static_cast<int>(slots.size())) {
+        slots.resize(slot + 1);
+    }
+    IntSlot& var = slots[slot];
+    var.value = var.isSet ? var.value + value : value;
+    var.isSet = true;
+}
+
+int GameState::getVar(int slot) const {
+    // 未设置的槽位值始终为 0
+    const auto& slots = variables.read();
+    if (slot < 0 || slot >= static_cast<int>(slots.size())) {
+        return 0;
+    }
+    return slots[slot].value;
+}
+
+bool GameState::hasVar(int slot) const {
+    const auto& slots = variables.read();
+    return slot >= 0 && slot < static_cast<int>(slots.size()) && slots[slot].isSet;
+}
+
+const std::vector<IntSlot>& GameState::getVariableSlots() const {
+    return variables.read();
 }
 
-// ==================== ѡʷ ====================
+// ==================== 选择历史管理 ====================
+
+ChoiceHistory& ChoiceHistory::operator=(const ChoiceHistory& other) {
+    if (this != &other) {
+        head = other.head;
+        count = other.count;
+        viewValid = false;
+    }
+    return *this;
+}
+
+ChoiceHistory::Node::~Node() {
+    // 释放前驱时若它也随之析构，会一层层递归下去，长链表会栈溢出。
+    // 最外层的析构在本线程的队列中逐个释放前驱，内层只把前驱放入队列，
+    // 是否为最后的持有者由 shared_ptr 自己判断，不读取 use_count
+    thread_local std::vector<std::shared_ptr<const Node>>* pending = nullptr;
+    if (!prev) {
+        return;
+    }
+    if (pending) {
+        pending->push_back(std::move(prev));
+        return;
+    }
+
+    std::vector<std::shared_ptr<const Node>> queue;
+    queue.push_back(std::move(prev));
+    pending = &queue;
+    while (!queue.empty()) {
+        std::shared_ptr<const Node> node = std::move(queue.back());
+        queue.pop_back();
+        node.reset();
+    }
+    pending = nullptr;
+}
+
+void ChoiceHistory::push(const std::string& choice) {
+    head = std::make_shared<const Node>(Node{ choice, head });
+    count++;
+    viewValid = false;
+}
+
+void ChoiceHistory::clear() {
+    ChoiceHistory empty;
+    std::swap(head, empty.head);
+    count = 0;
+    viewValid = false;
+}
+
+const std::vector<std::string>& ChoiceHistory::items() const {
+    if (!viewValid) {
+        view.assign(count, std::string());
+        size_t i = count;
+        for (const Node* node = head.get(); node != nullptr; node = node->prev.get()) {
+            view[--i] = node->choice;
+        }
+        viewValid = true;
+    }
+    return view;
+}
 
 void GameState::recordChoice(const std::string& choice) {
-    choiceHistory.push_back(choice);
+    choiceHistory.push(choice);
 }
 
 const std::vector<std::string>& GameState::getChoiceHistory() const {
-    return choiceHistory;
+    return choiceHistory.items();
 }
 
-// ==================== ֹ ====================
+// ==================== 结局管理 ====================
 
 void GameState::addEnding(const std::string& endingName) {
-    // ǷѾռ
-    for (const auto& ending : collectedEndings) {
+    // 检查是否已经收集过这个结局
+    for (const auto& ending : collectedEndings.read()) {
         if (ending == endingName) {
-            return; // Ѿռ
+            return; // 已经收集过，不再添加
         }
     }
-    collectedEndings.push_back(endingName);
+    collectedEndings.write().push_back(endingName);
 }
 
 void GameState::registerEnding(const std::string& endingName) {
-    // עһܵĽ֣ͳ
-    for (const auto& ending : allEndings) {
+    // 注册一个可能的结局（用于统计总数）
+    for (const auto& ending : allEndings.read()) {
         if (ending == endingName) {
-            return; // Ѿע
+            return; // 已经注册过
         }
     }
-    allEndings.push_back(endingName);
+    allEndings.write().push_back(endingName);
 }
 
 const std::vector<std::string>& GameState::getCollectedEndings() const {
-    return collectedEndings;
+    return collectedEndings.read();
 }
 
 const std::vector<std::string>& GameState::getAllEndings() const {
-    return allEndings;
+    return allEndings.read();
 }
 
 int GameState::getTotalEndingsCount() const {
-    return allEndings.size();
+    return allEndings.read().size();
 }
 
 int GameState::getCollectedEndingsCount() const {
-    return collectedEndings.size();
+    return collectedEndings.read().size();
 }
 
-// ==================== ״̬ ====================
+// ==================== 状态管理 ====================
 
 void GameState::clear() {
-    variables.clear();
+    variables.reset();
     choiceHistory.clear();
 }
 
 
-// ==================== ַ ====================
+// ==================== 字符串变量操作 ====================
 
 void GameState::setStringVar(const std::string& name, const std::string& value) {
-    stringVars[name] = value;
+    setStringVar(VariableTable::instance().intern(name), value);
 }
 
 std::string GameState::getStringVar(const std::string& name) const {
-    auto it = stringVars.find(name);
-    if (it != stringVars.end()) {
-        return it->second;
-    }
-    return "";
+    return getStringVar(VariableTable::instance().find(name));
 }
 
 bool GameState::hasStringVar(const std::string& name) const {
-    return stringVars.find(name) != stringVars.end();
+    int slot = VariableTable::instance().find(name);
+    const auto& slots = stringVars.read();
+    return slot >= 0 && slot < static_cast<int>(slots.size()) && slots[slot].isSet;
 }
 
 const std::map<std::string, std::string>& GameState::getAllStringVariables() const {
-    return stringVars;
+    const auto& slots = stringVars.read();
+    auto& view = stringVarView.value;
+    view.clear();
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot].isSet) {
+            view[VariableTable::instance().nameOf(static_cast<int>(slot))] = slots[slot].value;
+        }
+    }
+    return view;
+}
+
+void GameState::setStringVar(int slot, const std::string& value) {
+    auto& slots = stringVars.write();
+    if (slot >= static_cast<int>(slots.size())) {
+        slots.resize(slot + 1);
+    }
+    slots[slot] = { value, true };
+}
+
+const std::string& GameState::getStringVar(int slot) const {
+    static const std::string empty;
+    const auto& slots = stringVars.read();
+    if (slot < 0 || slot >= static_cast<int>(slots.size())) {
+        return empty;
+    }
+    return slots[slot].value;
 }
-// ==================== л/л ====================
+
+const std::vector<StringSlot>& GameState::getStringVariableSlots() const {
+    return stringVars.read();
+}
+
+// ==================== 更新序列化/反序列化 ====================
 
 std::string GameState::serialize() const {
     std::stringstream ss;
 
-    // л
+    // 序列化整数变量
     ss << "[VARIABLES]" << std::endl;
-    for (const auto& var : variables) {
+    for (const auto& var : getAllVariables()) {
         ss << var.first << "=" << var.second << std::endl;
     }
 
-    // лַ
+    // 序列化字符串变量
     ss << "[STRING_VARIABLES]" << std::endl;
-    for (const auto& var : stringVars) {
-        // ַת壬⻻з
+    for (const auto& var : getAllStringVariables()) {
+        // 对字符串进行转义，避免换行符等问题
         std::string escaped = var.second;
-        // 滻з
+        // 替换换行符
         size_t pos = 0;
         while ((pos = escaped.find("\n", pos)) != std::string::npos) {
             escaped.replace(pos, 1, "\\n");
@@ -133,22 +293,22 @@ std::string GameState::serialize() const {
         ss << var.first << "=" << escaped << std::endl;
     }
 
-    // лѡʷ
+    // 序列化选择历史
     ss << "[CHOICE_HISTORY]" << std::endl;
-    for (const auto& choice : choiceHistory) {
+    for (const auto& choice : choiceHistory.items()) {
         ss << choice << std::endl;
     }
 
-    // лռĽ
+    // 序列化已收集的结局
     ss << "[COLLECTED_ENDINGS]" << std::endl;
-    for (const auto& ending : collectedEndings) {
+    for (const auto& ending : collectedEndings.read()) {
         ss << ending << std::endl;
     }
     return ss.str();
 }
 
 void GameState::deserialize(const std::string& data) {
-    clear(); // յǰ״̬
+    clear(); // 清空当前状态
 
     std::stringstream ss(data);
     std::string line;
@@ -157,7 +317,7 @@ void GameState::deserialize(const std::string& data) {
     while (getline(ss, line)) {
         if (line.empty()) continue;
 
-        // ½ڱ
+        // 处理章节标记
         if (line[0] == '[' && line.back() == ']') {
             currentSection = line;
             continue;
@@ -170,10 +330,10 @@ void GameState::deserialize(const std::string& data) {
                 std::string varValueStr = line.substr(equalsPos + 1);
                 try {
                     int varValue = std::stoi(varValueStr);
-                    variables[varName] = varValue;
+                    setVar(varName, varValue);
                 }
                 catch (...) {
-                    // ת
+                    // 忽略转换错误
                 }
             }
         }
@@ -183,21 +343,21 @@ void GameState::deserialize(const std::string& data) {
                 std::string varName = line.substr(0, equalsPos);
                 std::string varValue = line.substr(equalsPos + 1);
 
-                // תַ
+                // 反转义字符串
                 size_t pos = 0;
                 while ((pos = varValue.find("\\n", pos)) != std::string::npos) {
                     varValue.replace(pos, 2, "\n");
                     pos += 1;
                 }
 
-                stringVars[varName] = varValue;
+                setStringVar(varName, varValue);
             }
         }
         else if (currentSection == "[CHOICE_HISTORY]") {
-            choiceHistory.push_back(line);
+            choiceHistory.push(line);
         }
         else if (currentSection == "[COLLECTED_ENDINGS]") {
-            collectedEndings.push_back(line);
+            collectedEndings.write().push_back(line);
         }
     }
 }
@@ -6,41 +6,178 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
 
 /**
- * @brief Ϸ״̬
+ * @brief 变量名到槽位的全局映射
+ *
+ * 脚本编译时把变量名驻留为连续的整数槽位，执行期按槽位直接访问；
+ * 按名字查找只用于调试终端、序列化和插件参数等非热点路径
+ */
+class VariableTable {
+public:
+    static VariableTable& instance();
+
+    int intern(const std::string& name);        // 返回槽位，不存在时新建
+    int find(const std::string& name) const;    // 返回槽位，不存在时返回 -1
+    std::string nameOf(int slot) const;
+
+private:
+    VariableTable() = default;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, int> slots;
+    std::vector<std::string> names;
+};
+
+/**
+ * @brief 整型变量槽位
+ */
+struct IntSlot {
+    int value = 0;
+    bool isSet = false;
+};
+
+/**
+ * @brief 字符串变量槽位
+ */
+struct StringSlot {
+    std::string value;
+    bool isSet = false;
+};
+
+/**
+ * @brief 写时复制的共享数据
+ *
+ * 复制只增加引用计数，并把双方都标记为共享；标记为共享的一方第一次修改前先复制一份。
+ * 共享与否由持有者自己的标记决定，不读取 use_count：副本可能在其他线程
+ * （如后台存档）中同时被释放，引用计数无法可靠地说明数据是否仍被共享
+ */
+template <typename T>
+class CowPtr {
+public:
+    CowPtr() : data(std::make_shared<T>()) {}
+    // 不提供移动操作：移动退化为复制，被移动的对象仍然可用
+    CowPtr(const CowPtr& other) : data(other.data), shared(true) {
+        other.shared = true;
+    }
+    CowPtr& operator=(const CowPtr& other) {
+        data = other.data;
+        shared = true;
+        other.shared = true;
+        return *this;
+    }
+
+    const T& read() const { return *data; }
+    T& write() {
+        if (shared) {
+            data = std::make_shared<T>(*data);
+            shared = false;
+        }
+        return *data;
+    }
+    void reset() {
+        data = std::make_shared<T>();
+        shared = false;
+    }
+
+private:
+    std::shared_ptr<T> data;
+    mutable bool shared = false;    // 复制过（数据可能仍被其他副本引用）
+};
+
+/**
+ * @brief 按需重建的视图缓存，复制游戏状态时不随之复制
+ */
+template <typename T>
+struct ViewCache {
+    mutable T value;
+
+    ViewCache() = default;
+    ViewCache(const ViewCache&) {}
+    ViewCache& operator=(const ViewCache&) { return *this; }
+};
+
+/**
+ * @brief 选择历史（持久化链表）
+ *
+ * 各个快照共享已有的节点，追加只新建一个节点，复制为 O(1)；
+ * 需要按顺序访问时再展开为数组。节点不可修改，释放时逐个进行，长链表不会递归析构
+ */
+class ChoiceHistory {
+public:
+    ChoiceHistory() = default;
+    ChoiceHistory(const ChoiceHistory& other) : head(other.head), count(other.count) {}
+    ChoiceHistory& operator=(const ChoiceHistory& other);
+
+    void push(const std::string& choice);
+    void clear();
+    size_t size() const { return count; }
+    const std::vector<std::string>& items() const;
+
+private:
+    struct Node {
+        std::string choice;
+        std::shared_ptr<const Node> prev;
+
+        ~Node();
+    };
+
+    std::shared_ptr<const Node> head;
+    size_t count = 0;
+    mutable std::vector<std::string> view;
+    mutable bool viewValid = false;
+};
+
+/**
+ * @brief 游戏状态管理器类
  * 
- * ϷıѡʷռϢ
+ * 负责管理游戏的变量、选择历史、结局收集等信息。
+ * 各部分以写时复制方式共享，复制（存档、回退快照）为 O(1)
  */
 class GameState {
 private:
-    std::map<std::string, int> variables;      // ͱ洢
-    std::map<std::string, std::string> stringVars;  //ַ洢
-    std::vector<std::string> choiceHistory;    // ѡʷ
-    std::vector<std::string> collectedEndings; // ռĽ
-    std::vector<std::string> allEndings;       // пܵĽ
+    CowPtr<std::vector<IntSlot>> variables;            // 整型变量存储（按槽位）
+    CowPtr<std::vector<StringSlot>> stringVars;        // 字符串变量存储（按槽位）
+    ViewCache<std::map<std::string, int>> variableView;            // getAllVariables 的按名视图
+    ViewCache<std::map<std::string, std::string>> stringVarView;   // getAllStringVariables 的按名视图
+    ChoiceHistory choiceHistory;                       // 选择历史
+    CowPtr<std::vector<std::string>> collectedEndings; // 已收集的结局
+    CowPtr<std::vector<std::string>> allEndings;       // 所有可能的结局
 
 public:
     GameState() = default;
     
-    // 
+    // 变量操作
     void setVar(const std::string& name, int value);
     void addVar(const std::string& name, int value);
     int getVar(const std::string& name) const;
     bool hasVar(const std::string& name) const;
     const std::map<std::string, int>& getAllVariables() const;
 
-    // ַ
+    // 按槽位访问（槽位由 VariableTable 分配）
+    void setVar(int slot, int value);
+    void addVar(int slot, int value);
+    int getVar(int slot) const;
+    bool hasVar(int slot) const;
+    const std::vector<IntSlot>& getVariableSlots() const;
+
+    // 字符串变量操作
     void setStringVar(const std::string& name, const std::string& value);
     std::string getStringVar(const std::string& name) const;
     bool hasStringVar(const std::string& name) const;
     const std::map<std::string, std::string>& getAllStringVariables() const;
+    void setStringVar(int slot, const std::string& value);
+    const std::string& getStringVar(int slot) const;
+    const std::vector<StringSlot>& getStringVariableSlots() const;
     
-    // ѡʷ
+    // 选择历史管理
     void recordChoice(const std::string& choice);
     const std::vector<std::string>& getChoiceHistory() const;
     
-    // ֹ
+    // 结局管理
     void addEnding(const std::string& endingName);
     void registerEnding(const std::string& endingName);
     const std::vector<std::string>& getCollectedEndings() const;
@@ -48,10 +185,10 @@ public:
     int getTotalEndingsCount() const;
     int getCollectedEndingsCount() const;
     
-    // ״̬
+    // 状态管理
     void clear();
     
-    // л/л
+    // 序列化/反序列化
     std::string serialize() const;
     void deserialize(const std::string& data);
 };
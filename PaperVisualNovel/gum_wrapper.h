@@ -111,15 +111,18 @@ namespace gum {
         }
 
     public:
-        // 检查gum是否可用 - 保持原有接口
+        // 检查gum是否可用 - 保持原有接口（结果在进程内缓存，只启动一次 gum）
         static bool is_available() {
-            try {
-                std::string version = execute_gum_command("gum --version");
-                return !version.empty();
-            }
-            catch (...) {
-                return false;
-            }
+            static const bool available = [] {
+                try {
+                    std::string version = execute_gum_command("gum --version");
+                    return !version.empty();
+                }
+                catch (...) {
+                    return false;
+                }
+            }();
+            return available;
         }
 
         // 基础选择函数 - 保持原有接口
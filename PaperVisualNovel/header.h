@@ -27,7 +27,7 @@
 #define ANSI_AQUA "\033[36m"
 #define ANSI_PURPLE "\033[35m"
 
-// ϵͳͷļ
+// 系统头文件
 #define NOMINMAX
 #include <iostream>
 #include <fstream>
@@ -41,12 +41,10 @@
 #include <algorithm>
 #include <map>
 #include <set>
-#include <Windows.h>
 #include <filesystem>
-#include <conio.h>
 #include <cstdlib>
-#include <shellapi.h>
 
+#include "platform.h"
 #include "gamestate.h"
 #include "gum_wrapper.h"
 
@@ -54,12 +52,12 @@ using namespace std;
 namespace fs = std::filesystem;
 
 
-// ȫֳ
-const size_t MAX_FILE_SIZE = 2000 * 1024 * 1024; // ļС
+// 全局常量
+const size_t MAX_FILE_SIZE = 2000 * 1024 * 1024; // 最大文件大小限制
 
 
 
-// öٺͽṹ
+// 枚举和结构体声明
 enum color {
     black = 0,
     blue,
@@ -73,10 +71,10 @@ enum color {
 };
 
 struct SaveData {
-    size_t currentLine;        // ǰִек
-    GameState gameState;       // Ϸ״̬
-    string scriptPath;         // ű·
-    string saveTime;           // ʱ
+    size_t currentLine;        // 当前执行到的行号
+    GameState gameState;       // 游戏状态
+    string scriptPath;         // 脚本路径
+    string saveTime;           // 保存时间
 };
 bool loadGame(const std::string& savePath, SaveData& saveData);
 
@@ -86,11 +84,11 @@ struct CurrentGameInfo {
     GameState* gameState;
 };
 
-// ȫֱ
+// 全局变量声明
 extern int quantity;
 extern CurrentGameInfo g_currentGameInfo;
 
-// 
+// 函数声明
 void Run();
 void RunPgn(const string& where, const string& file, bool loadFromSave = false,
     size_t savedLine = 0, const GameState& savedState = GameState());
@@ -0,0 +1,385 @@
+﻿// indexcache.cpp
+#include "indexcache.h"
+#include "fileutils.h"
+#include "ui.h"
+#include "platform.h"
+#include "savefile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    constexpr int kCacheVersion = 1;
+    // 扫描以 I/O 等待为主，线程数不少于此值，即使核心较少也能重叠磁盘访问
+    constexpr unsigned kMinScanThreads = 4;
+    const char* kCacheFileName = "index.cache";
+
+    /**
+     * @brief 缓存文件内容
+     */
+    struct IndexCache {
+        FileStamp scriptStamp;
+        uint64_t scriptHash = 0;
+        ScriptIndex index;
+        bool hasIndex = false;
+
+        FileStamp endingsDatStamp;      // endings.dat
+        FileStamp dataInfStamp;         // data.inf
+        int collected = 0;
+        bool hasCollected = false;
+
+        FileStamp saveStamp;            // 最新的存档
+        std::string saveInfo;
+        bool hasSaveInfo = false;
+    };
+
+    uint64_t hashFile(const std::string& path, bool& ok) {
+        std::ifstream in(path, std::ios::binary);
+        ok = in.is_open();
+        uint64_t hash = 14695981039346656037ULL;
+        char buffer[64 * 1024];
+        while (in) {
+            in.read(buffer, sizeof(buffer));
+            std::streamsize count = in.gcount();
+            for (std::streamsize i = 0; i < count; i++) {
+                hash ^= static_cast<unsigned char>(buffer[i]);
+                hash *= 1099511628211ULL;
+            }
+        }
+        return hash;
+    }
+
+    std::string formatStamp(const FileStamp& stamp) {
+        return std::to_string(stamp.exists) + " " + std::to_string(stamp.size) + " " + std::to_string(stamp.mtime);
+    }
+
+    bool parseStamp(const std::string& text, FileStamp& stamp) {
+        std::stringstream ss(text);
+        int exists = 0;
+        if (!(ss >> exists >> stamp.size >> stamp.mtime)) {
+            return false;
+        }
+        stamp.exists = exists != 0;
+        return true;
+    }
+
+    // 按制表符拆分，最后一个字段保留剩余全部内容
+    std::vector<std::string> splitFields(const std::string& line, size_t count) {
+        std::vector<std::string> fields;
+        size_t pos = 0;
+        while (fields.size() + 1 < count) {
+            size_t tab = line.find('\t', pos);
+            if (tab == std::string::npos) {
+                break;
+            }
+            fields.push_back(line.substr(pos, tab - pos));
+            pos = tab + 1;
+        }
+        fields.push_back(line.substr(pos));
+        return fields;
+    }
+
+    // ==================== 缓存读写 ====================
+
+    bool readCache(const std::string& cachePath, IndexCache& cache) {
+        std::ifstream in(cachePath, std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+
+        std::string line;
+        std::string section;
+        bool versionOk = false;
+
+        try {
+            while (std::getline(in, line)) {
+                if (line.empty()) continue;
+
+                if (line[0] == '[' && line.back() == ']') {
+                    section = line;
+                    continue;
+                }
+
+                if (section == "[CACHE]" || section == "[SCRIPT]" || section == "[ENDINGS_STATE]" || section == "[SAVE]") {
+                    size_t equalsPos = line.find('=');
+                    if (equalsPos == std::string::npos) continue;
+                    std::string key = line.substr(0, equalsPos);
+                    std::string value = line.substr(equalsPos + 1);
+
+                    if (key == "version") versionOk = std::stoi(value) == kCacheVersion;
+                    else if (key == "script_stamp") cache.hasIndex = parseStamp(value, cache.scriptStamp);
+                    else if (key == "script_hash") cache.scriptHash = std::stoull(value);
+                    else if (key == "line_count") cache.index.lineCount = std::stoull(value);
+                    else if (key == "endings_dat_stamp") parseStamp(value, cache.endingsDatStamp);
+                    else if (key == "data_inf_stamp") parseStamp(value, cache.dataInfStamp);
+                    else if (key == "collected") { cache.collected = std::stoi(value); cache.hasCollected = true; }
+                    else if (key == "save_stamp") parseStamp(value, cache.saveStamp);
+                    else if (key == "save_info") { cache.saveInfo = value; cache.hasSaveInfo = true; }
+                }
+                else if (section == "[LABELS]") {
+                    auto fields = splitFields(line, 2);
+                    if (fields.size() == 2) cache.index.labels[fields[1]] = std::stoi(fields[0]);
+                }
+                else if (section == "[DUPLICATE_LABELS]") {
+                    auto fields = splitFields(line, 2);
+                    if (fields.size() == 2) cache.index.duplicateLabels.push_back({ fields[1], std::stoull(fields[0]) });
+                }
+                else if (section == "[ENDINGS]") {
+                    auto fields = splitFields(line, 2);
+                    if (fields.size() == 2) {
+                        cache.index.endings.push_back({ fields[1], std::stoull(fields[0]) });
+                        cache.index.endingNames.insert(fields[1]);
+                    }
+                }
+                else if (section == "[PLUGINS]") {
+                    auto fields = splitFields(line, 3);
+                    if (fields.size() == 3) cache.index.plugins.push_back({ fields[1], fields[2], std::stoull(fields[0]) });
+                }
+                else if (section == "[JUMPS]") {
+                    auto fields = splitFields(line, 4);
+                    if (fields.size() == 4) {
+                        JumpRef jump{ fields[3], fields[2], std::stoull(fields[0]), std::stoi(fields[1]) };
+                        cache.index.jumps.push_back(jump);
+                    }
+                }
+            }
+        }
+        catch (const std::exception&) {
+            Log(LogGrade::WARNING, LogCode::SAVE_CORRUPTED, "Index cache is corrupted: " + cachePath);
+            return false;
+        }
+
+        return versionOk;
+    }
+
+    void writeCache(const std::string& cachePath, const IndexCache& cache) {
+        std::stringstream ss;
+        ss << "[CACHE]\n" << "version=" << kCacheVersion << "\n";
+
+        if (cache.hasIndex) {
+            const ScriptIndex& index = cache.index;
+            ss << "[SCRIPT]\n";
+            ss << "script_stamp=" << formatStamp(cache.scriptStamp) << "\n";
+            ss << "script_hash=" << cache.scriptHash << "\n";
+            ss << "line_count=" << index.lineCount << "\n";
+
+            ss << "[LABELS]\n";
+            for (const auto& [name, line] : index.labels) ss << line << "\t" << name << "\n";
+            ss << "[DUPLICATE_LABELS]\n";
+            for (const auto& [name, line] : index.duplicateLabels) ss << line << "\t" << name << "\n";
+            ss << "[ENDINGS]\n";
+            for (const auto& ending : index.endings) ss << ending.line << "\t" << ending.name << "\n";
+            ss << "[PLUGINS]\n";
+            for (const auto& plugin : index.plugins) ss << plugin.line << "\t" << plugin.name << "\t" << plugin.version << "\n";
+            ss << "[JUMPS]\n";
+            for (const auto& jump : index.jumps) ss << jump.line << "\t" << jump.jumpLine << "\t" << jump.cmd << "\t" << jump.target << "\n";
+        }
+
+        if (cache.hasCollected) {
+            ss << "[ENDINGS_STATE]\n";
+            ss << "endings_dat_stamp=" << formatStamp(cache.endingsDatStamp) << "\n";
+            ss << "data_inf_stamp=" << formatStamp(cache.dataInfStamp) << "\n";
+            ss << "collected=" << cache.collected << "\n";
+        }
+
+        if (cache.hasSaveInfo) {
+            ss << "[SAVE]\n";
+            ss << "save_stamp=" << formatStamp(cache.saveStamp) << "\n";
+            ss << "save_info=" << cache.saveInfo << "\n";
+        }
+
+        // 先写临时文件再替换，避免中断时留下半个缓存
+        std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                LOG_DEBUG(LogCode::FILE_OPEN_FAILED, "Cannot write index cache: ", cachePath);
+                return;
+            }
+            out << ss.str();
+        }
+        std::error_code ec;
+        fs::rename(tempPath, cachePath, ec);
+        if (ec) {
+            fs::remove(tempPath, ec);
+        }
+    }
+
+    /**
+     * @brief 校验脚本部分的缓存，必要时重新建立索引
+     * @return 缓存内容是否有变化（需要写回）
+     */
+    bool refreshScriptIndex(const std::string& scriptPath, IndexCache& cache, bool& ok) {
+        ok = true;
+        FileStamp stamp = getFileStamp(scriptPath);
+        if (!stamp.exists) {
+            ok = false;
+            return false;
+        }
+
+        if (cache.hasIndex && cache.scriptStamp == stamp) {
+            return false;
+        }
+
+        // 修改时间变了但内容可能没变（复制、解压、touch），比较哈希后只更新指纹
+        bool hashOk = false;
+        uint64_t hash = hashFile(scriptPath, hashOk);
+        if (cache.hasIndex && hashOk && cache.scriptHash == hash && cache.scriptStamp.size == stamp.size) {
+            cache.scriptStamp = stamp;
+            return true;
+        }
+
+        ScriptIndex index;
+        if (!indexScriptFile(scriptPath, index)) {
+            ok = false;
+            return false;
+        }
+        cache.index = std::move(index);
+        cache.scriptStamp = stamp;
+        cache.scriptHash = hash;
+        cache.hasIndex = true;
+        LOG_DEBUG(LogCode::GAME_LOADED, "Script index rebuilt: ", scriptPath);
+        return true;
+    }
+}
+
+// ==================== 索引缓存 ====================
+
+GameListEntry loadGameListEntry(const std::string& folderPath, const std::string& folderName) {
+    auto entryStart = std::chrono::high_resolution_clock::now();
+
+    GameListEntry entry;
+    entry.folderName = folderName;
+
+    std::string cachePath = folderPath + kCacheFileName;
+    std::string scriptPath = folderPath + folderName + ".pgn";
+
+    IndexCache cache;
+    bool cacheLoaded = readCache(cachePath, cache);
+    if (!cacheLoaded) {
+        cache = IndexCache{};
+    }
+
+    bool scriptOk = false;
+    bool changed = refreshScriptIndex(scriptPath, cache, scriptOk);
+
+    if (!scriptOk) {
+        // 没有同名脚本时保持原来的统计方式，不写缓存
+        auto stats = getGameEndingStats(folderPath);
+        entry.collected = stats.first;
+        entry.total = stats.second;
+        entry.saveInfo = "无游戏文件";
+        return entry;
+    }
+    entry.total = cache.index.totalEndings();
+
+    // 结局记录
+    FileStamp endingsDatStamp = getFileStamp(folderPath + "endings.dat");
+    FileStamp dataInfStamp = getFileStamp(folderPath + "data.inf");
+    if (changed || !cache.hasCollected ||
+        cache.endingsDatStamp != endingsDatStamp || cache.dataInfStamp != dataInfStamp) {
+        auto stats = getGameEndingStats(folderPath, entry.total);
+        cache.collected = stats.first;
+        cache.endingsDatStamp = endingsDatStamp;
+        cache.dataInfStamp = dataInfStamp;
+        cache.hasCollected = true;
+        changed = true;
+    }
+    entry.collected = cache.collected;
+
+    // 存档摘要
+    FileStamp saveStamp = getFileStamp(findLatestSave(scriptPath));
+    if (!cache.hasSaveInfo || cache.saveStamp != saveStamp) {
+        cache.saveInfo = getSaveInfo(scriptPath);
+        cache.saveStamp = saveStamp;
+        cache.hasSaveInfo = true;
+        changed = true;
+    }
+    entry.saveInfo = cache.saveInfo;
+
+    if (changed) {
+        writeCache(cachePath, cache);
+    }
+
+    auto entryEnd = std::chrono::high_resolution_clock::now();
+    LOG_DEBUG(LogCode::GAME_LOADED, "Game list entry ", folderName, (changed ? " refreshed" : " from cache"),
+        " (took ", std::chrono::duration_cast<std::chrono::microseconds>(entryEnd - entryStart).count(), "us)");
+
+    return entry;
+}
+
+// ==================== 游戏库扫描 ====================
+
+std::vector<GameListEntry> scanGameLibrary(
+    const std::vector<std::pair<std::string, std::string>>& folders,
+    const std::function<void(size_t, const GameListEntry&)>& onReady) {
+    auto scanStart = std::chrono::high_resolution_clock::now();
+
+    // 刚保存的存档可能仍在后台写入，等写完再比较指纹
+    waitForPendingSaves();
+
+    std::vector<GameListEntry> entries(folders.size());
+    std::vector<char> ready(folders.size(), 0);
+    std::mutex readyMutex;
+    std::condition_variable readyCv;
+    std::atomic<size_t> nextIndex{ 0 };
+
+    // 按顺序领取任务，靠前的条目先完成，逐个显示时等待最少
+    auto worker = [&]() {
+        for (;;) {
+            size_t i = nextIndex.fetch_add(1);
+            if (i >= folders.size()) {
+                return;
+            }
+            GameListEntry entry;
+            try {
+                entry = loadGameListEntry(folders[i].first, folders[i].second);
+            }
+            catch (const std::exception& e) {
+                Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to scan game folder " + folders[i].second + ": " + e.what());
+                entry.folderName = folders[i].second;
+                entry.saveInfo = "无法读取";
+            }
+            {
+                std::lock_guard<std::mutex> lock(readyMutex);
+                entries[i] = std::move(entry);
+                ready[i] = 1;
+            }
+            readyCv.notify_one();
+        }
+    };
+
+    unsigned threadCount = std::max(kMinScanThreads, std::thread::hardware_concurrency());
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, folders.size()));
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned t = 0; t < threadCount; t++) {
+        threads.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < folders.size(); i++) {
+        {
+            std::unique_lock<std::mutex> lock(readyMutex);
+            readyCv.wait(lock, [&]() { return ready[i] != 0; });
+        }
+        // 第 i 项写入后不再被修改，回调时无需持锁
+        if (onReady) {
+            onReady(i, entries[i]);
+        }
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto scanEnd = std::chrono::high_resolution_clock::now();
+    LOG_DEBUG(LogCode::GAME_LOADED, "Game library scanned: ", folders.size(), " folders with ", threadCount, " threads (took ",
+        std::chrono::duration_cast<std::chrono::milliseconds>(scanEnd - scanStart).count(), "ms)");
+
+    return entries;
+}
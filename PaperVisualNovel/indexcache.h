@@ -0,0 +1,45 @@
+﻿// indexcache.h
+#pragma once
+#ifndef INDEXCACHE_H
+#define INDEXCACHE_H
+
+#include "scriptindex.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 游戏列表中一个游戏的显示信息
+ */
+struct GameListEntry {
+    std::string folderName;
+    int collected = 0;              // 已收集结局数
+    int total = 0;                  // 结局总数
+    std::string saveInfo;           // 存档摘要（"无存档" / "存档时间: ..." / "无游戏文件"）
+};
+
+/**
+ * @brief 读取游戏文件夹的列表信息，优先使用文件夹内的索引缓存（index.cache）
+ *
+ * 脚本按大小+修改时间校验，不一致时再比较内容哈希，确实变化才重新建立索引；
+ * 结局记录和存档按各自的指纹校验。有任何部分重新计算时写回缓存
+ *
+ * @param folderPath 游戏文件夹路径（以路径分隔符结尾）
+ */
+GameListEntry loadGameListEntry(const std::string& folderPath, const std::string& folderName);
+
+/**
+ * @brief 并发扫描游戏库
+ *
+ * 各文件夹的读取在线程池中并行进行（游戏库可能位于网络磁盘，I/O 可以重叠），
+ * onReady 在调用线程上按文件夹顺序逐个回调，前面的条目完成后即可先显示
+ *
+ * @param folders 每项为 {文件夹路径（以路径分隔符结尾）, 文件夹名}
+ * @param onReady 回调 (序号, 条目)
+ * @return 按文件夹顺序排列的全部条目
+ */
+std::vector<GameListEntry> scanGameLibrary(
+    const std::vector<std::pair<std::string, std::string>>& folders,
+    const std::function<void(size_t, const GameListEntry&)>& onReady);
+
+#endif // INDEXCACHE_H
@@ -0,0 +1,432 @@
+﻿// json.cpp
+#include "json.h"
+#include <charconv>
+#include <cstdint>
+#include <cmath>
+
+// ==================== 取值与修改 ====================
+
+JsonValue JsonValue::array() {
+    JsonValue value;
+    value.kind = Type::ARRAY;
+    return value;
+}
+
+JsonValue JsonValue::object() {
+    JsonValue value;
+    value.kind = Type::OBJECT;
+    return value;
+}
+
+bool JsonValue::asBool(bool defaultValue) const {
+    return kind == Type::BOOL ? boolValue : defaultValue;
+}
+
+double JsonValue::asNumber(double defaultValue) const {
+    return kind == Type::NUMBER ? numberValue : defaultValue;
+}
+
+std::string JsonValue::asString(const std::string& defaultValue) const {
+    return kind == Type::STRING ? stringValue : defaultValue;
+}
+
+const JsonValue* JsonValue::find(std::string_view key) const {
+    for (const auto& member : objectMembers) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+void JsonValue::set(const std::string& key, JsonValue value) {
+    if (kind != Type::OBJECT) {
+        *this = object();
+    }
+    for (auto& member : objectMembers) {
+        if (member.first == key) {
+            member.second = std::move(value);
+            return;
+        }
+    }
+    objectMembers.emplace_back(key, std::move(value));
+}
+
+void JsonValue::push(JsonValue value) {
+    if (kind != Type::ARRAY) {
+        *this = array();
+    }
+    arrayItems.push_back(std::move(value));
+}
+
+// ==================== 输出 ====================
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (byte < 0x20) {
+                out += "\\u00";
+                out += hex[byte >> 4];
+                out += hex[byte & 0x0F];
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+std::string JsonValue::dump() const {
+    std::string out;
+    dumpTo(out);
+    return out;
+}
+
+void JsonValue::dumpTo(std::string& out) const {
+    switch (kind) {
+    case Type::NUL:
+        out += "null";
+        break;
+    case Type::BOOL:
+        out += boolValue ? "true" : "false";
+        break;
+    case Type::NUMBER: {
+        if (!std::isfinite(numberValue)) {
+            out += "null";
+            break;
+        }
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), numberValue);
+        out.append(buffer, result.ptr);
+        break;
+    }
+    case Type::STRING:
+        appendJsonString(out, stringValue);
+        break;
+    case Type::ARRAY:
+        out += '[';
+        for (size_t i = 0; i < arrayItems.size(); i++) {
+            if (i > 0) out += ',';
+            arrayItems[i].dumpTo(out);
+        }
+        out += ']';
+        break;
+    case Type::OBJECT:
+        out += '{';
+        for (size_t i = 0; i < objectMembers.size(); i++) {
+            if (i > 0) out += ',';
+            appendJsonString(out, objectMembers[i].first);
+            out += ':';
+            objectMembers[i].second.dumpTo(out);
+        }
+        out += '}';
+        break;
+    }
+}
+
+// ==================== 解析 ====================
+
+namespace {
+    // 嵌套层数上限，防止恶意输入耗尽栈空间
+    constexpr int kMaxDepth = 64;
+
+    class JsonParser {
+    public:
+        explicit JsonParser(std::string_view text) : text(text) {}
+
+        bool parseDocument(JsonValue& out) {
+            skipSpace();
+            if (!parseValue(out, 0)) {
+                return false;
+            }
+            skipSpace();
+            if (pos != text.size()) {
+                return fail("unexpected trailing characters");
+            }
+            return true;
+        }
+
+        std::string error;
+
+    private:
+        bool fail(const std::string& message) {
+            if (error.empty()) {
+                error = message + " at offset " + std::to_string(pos);
+            }
+            return false;
+        }
+
+        void skipSpace() {
+            while (pos < text.size() &&
+                (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+                pos++;
+            }
+        }
+
+        bool consumeWord(std::string_view word) {
+            if (text.substr(pos, word.size()) != word) {
+                return fail("invalid literal");
+            }
+            pos += word.size();
+            return true;
+        }
+
+        bool parseValue(JsonValue& out, int depth) {
+            if (depth > kMaxDepth) {
+                return fail("nesting too deep");
+            }
+            if (pos >= text.size()) {
+                return fail("unexpected end of input");
+            }
+
+            switch (text[pos]) {
+            case 'n':
+                out = JsonValue();
+                return consumeWord("null");
+            case 't':
+                out = JsonValue(true);
+                return consumeWord("true");
+            case 'f':
+                out = JsonValue(false);
+                return consumeWord("false");
+            case '"': {
+                std::string value;
+                if (!parseString(value)) {
+                    return false;
+                }
+                out = JsonValue(std::move(value));
+                return true;
+            }
+            case '[':
+                return parseArray(out, depth);
+            case '{':
+                return parseObject(out, depth);
+            default:
+                return parseNumber(out);
+            }
+        }
+
+        bool parseNumber(JsonValue& out) {
+            size_t start = pos;
+            if (pos < text.size() && text[pos] == '-') pos++;
+            while (pos < text.size() &&
+                ((text[pos] >= '0' && text[pos] <= '9') || text[pos] == '.' ||
+                    text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-')) {
+                pos++;
+            }
+
+            double value = 0;
+            auto result = std::from_chars(text.data() + start, text.data() + pos, value);
+            if (pos == start || result.ec != std::errc() || result.ptr != text.data() + pos) {
+                pos = start;
+                return fail("invalid number");
+            }
+            out = JsonValue(value);
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        bool parseHex4(uint32_t& code) {
+            if (pos + 4 > text.size()) {
+                return fail("truncated \\u escape");
+            }
+            code = 0;
+            for (int i = 0; i < 4; i++) {
+                char c = text[pos++];
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= c - '0';
+                else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+                else return fail("invalid \\u escape");
+            }
+            return true;
+        }
+
+        bool parseString(std::string& out) {
+            pos++;  // 跳过开头的引号
+            while (true) {
+                size_t runStart = pos;
+                while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+                    if (static_cast<unsigned char>(text[pos]) < 0x20) {
+                        return fail("control character in string");
+                    }
+                    pos++;
+                }
+                out.append(text.data() + runStart, pos - runStart);
+
+                if (pos >= text.size()) {
+                    return fail("unterminated string");
+                }
+                if (text[pos] == '"') {
+                    pos++;
+                    return true;
+                }
+
+                pos++;  // 反斜杠
+                if (pos >= text.size()) {
+                    return fail("unterminated escape");
+                }
+                char escape = text[pos++];
+                switch (escape) {
+                case '"':  out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/'; break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!parseHex4(code)) {
+                        return false;
+                    }
+                    // 代理对
+                    if (code >= 0xD800 && code <= 0xDBFF &&
+                        text.substr(pos, 2) == "\\u") {
+                        size_t save = pos;
+                        pos += 2;
+                        uint32_t low = 0;
+                        if (!parseHex4(low)) {
+                            return false;
+                        }
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        else {
+                            pos = save;
+                        }
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+                }
+            }
+        }
+
+        bool parseArray(JsonValue& out, int depth) {
+            pos++;
+            out = JsonValue::array();
+            skipSpace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                JsonValue item;
+                skipSpace();
+                if (!parseValue(item, depth + 1)) {
+                    return false;
+                }
+                out.push(std::move(item));
+                skipSpace();
+                if (pos >= text.size()) {
+                    return fail("unterminated array");
+                }
+                if (text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (text[pos] == ']') {
+                    pos++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool parseObject(JsonValue& out, int depth) {
+            pos++;
+            out = JsonValue::object();
+            skipSpace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                if (pos >= text.size() || text[pos] != '"') {
+                    return fail("expected member name");
+                }
+                std::string key;
+                if (!parseString(key)) {
+                    return false;
+                }
+                skipSpace();
+                if (pos >= text.size() || text[pos] != ':') {
+                    return fail("expected ':'");
+                }
+                pos++;
+                skipSpace();
+                JsonValue value;
+                if (!parseValue(value, depth + 1)) {
+                    return false;
+                }
+                out.set(key, std::move(value));
+                skipSpace();
+                if (pos >= text.size()) {
+                    return fail("unterminated object");
+                }
+                if (text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (text[pos] == '}') {
+                    pos++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+
+        std::string_view text;
+        size_t pos = 0;
+    };
+}
+
+bool JsonValue::parse(std::string_view text, JsonValue& out, std::string* errorMessage) {
+    JsonParser parser(text);
+    JsonValue result;
+    if (!parser.parseDocument(result)) {
+        if (errorMessage) {
+            *errorMessage = parser.error;
+        }
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
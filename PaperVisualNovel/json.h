@@ -0,0 +1,81 @@
+﻿// json.h
+#pragma once
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 最小的 JSON 值（插件通信协议使用）
+ *
+ * 支持 null / bool / number / string / array / object。对象成员按插入顺序保存，
+ * 成员数量通常很少，查找为线性扫描。字符串按原始字节保存，不做编码转换：
+ * 非 ASCII 字节原样读写，\uXXXX 转义解码为 UTF-8
+ */
+class JsonValue {
+public:
+    enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    JsonValue() = default;
+    JsonValue(bool value) : kind(Type::BOOL), boolValue(value) {}
+    JsonValue(int value) : kind(Type::NUMBER), numberValue(value) {}
+    JsonValue(double value) : kind(Type::NUMBER), numberValue(value) {}
+    JsonValue(const char* value) : kind(Type::STRING), stringValue(value) {}
+    JsonValue(std::string value) : kind(Type::STRING), stringValue(std::move(value)) {}
+
+    static JsonValue array();
+    static JsonValue object();
+
+    Type type() const { return kind; }
+    bool isNull() const { return kind == Type::NUL; }
+    bool isBool() const { return kind == Type::BOOL; }
+    bool isNumber() const { return kind == Type::NUMBER; }
+    bool isString() const { return kind == Type::STRING; }
+    bool isArray() const { return kind == Type::ARRAY; }
+    bool isObject() const { return kind == Type::OBJECT; }
+
+    // 类型不符时返回默认值
+    bool asBool(bool defaultValue = false) const;
+    double asNumber(double defaultValue = 0) const;
+    std::string asString(const std::string& defaultValue = "") const;
+
+    const std::vector<JsonValue>& items() const { return arrayItems; }
+    const std::vector<std::pair<std::string, JsonValue>>& members() const { return objectMembers; }
+
+    // 对象成员查找，不存在或不是对象时返回 nullptr
+    const JsonValue* find(std::string_view key) const;
+
+    // 修改：非对象 / 非数组会先转换为空对象 / 空数组
+    void set(const std::string& key, JsonValue value);
+    void push(JsonValue value);
+
+    // 紧凑格式输出（无多余空白）
+    std::string dump() const;
+
+    /**
+     * @brief 解析 JSON 文本
+     * @param text 完整的 JSON 文本，前后允许空白
+     * @param out 解析结果
+     * @param errorMessage 失败时的错误描述（可选）
+     * @return 是否解析成功
+     */
+    static bool parse(std::string_view text, JsonValue& out, std::string* errorMessage = nullptr);
+
+private:
+    void dumpTo(std::string& out) const;
+
+    Type kind = Type::NUL;
+    bool boolValue = false;
+    double numberValue = 0;
+    std::string stringValue;
+    std::vector<JsonValue> arrayItems;
+    std::vector<std::pair<std::string, JsonValue>> objectMembers;
+};
+
+// 把字符串写成带引号的 JSON 字符串
+void appendJsonString(std::string& out, std::string_view text);
+
+#endif // JSON_H
@@ -0,0 +1,313 @@
+﻿// logger.cpp
+#include "logger.h"
+#include "ui.h"
+#include "platform.h"
+#include <filesystem>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+
+namespace {
+    const std::string LOG_FILE_PATH = "pvn_engine.log";
+    const std::string LOG_BACKUP_PATH = "pvn_engine.log.1";
+    const size_t MAX_LOG_SIZE = 20 * 1024 * 1024;
+    const size_t RING_CAPACITY = 8192;
+    const auto FLUSH_INTERVAL = std::chrono::milliseconds(100);
+
+    void crashSignalHandler(int sig) {
+        Logger::instance().signalFlush();
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+    }
+
+    void crashTerminateHandler() {
+        Logger::instance().emergencyFlush();
+        std::abort();
+    }
+}
+
+// ==================== 无锁环形缓冲区 ====================
+
+LogRingBuffer::LogRingBuffer(size_t capacity)
+    : cells(new Cell[capacity]), mask(capacity - 1), enqueuePos(0), dequeuePos(0) {
+    for (size_t i = 0; i < capacity; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogRingBuffer::tryPush(std::string&& message) {
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (dif == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (dif < 0) {
+            return false; // 缓冲区已满
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(message);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRingBuffer::tryPop(std::string& message) {
+    Cell* cell;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+        if (dif == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (dif < 0) {
+            return false; // 缓冲区为空
+        }
+        else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    message = std::move(cell->data);
+    cell->data.clear();
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+const std::string* LogRingBuffer::tryTake() {
+    Cell* cell;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+        if (dif == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &cell->data;
+            }
+        }
+        else if (dif < 0) {
+            return nullptr; // 缓冲区为空
+        }
+        else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t LogRingBuffer::sizeApprox() const {
+    size_t head = enqueuePos.load(std::memory_order_relaxed);
+    size_t tail = dequeuePos.load(std::memory_order_relaxed);
+    return head >= tail ? head - tail : 0;
+}
+
+// ==================== 异步日志器 ====================
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : buffer(RING_CAPACITY) {
+}
+
+Logger::~Logger() {
+    shutdown();
+}
+
+void Logger::ensureStarted() {
+    std::call_once(startFlag, [this]() {
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
+            openLocked();
+        }
+        running = true;
+        writer = std::thread(&Logger::writerLoop, this);
+    });
+}
+
+void Logger::write(std::string&& line) {
+    ensureStarted();
+
+    while (!buffer.tryPush(std::move(line))) {
+        if (!running) {
+            // 已关闭：直接同步写入
+            std::lock_guard<std::mutex> lock(fileMutex);
+            drainLocked();
+            if (file.is_open()) {
+                file << line << '\n';
+                file.flush();
+                fileSize += line.size() + 1;
+            }
+            return;
+        }
+        // 缓冲区已满：唤醒写线程后重试
+        wakeRequested = true;
+        wakeCond.notify_one();
+        std::this_thread::yield();
+    }
+
+    if (buffer.sizeApprox() > buffer.capacity() / 2 && !wakeRequested.exchange(true)) {
+        wakeCond.notify_one();
+    }
+
+    if (!running) {
+        flush();
+    }
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    drainLocked();
+}
+
+void Logger::shutdown() {
+    if (running.exchange(false)) {
+        wakeCond.notify_one();
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+    flush();
+}
+
+void Logger::emergencyFlush() {
+    std::unique_lock<std::mutex> lock(fileMutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        drainLocked();
+    }
+}
+
+void Logger::signalFlush() {
+    int fd = rawFd.load(std::memory_order_acquire);
+    if (fd < 0) {
+        return;
+    }
+
+    // 已被写线程取出但尚未写入文件的日志会丢失
+    while (const std::string* line = buffer.tryTake()) {
+        writeRaw(fd, line->data(), line->size());
+        writeRaw(fd, "\n", 1);
+    }
+}
+
+void Logger::installCrashHandlers() {
+    instance();
+    std::atexit([]() { Logger::instance().shutdown(); });
+    std::signal(SIGSEGV, crashSignalHandler);
+    std::signal(SIGABRT, crashSignalHandler);
+    std::signal(SIGFPE, crashSignalHandler);
+    std::signal(SIGILL, crashSignalHandler);
+    std::set_terminate(crashTerminateHandler);
+}
+
+void Logger::writerLoop() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCond.wait_for(lock, FLUSH_INTERVAL, [this]() {
+                return wakeRequested.load() || !running.load();
+            });
+            wakeRequested = false;
+        }
+
+        std::lock_guard<std::mutex> lock(fileMutex);
+        drainLocked();
+    }
+}
+
+void Logger::drainLocked() {
+    std::string batch;
+    std::string line;
+
+    while (buffer.tryPop(line)) {
+        batch += line;
+        batch += '\n';
+    }
+
+    if (batch.empty()) {
+        return;
+    }
+
+    if (!file.is_open()) {
+        openLocked();
+        if (!file.is_open()) {
+            return;
+        }
+    }
+
+    file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+    file.flush();
+    fileSize += batch.size();
+
+    rotateIfNeededLocked();
+}
+
+void Logger::openLocked() {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fileSize = fs::exists(LOG_FILE_PATH, ec) ? static_cast<size_t>(fs::file_size(LOG_FILE_PATH, ec)) : 0;
+    file.open(LOG_FILE_PATH, std::ios::app);
+    if (!file.is_open()) {
+        std::cerr << "无法打开日志文件: " << LOG_FILE_PATH << std::endl;
+    }
+    reopenRawLocked();
+    rotateIfNeededLocked();
+}
+
+void Logger::reopenRawLocked() {
+    // 先打开新文件再替换，信号处理函数任何时候读到的都是可用的描述符
+    int fd = openRawAppend(LOG_FILE_PATH);
+    int old = rawFd.exchange(fd, std::memory_order_acq_rel);
+    if (old >= 0) {
+        closeRaw(old);
+    }
+}
+
+void Logger::rotateIfNeededLocked() {
+    namespace fs = std::filesystem;
+
+    if (fileSize <= MAX_LOG_SIZE) {
+        return;
+    }
+
+    file.close();
+
+    std::error_code ec;
+    fs::remove(LOG_BACKUP_PATH, ec);
+    fs::rename(LOG_FILE_PATH, LOG_BACKUP_PATH, ec);
+    if (ec) {
+        // 无法重命名时退回到清空日志
+        std::ofstream truncate(LOG_FILE_PATH, std::ios::trunc);
+    }
+
+    file.open(LOG_FILE_PATH, std::ios::app);
+    reopenRawLocked();
+    fileSize = 0;
+
+    if (file.is_open()) {
+        std::string notice = logtimer() + " INFO [I1000] 日志文件已超过20MB，旧日志已转存到 " + LOG_BACKUP_PATH + "\n";
+        file << notice;
+        file.flush();
+        fileSize = notice.size();
+    }
+}
@@ -0,0 +1,121 @@
+﻿// logger.h
+#pragma once
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+
+/**
+ * @brief 无锁环形缓冲区（多生产者）
+ *
+ * 基于每个槽位的序号实现，容量必须为2的幂
+ */
+class LogRingBuffer {
+public:
+    explicit LogRingBuffer(size_t capacity);
+
+    bool tryPush(std::string&& message);
+    bool tryPop(std::string& message);
+
+    /**
+     * @brief 取出一条日志但不归还槽位
+     *
+     * 返回槽位中字符串的指针，不移动、不分配内存，可以在信号处理函数中调用；
+     * 槽位不再归还，只用于崩溃前的最后写出
+     * @return 缓冲区为空时返回空指针
+     */
+    const std::string* tryTake();
+    size_t sizeApprox() const;
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::string data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+};
+
+/**
+ * @brief 异步日志器
+ *
+ * 调用方只把格式化好的日志行放入环形缓冲区，由后台线程批量写入文件，
+ * 文件大小检查与轮换也在后台线程中完成
+ */
+class Logger {
+public:
+    static Logger& instance();
+
+    /**
+     * @brief 提交一行日志（不含换行符）
+     */
+    void write(std::string&& line);
+
+    /**
+     * @brief 同步写出缓冲区中的所有日志
+     */
+    void flush();
+
+    /**
+     * @brief 停止后台线程并写出剩余日志
+     */
+    void shutdown();
+
+    /**
+     * @brief 安装退出与崩溃时的日志刷新处理
+     */
+    void installCrashHandlers();
+
+    /**
+     * @brief 崩溃时尽力写出日志（不等待被占用的锁）
+     *
+     * 会分配内存并操作文件流，只用于 std::terminate
+     */
+    void emergencyFlush();
+
+    /**
+     * @brief 在崩溃信号处理函数中写出缓冲区中的日志
+     *
+     * 只通过启动时打开的原始文件描述符写入，不分配内存、不加锁
+     */
+    void signalFlush();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+private:
+    Logger();
+    ~Logger();
+
+    void ensureStarted();
+    void writerLoop();
+    void drainLocked();
+    void openLocked();
+    void rotateIfNeededLocked();
+    void reopenRawLocked();
+
+    LogRingBuffer buffer;
+    std::ofstream file;
+    size_t fileSize = 0;
+    std::atomic<int> rawFd{ -1 };   // 与 file 指向同一日志文件，供信号处理函数写入
+
+    std::once_flag startFlag;
+    std::thread writer;
+    std::mutex fileMutex;           // 保护文件与出队（同一时刻只有一个消费者）
+    std::mutex wakeMutex;
+    std::condition_variable wakeCond;
+    std::atomic<bool> running{ false };
+    std::atomic<bool> wakeRequested{ false };
+};
+
+#endif // LOGGER_H
@@ -3,6 +3,13 @@
 #include "gamestate.h"
 #include "fileutils.h"
 #include "ui.h"
+#include "logger.h"
+#include "batch.h"
+#include "explorer.h"
+#include "savefile.h"
+#include "config.h"
+#include "pluginhost.h"
+#include "nativeplugin.h"
 #include <chrono>
 
 // 全局变量定义
@@ -11,39 +18,88 @@ bool DebugLogEnabled = false;  // 是否启用调试日志
 
 CurrentGameInfo g_currentGameInfo = { "", 0, nullptr };
 
+/**
+ * @brief 程序退出时的清理，main 的每条返回路径都经过这里
+ *
+ * 等后台存档写完、配置修改写入、插件工作进程退出后再关闭日志
+ */
+class ExitCleanup {
+public:
+    ExitCleanup() : startTime(std::chrono::high_resolution_clock::now()) {}
+
+    ~ExitCleanup() {
+        waitForPendingSaves();
+        ConfigStore::instance().flush();
+        PluginHost::instance().shutdown();
+        NativePlugins::instance().shutdown();
+
+        auto totalTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        Log(LogGrade::INFO, LogCode::GAME_START,
+            "Program terminated. Total execution time: " + std::to_string(totalTime) + "ms");
+        Logger::instance().shutdown();
+    }
+
+    ExitCleanup(const ExitCleanup&) = delete;
+    ExitCleanup& operator=(const ExitCleanup&) = delete;
+
+private:
+    std::chrono::high_resolution_clock::time_point startTime;
+};
+
 /**
  * @brief 主函数
  */
 int main(int argc, char* argv[]) {
 
-    auto programStartTime = std::chrono::high_resolution_clock::now();
+    // 退出或崩溃时确保日志写出
+    Logger::instance().installCrashHandlers();
+    ExitCleanup cleanup;
 
     Log(LogGrade::INFO, LogCode::GAME_START, "\n\n----------------------------------------");
     Log(LogGrade::INFO, LogCode::GAME_START, "The program is running...");
 
-    if (readCfg("DebugLogEnabled") == "1")
+    ConfigStore& config = ConfigStore::instance();
+    if (config.getBool("DebugLogEnabled"))
     {
         DebugLogEnabled = 1;
         Log(LogGrade::INFO, LogCode::GAME_START, "Debug logging enabled");
     }
 
-    if (!gum::GumWrapper::is_available()) {
-        Log(LogGrade::ERR, LogCode::PLUGIN_MISSING, "Gum library is not available.");
-        MessageBoxA(NULL, "警告：Gum库不可用，即将进行安装。完毕后请重新启动程序。",
-            "警告", MB_ICONWARNING | MB_OK);
-        system("winget install charmbracelet.gum");
-        cout << "安装完毕，请重新启动程序。";
-        Sleep(5000);
-        return 1;
+    // 批处理模式：无人值守运行脚本并输出统计，不需要 gum
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        BatchOptions options;
+        std::string error;
+        if (!parseBatchArgs(argc, argv, options, error)) {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+        return runBatch(options);
+    }
+
+    // 分支覆盖分析：穷举所有选择，报告可达结局和死代码
+    if (argc > 1 && std::string(argv[1]) == "--explore") {
+        ExploreOptions options;
+        std::string error;
+        if (!parseExploreArgs(argc, argv, options, error)) {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+        return runExplore(options);
+    }
+
+    // 存档导出为文本格式
+    if (argc > 1 && std::string(argv[1]) == "--export-save") {
+        return runExportSave(argc, argv);
     }
 
     // 初始化随机数种子
     srand(static_cast<unsigned int>(time(nullptr)));
-    Log(LogGrade::DEBUG, LogCode::GAME_START, "Random seed initialized.");
+    LOG_DEBUG(LogCode::GAME_START, "Random seed initialized.");
 
     // 设置控制台标题
-    SetConsoleTitleA("Paper Visual Novel");
-    Log(LogGrade::DEBUG, LogCode::GAME_START, "Console title set.");
+    platform().setTitle("Paper Visual Novel");
+    LOG_DEBUG(LogCode::GAME_START, "Console title set.");
 
     // 处理命令行参数
     if (argc > 1) {
@@ -51,13 +107,13 @@ int main(int argc, char* argv[]) {
         Log(LogGrade::INFO, LogCode::GAME_START, "Command line argument detected: " + filePath);
 
         if (!fs::exists(filePath)) {
-            MessageBoxA(NULL, "警告：指定的文件不存在",
-                "警告", MB_ICONWARNING | MB_OK);
+            platform().showMessage("警告：指定的文件不存在",
+                "警告", MessageLevel::WARNING);
             Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "File not found: " + filePath);
             return 1;
         }
 
-        string where = fs::path(filePath).parent_path().string() + "\\";
+        string where = fs::path(filePath).parent_path().string() + PVN_PATH_SEP;
         string file = fs::path(filePath).filename().string();
         RunPgn(where, file);
         return 0;
@@ -65,15 +121,15 @@ int main(int argc, char* argv[]) {
 
     Log(LogGrade::INFO, LogCode::GAME_START, "No command line arguments, starting normal flow");
 
-    if (!(readCfg("AutoRun") == "0"))
+    string pgn = config.getString("AutoRun", "0");
+    if (pgn != "0")
     {
-        string pgn = readCfg("AutoRun");
-        string where = "Novel\\" + pgn + "\\";
+        string where = "Novel" PVN_PATH_SEP + pgn + PVN_PATH_SEP;
         string file = pgn + ".pgn";
         if (!fs::exists(where + file))
         {
-            MessageBoxA(NULL, "警告：自动运行文件不存在",
-                "警告", MB_ICONWARNING | MB_OK);
+            platform().showMessage("警告：自动运行文件不存在",
+                "警告", MessageLevel::WARNING);
             Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "File not found: " + where + file);
             return 1;
         }
@@ -81,34 +137,28 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    string firstRun = readCfg("FirstRunFlag");
-    Log(LogGrade::DEBUG, LogCode::GAME_START, "First run flag checked.");
+    bool firstRun = config.getBool("FirstRunFlag");
+    LOG_DEBUG(LogCode::GAME_START, "First run flag checked.");
 
-    if (firstRun == "true" || firstRun == "1") {
-        Log(LogGrade::DEBUG, LogCode::GAME_START, "First run detected.");
-        string where = "Novel\\HelloWorld\\";
+    if (firstRun) {
+        LOG_DEBUG(LogCode::GAME_START, "First run detected.");
+        string where = "Novel" PVN_PATH_SEP "HelloWorld" PVN_PATH_SEP;
         string file = "HelloWorld.pgn";
 
         if (fs::exists(where + file)) {
-            Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Initial tutorial file found.");
-            updateFirstRunFlag(false);
+            LOG_DEBUG(LogCode::GAME_LOADED, "Initial tutorial file found.");
+            config.setBool("FirstRunFlag", false);
+            config.flush();
             RunPgn(where, file);
         }
         else {
             Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "Initial tutorial file not found.");
-            MessageBoxA(NULL, "警告：找不到初始教程文件",
-                "警告", MB_ICONWARNING | MB_OK);
+            platform().showMessage("警告：找不到初始教程文件",
+                "警告", MessageLevel::WARNING);
         }
     }
 
     Log(LogGrade::INFO, LogCode::GAME_START, "Running main menu...");
-    Run();
-
-    auto programEndTime = std::chrono::high_resolution_clock::now();
-    auto programTotalTime = std::chrono::duration_cast<std::chrono::milliseconds>(programEndTime - programStartTime).count();
-
-    Log(LogGrade::INFO, LogCode::GAME_START,
-        "Program terminated. Total execution time: " + std::to_string(programTotalTime) + "ms");
-
+    Run();     // 主菜单选择退出时返回
     return 0;
 }
\ No newline at end of file
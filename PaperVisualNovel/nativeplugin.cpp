@@ -0,0 +1,456 @@
+﻿// nativeplugin.cpp
+#include "nativeplugin.h"
+#include "compiler.h"
+#include "pluginregistry.h"
+#include "platform.h"
+#include "ui.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+namespace {
+    // init 中注册、加载成功后才写入命令表的命令
+    struct PendingCommand {
+        std::string name;
+        PvnCommandFn handler = nullptr;
+        void* userData = nullptr;
+    };
+
+    std::string lowerName(const std::string& name) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return lower;
+    }
+
+    bool isCommandName(const char* name) {
+        if (!name || !*name || std::isdigit(static_cast<unsigned char>(*name))) {
+            return false;
+        }
+        for (const char* c = name; *c; c++) {
+            if (!std::isalnum(static_cast<unsigned char>(*c)) && *c != '_') {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/**
+ * @brief 插件回调收到的调用上下文
+ */
+struct PvnHost {
+    std::string pluginName;
+    const GameState* gameState = nullptr;   // 读取变量（后台调用时为快照），init 时为空
+    PluginResult* result = nullptr;         // 收集输出、变量写入和失败原因
+
+    // 以下只在 init 期间使用
+    bool initializing = false;
+    std::vector<PendingCommand> registered;
+};
+
+// ==================== 解释器函数表 ====================
+
+namespace {
+    // 本次调用中最后一次写入的同名变量
+    const PluginVariable* findWritten(const PvnHost* host, const char* name, bool isString) {
+        const auto& vars = host->result->vars;
+        for (auto it = vars.rbegin(); it != vars.rend(); ++it) {
+            if (it->isString == isString && it->name == name) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    bool canWrite(PvnHost* host, const char* name) {
+        if (!host || !name || !*name) {
+            return false;
+        }
+        if (host->initializing) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                "Native plugin " + host->pluginName + " wrote variable " + name + " during init, ignored");
+            return false;
+        }
+        return true;
+    }
+
+    int hostGetInt(PvnHost* host, const char* name) {
+        if (!host || !name) {
+            return 0;
+        }
+        if (const PluginVariable* written = findWritten(host, name, false)) {
+            return written->intValue;
+        }
+        return host->gameState ? host->gameState->getVar(name) : 0;
+    }
+
+    void hostSetInt(PvnHost* host, const char* name, int value) {
+        if (!canWrite(host, name)) {
+            return;
+        }
+        PluginVariable var;
+        var.name = name;
+        var.intValue = value;
+        host->result->vars.push_back(std::move(var));
+    }
+
+    size_t hostGetString(PvnHost* host, const char* name, char* buffer, size_t bufferSize) {
+        std::string value;
+        if (host && name) {
+            if (const PluginVariable* written = findWritten(host, name, true)) {
+                value = written->stringValue;
+            }
+            else if (host->gameState) {
+                value = host->gameState->getStringVar(name);
+            }
+        }
+
+        if (buffer && bufferSize > 0) {
+            size_t copied = std::min(value.size(), bufferSize - 1);
+            std::memcpy(buffer, value.data(), copied);
+            buffer[copied] = '\0';
+        }
+        return value.size();
+    }
+
+    void hostSetString(PvnHost* host, const char* name, const char* value) {
+        if (!canWrite(host, name)) {
+            return;
+        }
+        PluginVariable var;
+        var.name = name;
+        var.isString = true;
+        var.stringValue = value ? value : "";
+        host->result->vars.push_back(std::move(var));
+    }
+
+    void hostWrite(PvnHost* host, const char* text) {
+        if (host && text) {
+            host->result->output += text;
+        }
+    }
+
+    void hostFail(PvnHost* host, const char* message) {
+        if (host) {
+            host->result->error = message ? message : "";
+        }
+    }
+
+    void hostLog(PvnHost* host, int level, const char* message) {
+        if (!message) {
+            return;
+        }
+        std::string text = "[" + (host ? host->pluginName : std::string("native")) + "] " + message;
+        if (level >= PVN_LOG_ERROR) {
+            Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED, text);
+        }
+        else if (level == PVN_LOG_WARNING) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED, text);
+        }
+        else {
+            Log(LogGrade::INFO, LogCode::PLUGIN_LOADED, text);
+        }
+    }
+
+    int hostRegisterCommand(PvnHost* host, const char* name, PvnCommandFn handler, void* userData) {
+        if (!host || !host->initializing) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                "registerCommand called outside init, ignored");
+            return -1;
+        }
+        if (!isCommandName(name) || !handler) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                "Native plugin " + host->pluginName + " registered an invalid command: " +
+                (name ? name : "(null)"));
+            return -1;
+        }
+
+        bool taken = CommandTable::instance().has(name) ||
+            std::any_of(host->registered.begin(), host->registered.end(),
+                [name](const PendingCommand& command) { return command.name == name; });
+        if (taken) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                "Native plugin " + host->pluginName + " cannot register command '" + name +
+                "': already registered");
+            return -1;
+        }
+
+        host->registered.push_back({ name, handler, userData });
+        return 0;
+    }
+
+    /**
+     * @brief 原生插件命令的编译函数：命令字之后的内容作为参数，编号来自命令表
+     */
+    Instruction compileNativeCommand(CommandContext& context) {
+        Instruction instruction;
+        instruction.op = OpCode::NATIVE_COMMAND;
+        instruction.name = context.cmd;
+        instruction.slot = context.data;
+
+        std::string args;
+        getline(context.args, args);
+        args = trim(args);
+        if (!args.empty()) {
+            instruction.segments = splitPluginArgs(args, context.where);
+        }
+        return instruction;
+    }
+
+    const PvnHostApi kHostApi = {
+        PVN_PLUGIN_API_VERSION,
+        sizeof(PvnHostApi),
+        hostGetInt,
+        hostSetInt,
+        hostGetString,
+        hostSetString,
+        hostWrite,
+        hostFail,
+        hostLog,
+        hostRegisterCommand
+    };
+
+    // ==================== 加载 ====================
+
+    /**
+     * @brief RunFile 对应的动态库路径，只允许插件目录内的文件
+     */
+    bool resolveLibraryPath(const PluginInfo& plugin, std::string& path, std::string& errorMessage) {
+        fs::path file(plugin.runFile);
+        if (file.empty() || file.is_absolute() || file.has_root_name() ||
+            std::any_of(file.begin(), file.end(), [](const fs::path& part) { return part == ".."; })) {
+            errorMessage = "RunFile must be a library inside Plugins" PVN_PATH_SEP + plugin.name;
+            return false;
+        }
+        if (!file.has_extension()) {
+            file += dynamicLibrarySuffix();
+        }
+
+        path = (fs::path("Plugins") / plugin.name / file).string();
+        std::error_code ec;
+        if (!fs::is_regular_file(path, ec)) {
+            errorMessage = "library not found: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 检查插件返回的描述是否与解释器的接口版本兼容
+     */
+    bool checkDescriptor(const PvnPlugin* descriptor, std::string& errorMessage) {
+        if (!descriptor) {
+            errorMessage = "plugin does not support host API v" + std::to_string(PVN_PLUGIN_API_VERSION);
+            return false;
+        }
+        if (descriptor->apiVersion < PVN_PLUGIN_MIN_API_VERSION ||
+            descriptor->apiVersion > PVN_PLUGIN_API_VERSION) {
+            errorMessage = "plugin implements API v" + std::to_string(descriptor->apiVersion) +
+                ", host supports v" + std::to_string(PVN_PLUGIN_MIN_API_VERSION) +
+                "-v" + std::to_string(PVN_PLUGIN_API_VERSION);
+            return false;
+        }
+        // 目前只有 v1；以后的版本在末尾追加字段，按声明的版本检查最小长度
+        if (descriptor->size < sizeof(PvnPlugin)) {
+            errorMessage = "plugin descriptor is smaller than API v" +
+                std::to_string(descriptor->apiVersion) + " requires";
+            return false;
+        }
+        return true;
+    }
+}
+
+NativePlugins& NativePlugins::instance() {
+    static NativePlugins plugins;
+    return plugins;
+}
+
+NativePlugins::NativePlugins() {
+    // 先完成命令表的构造，静态析构时卸载插件仍可从命令表中移除其命令
+    CommandTable::instance();
+}
+
+NativePlugins::~NativePlugins() {
+    // 静态析构阶段不写日志
+    shutdown();
+}
+
+NativePlugins::Library* NativePlugins::loadLibrary(const PluginInfo& plugin, std::string& errorMessage) {
+    std::string key = lowerName(plugin.name);
+    auto it = libraries.find(key);
+    if (it != libraries.end()) {
+        return it->second.get();
+    }
+
+    auto loadStart = std::chrono::high_resolution_clock::now();
+
+    std::string path;
+    if (!resolveLibraryPath(plugin, path, errorMessage)) {
+        return nullptr;
+    }
+
+    auto library = std::make_unique<Library>();
+    library->name = plugin.name;
+    library->handle = loadDynamicLibrary(path, errorMessage);
+    if (!library->handle) {
+        return nullptr;
+    }
+
+    // 只查找约定的入口符号，其余函数都通过描述和函数表交换
+    auto entry = reinterpret_cast<PvnPluginEntryFn>(library->handle->symbol(PVN_PLUGIN_ENTRY_NAME));
+    if (!entry) {
+        errorMessage = std::string("missing export ") + PVN_PLUGIN_ENTRY_NAME + " in " + path;
+        return nullptr;
+    }
+
+    library->descriptor = entry(&kHostApi);
+    if (!checkDescriptor(library->descriptor, errorMessage)) {
+        return nullptr;
+    }
+
+    const PvnPlugin& descriptor = *library->descriptor;
+    if (descriptor.init) {
+        PluginResult initResult;
+        PvnHost host;
+        host.pluginName = plugin.name;
+        host.result = &initResult;
+        host.initializing = true;
+
+        int status = descriptor.init(&host);
+        if (status != 0) {
+            errorMessage = initResult.error.empty() ?
+                "init returned " + std::to_string(status) : initResult.error;
+            // init 可能已分配了部分资源，卸载前同样交给 shutdown 释放
+            if (descriptor.shutdown) {
+                descriptor.shutdown();
+            }
+            return nullptr;
+        }
+        if (!initResult.output.empty()) {
+            Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+                "[" + plugin.name + "] " + initResult.output);
+        }
+
+        for (auto& command : host.registered) {
+            int commandId = static_cast<int>(commands.size());
+            if (!CommandTable::instance().add(command.name, compileNativeCommand, commandId)) {
+                Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                    "Native plugin " + plugin.name + " cannot register command '" + command.name +
+                    "': already registered");
+                continue;
+            }
+            commands.push_back({ command.name, library.get(), command.handler, command.userData });
+            Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+                "Native plugin " + plugin.name + " registered command: " + command.name);
+        }
+    }
+
+    auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - loadStart).count();
+    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+        "Native plugin loaded: " + plugin.name +
+        (descriptor.version ? std::string(" v") + descriptor.version : std::string()) +
+        " (API v" + std::to_string(descriptor.apiVersion) + ", took " + std::to_string(loadTime) + "us)");
+
+    Library* loaded = library.get();
+    libraries[key] = std::move(library);
+    return loaded;
+}
+
+bool NativePlugins::load(const PluginInfo& plugin, std::string& errorMessage) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loadLibrary(plugin, errorMessage) != nullptr;
+}
+
+void NativePlugins::loadDependencies(const std::vector<PluginDependency>& dependencies) {
+    for (const auto& dependency : dependencies) {
+        PluginRecord record;
+        if (!PluginRegistry::instance().lookup(dependency.name, record) ||
+            !record.runnable() || record.info.mode != PluginMode::NATIVE) {
+            continue;
+        }
+
+        std::string errorMessage;
+        if (!load(record.info, errorMessage)) {
+            reportPluginError(record.info.name, errorMessage);
+        }
+    }
+}
+
+// ==================== 调用 ====================
+
+PluginResult NativePlugins::invoke(Library& library, const GameState* gameState,
+    const std::function<int(PvnHost*)>& call) {
+    PluginResult result;
+    result.pluginName = library.name;
+
+    PvnHost host;
+    host.pluginName = library.name;
+    host.gameState = gameState;
+    host.result = &result;
+
+    std::lock_guard<std::mutex> lock(library.callMutex);
+    int status = call(&host);
+    result.success = status == 0;
+    if (!result.success && result.error.empty()) {
+        result.error = "returned " + std::to_string(status);
+    }
+    return result;
+}
+
+PluginResult NativePlugins::run(const PluginInfo& plugin, const std::string& args, const GameState* gameState) {
+    Library* library;
+    PluginResult failure;
+    failure.pluginName = plugin.name;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        library = loadLibrary(plugin, failure.error);
+    }
+    if (!library) {
+        return failure;
+    }
+
+    auto run = library->descriptor->run;
+    if (!run) {
+        failure.error = "plugin has no run entry, use the commands it registers";
+        return failure;
+    }
+    return invoke(*library, gameState, [run, &args](PvnHost* host) {
+        return run(host, args.c_str());
+    });
+}
+
+PluginResult NativePlugins::runCommand(int commandId, const std::string& args, const GameState* gameState) {
+    Command command;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (commandId < 0 || commandId >= static_cast<int>(commands.size())) {
+            PluginResult failure;
+            failure.error = "native command #" + std::to_string(commandId) + " is not loaded";
+            return failure;
+        }
+        command = commands[commandId];
+    }
+
+    return invoke(*command.library, gameState, [&command, &args](PvnHost* host) {
+        return command.handler(host, args.c_str(), command.userData);
+    });
+}
+
+void NativePlugins::shutdown() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& command : commands) {
+        CommandTable::instance().remove(command.name);
+    }
+    commands.clear();
+    for (auto& entry : libraries) {
+        Library& library = *entry.second;
+        std::lock_guard<std::mutex> callLock(library.callMutex);
+        if (library.descriptor && library.descriptor->shutdown) {
+            library.descriptor->shutdown();
+        }
+    }
+    libraries.clear();
+}
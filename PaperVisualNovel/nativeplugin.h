@@ -0,0 +1,87 @@
+﻿// nativeplugin.h
+#pragma once
+#ifndef NATIVEPLUGIN_H
+#define NATIVEPLUGIN_H
+
+#include "pluginhost.h"
+#include "pvn_plugin.h"
+#include "scriptindex.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 进程内加载的原生插件（about.cfg 中 RunCommand = native）
+ *
+ * RunFile 指向插件目录中的动态库（省略扩展名时按系统补全为 .dll / .so / .dylib），
+ * 只查找导出符号 pvn_plugin_entry，接口见 pvn_plugin.h。
+ * 插件第一次使用时加载并协商接口版本，之后一直驻留到程序退出；
+ * 插件注册的命令登记到 CommandTable，脚本编译时解析为命令编号，执行时直接按编号调用
+ */
+class NativePlugins {
+public:
+    static NativePlugins& instance();
+
+    /**
+     * @brief 加载插件（已加载时直接返回）
+     * @param errorMessage 失败时的错误描述
+     */
+    bool load(const PluginInfo& plugin, std::string& errorMessage);
+
+    /**
+     * @brief 加载脚本 use 声明的原生插件，使其注册的命令在编译前可用
+     */
+    void loadDependencies(const std::vector<PluginDependency>& dependencies);
+
+    /**
+     * @brief 调用插件的 run（plugin 命令）
+     * @param gameState 读取变量的游戏状态，后台调用时为调用开始时的快照
+     */
+    PluginResult run(const PluginInfo& plugin, const std::string& args, const GameState* gameState);
+
+    /**
+     * @brief 执行插件注册的命令
+     * @param commandId 编译时从命令表得到的编号（Instruction::slot）
+     */
+    PluginResult runCommand(int commandId, const std::string& args, const GameState* gameState);
+
+    /**
+     * @brief 调用各插件的 shutdown 并卸载全部动态库
+     */
+    void shutdown();
+
+private:
+    NativePlugins();
+    ~NativePlugins();
+    NativePlugins(const NativePlugins&) = delete;
+    NativePlugins& operator=(const NativePlugins&) = delete;
+
+    struct Library {
+        std::string name;
+        std::unique_ptr<DynamicLibrary> handle;
+        const PvnPlugin* descriptor = nullptr;
+        std::mutex callMutex;       // 同一插件的调用串行执行
+    };
+
+    struct Command {
+        std::string name;
+        Library* library = nullptr;
+        PvnCommandFn handler = nullptr;
+        void* userData = nullptr;
+    };
+
+    Library* loadLibrary(const PluginInfo& plugin, std::string& errorMessage);
+
+    // 在插件的调用锁内执行一次回调，收集输出、变量写入和失败原因
+    PluginResult invoke(Library& library, const GameState* gameState,
+        const std::function<int(PvnHost*)>& call);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<Library>> libraries;   // 小写插件名 → 已加载的库
+    std::vector<Command> commands;      // 按编号存放，卸载前编号不变
+};
+
+#endif // NATIVEPLUGIN_H
@@ -6,23 +6,27 @@
 #include "gamestate.h"
 #include "condition.h"
 #include <map>
+#include <string_view>
 
 //12
 /**
- * @brief ѡѡṹ
+ * @brief 选择选项结构
  */
 struct ChoiceOption {
-    std::string label;      // תıǩ
-    std::string text;       // ʾı
+    std::string label;      // 跳转的标签
+    std::string text;       // 显示的文本
+    int jumpLine = -1;      // 编译期解析的跳转行号（1-based，-1表示无效）
 };
 
+struct Instruction;
+
 /**
- * @brief ǩӳ
+ * @brief 解析标签映射
  */
-std::map<std::string, int> parseLabels(const std::vector<std::string>& lines);
+std::map<std::string, int> parseLabels(const std::vector<std::string_view>& lines);
 
 /**
- * @brief תĿ
+ * @brief 解析跳转目标
  */
 int parseJumpTarget(const std::string& target, const std::map<std::string, int>& labels,
                     bool& isLabel);
@@ -31,12 +35,12 @@ int parseJumpTarget(const std::string& target, const std::map<std::string, int>&
 
 
 /**
- * @brief ִеPGN
- * @return ִ״̬-1ʾ˳Ϸ0ʾִУ1ʾתָ
+ * @brief 执行已编译的指令
+ * @param instruction 编译后的指令
+ * @param line 源代码行（用于错误提示）
+ * @return 执行状态和下一行：-2不保存退出，-1退出游戏，0正常执行，1跳转到指定行，2回到上一句
  */
-std::pair<int, size_t> executeLine(const std::string& line, GameState& gameState,
-                                   size_t currentLine, const std::vector<std::string>& allLines,
-                                   const std::string& where, int indentLevel,
-                                   const std::map<std::string, int>& labels);
+std::pair<int, size_t> executeInstruction(const Instruction& instruction, std::string_view line,
+                                          GameState& gameState, size_t currentLine);
 
 #endif // PARSER_H
\ No newline at end of file
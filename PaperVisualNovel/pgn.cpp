@@ -1,9 +1,19 @@
 ﻿// pgn.cpp
 #include "gamestate.h"
 #include "parser.h"
+#include "compiler.h"
 #include "fileutils.h"
 #include "ui.h"
 #include "condition.h"
+#include "scriptindex.h"
+#include "indexcache.h"
+#include "savefile.h"
+#include "autosave.h"
+#include "rewind.h"
+#include "selector.h"
+#include "pluginregistry.h"
+#include "pluginhost.h"
+#include "nativeplugin.h"
 #include <chrono>
 
 // ==================== 字符串转整数（安全版） ====================
@@ -24,22 +34,17 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
 
     auto gameStartTime = std::chrono::high_resolution_clock::now();
 
-    system("cls");
+    platform().clearScreen();
 
     Log(LogGrade::INFO, LogCode::GAME_LOADED, "Preparing to run game " + file);
     string pgn = where + file;
-    Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Game file path: " + pgn);
+    LOG_DEBUG(LogCode::GAME_LOADED, "Game file path: ", pgn);
 
-    // 使用Windows API进行正确的编码转换
-    int len = MultiByteToWideChar(CP_ACP, 0, file.c_str(), -1, NULL, 0);
-    wchar_t* wstr = new wchar_t[len];
-    MultiByteToWideChar(CP_ACP, 0, file.c_str(), -1, wstr, len);
-    SetConsoleTitle((L"Paper Visual Novel   " + std::wstring(wstr)).c_str());
-    delete[] wstr;
+    platform().setTitle("Paper Visual Novel   " + file);
 
     auto fileReadStart = std::chrono::high_resolution_clock::now();
-    ifstream in(pgn);
-    if (!in.is_open()) {
+    ScriptSource source;
+    if (!source.load(pgn)) {
         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to open game file " + pgn);
         formatErrorOutput(
             logCodeToString(LogCode::FILE_OPEN_FAILED),
@@ -51,31 +56,34 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
             "Check if file exists and has read permissions",
             "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3004.md"
         );
-        MessageBoxA(NULL, "错误：无法打开游戏文件", "错误", MB_ICONERROR | MB_OK);
+        platform().showMessage("错误：无法打开游戏文件", "错误", MessageLevel::ERR);
         return;
     }
 
-    vector<string> lines;
-    string line;
-    size_t fileSize = 0;
-
-    while (getline(in, line)) {
-        lines.push_back(line);
-        fileSize += line.length() + 2; // 估计文件大小
-    }
-    in.close();
+    const vector<std::string_view>& lines = source.lines();
 
     auto fileReadEnd = std::chrono::high_resolution_clock::now();
     auto fileReadTime = std::chrono::duration_cast<std::chrono::milliseconds>(fileReadEnd - fileReadStart).count();
 
     
 
-    auto labelParseStart = std::chrono::high_resolution_clock::now();
-    map<string, int> labels = parseLabels(lines);
-    auto labelParseEnd = std::chrono::high_resolution_clock::now();
-    auto labelParseTime = std::chrono::duration_cast<std::chrono::milliseconds>(labelParseEnd - labelParseStart).count();
+    // 单遍扫描得到标签、结局、插件依赖和跳转目标，编译和结局统计共用
+    ScriptIndex index = buildScriptIndex(lines);
+    for (const auto& jump : index.jumps) {
+        if (jump.jumpLine < 0) {
+            Log(LogGrade::WARNING, LogCode::JUMP_INVALID,
+                "Unresolved " + jump.cmd + " target at line " + std::to_string(jump.line) + ": " + jump.target);
+        }
+    }
 
-    
+    // use 声明的插件依赖在加载时解析一次，执行 use / plugin 时只查询注册表；
+    // 原生插件在编译前加载，其注册的命令在编译时即可解析
+    if (!index.plugins.empty()) {
+        PluginRegistry::instance().resolveDependencies(index.plugins);
+        NativePlugins::instance().loadDependencies(index.plugins);
+    }
+
+    CompiledScript script = compileScript(lines, index, where);
 
     GameState gameState;
 
@@ -85,10 +93,10 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
     }
     else {
         string gameFolder = "";
-        size_t novelPos = where.find("Novel\\");
+        size_t novelPos = where.find("Novel" PVN_PATH_SEP);
         if (novelPos != string::npos) {
             size_t startPos = novelPos + 6;
-            size_t endPos = where.find("\\", startPos);
+            size_t endPos = where.find(PVN_PATH_SEP, startPos);
             if (endPos != string::npos) {
                 gameFolder = where.substr(startPos, endPos - startPos);
             }
@@ -107,19 +115,22 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
         }
     }
 
-    auto allEndingsStart = std::chrono::high_resolution_clock::now();
-    loadAllEndings(lines, gameState);
-    auto allEndingsEnd = std::chrono::high_resolution_clock::now();
-    auto allEndingsTime = std::chrono::duration_cast<std::chrono::milliseconds>(allEndingsEnd - allEndingsStart).count();
+    registerEndings(index, gameState);
 
     
 
     size_t currentLine = loadFromSave ? savedLine : 0;
 
+    // 按行数、时间和 choose / plugin 自动存档到轮换槽位
+    AutosaveScheduler autosave(pgn, loadAutosaveOptions());
+
+    // say / choose 前的状态快照，用于回到上一句
+    RewindHistory rewindHistory;
+
     // 设置全局游戏信息
     g_currentGameInfo.scriptPath = pgn;
     g_currentGameInfo.gameState = &gameState;
-    Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Set global game info");
+    LOG_DEBUG(LogCode::GAME_LOADED, "Set global game info");
 
     auto gameLoadEnd = std::chrono::high_resolution_clock::now();
     auto gameLoadTime = std::chrono::duration_cast<std::chrono::milliseconds>(gameLoadEnd - gameStartTime).count();
@@ -136,8 +147,15 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
         // 更新当前行号
         g_currentGameInfo.currentLine = currentLine;
 
-        auto [status, nextLine] = executeLine(lines[currentLine], gameState,
-            currentLine, lines, where, 0, labels);
+        autosave.beforeInstruction(script.code[currentLine], currentLine, gameState);
+
+        OpCode op = script.code[currentLine].op;
+        if (op == OpCode::SAY || op == OpCode::SAYVAR || op == OpCode::CHOOSE) {
+            rewindHistory.record(currentLine, gameState);
+        }
+
+        auto [status, nextLine] = executeInstruction(script.code[currentLine], lines[currentLine],
+            gameState, currentLine);
 
         auto lineExecEnd = std::chrono::high_resolution_clock::now();
         auto lineExecTime = std::chrono::duration_cast<std::chrono::microseconds>(lineExecEnd - lineExecStart).count();
@@ -148,15 +166,27 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
 
         if (status == -1) {
             Log(LogGrade::INFO, LogCode::GAME_SAVED, "ESC menu selected save and exit");
+            PluginTasks::instance().discardAll();
             return;
         }
         else if (status == -2) {
             Log(LogGrade::INFO, LogCode::GAME_START, "ESC menu selected exit without saving");
+            PluginTasks::instance().discardAll();
             return;
         }
         else if (status == 1) {
             currentLine = nextLine;
-            Log(LogGrade::DEBUG, LogCode::GAME_START, "DEBUG terminal Jumped to line " + to_string(currentLine + 1));
+            LOG_DEBUG(LogCode::GAME_START, "DEBUG terminal Jumped to line ", currentLine + 1);
+        }
+        else if (status == 2) {
+            if (rewindHistory.rewind(currentLine, gameState)) {
+                cout << ANSI_GRAY << "<< 回到上一句" << "\033[37m" << endl;
+                LOG_DEBUG(LogCode::GAME_START, "Rewound to line ", currentLine + 1);
+            }
+            // 没有更早的记录时停留在当前行
+            else {
+                currentLine = nextLine;
+            }
         }
         else {
             currentLine = nextLine;
@@ -170,26 +200,74 @@ void RunPgn(const string& where, const string& file, bool loadFromSave,
 
     if (executedLines > 0) {
         float avgTimePerLine = static_cast<float>(loopTotalTime) / executedLines;
-        Log(LogGrade::DEBUG, LogCode::PERFORMANCE,
-            "Average execution time: " + std::to_string(avgTimePerLine) + "ms per line");
+        LOG_DEBUG(LogCode::PERFORMANCE,
+            "Average execution time: ", avgTimePerLine, "ms per line");
     }
 
-    // 游戏正常结束，清除全局信息
+    // 游戏正常结束，清除全局信息和未取回的后台插件调用
     g_currentGameInfo = { "", 0, nullptr };
+    PluginTasks::instance().discardAll();
     Log(LogGrade::INFO, LogCode::GAME_START, "Game loop finished");
 
     cout << "脚本执行完毕" << endl;
-    system("pause");
+    platform().waitForKey();
     Log(LogGrade::INFO, LogCode::GAME_START, "Game finished");
     return;
 }
 
-// 实现 Run() 函数
+/**
+ * @brief 输出游戏列表中的一行（序号、结局收集情况、存档状态）
+ */
+static void printGameListEntry(size_t i, const GameListEntry& entry) {
+    int collected = entry.collected;
+    int total = entry.total;
+
+    cout << i + 1 << ". " << entry.folderName;
+
+    if (total > 0) {
+        float percentage = (total > 0) ? (static_cast<float>(collected) / total * 100) : 0;
+
+        // 亮绿 / 亮黄 / 亮紫 / 灰色
+        if (collected == total && total > 0) {
+            cout << "\033[92m";
+            cout << " [" << collected << "/" << total << "]";
+        }
+        else if (percentage >= 50) {
+            cout << "\033[93m";
+            cout << " [" << collected << "/" << total << "]";
+        }
+        else if (collected > 0) {
+            cout << "\033[95m";
+            cout << " [" << collected << "/" << total << "]";
+        }
+        else {
+            cout << ANSI_GRAY;
+            cout << " [" << collected << "/" << total << "]";
+        }
+
+        cout << ANSI_WHITE;
+    }
+    else {
+        cout << " [无结局]";
+    }
+
+    cout << "   ";
+    if (entry.saveInfo != "无存档") {
+        cout << "\033[92m" << entry.saveInfo << ANSI_WHITE;
+    }
+    else {
+        cout << entry.saveInfo;
+    }
+
+    cout << endl;
+}
+
+// 实现 Run() 函数，主菜单选择退出时返回
 void Run() {
 
     while (true) {
         Log(LogGrade::INFO, LogCode::GAME_START, "Running main menu...");
-        system("cls");
+        platform().clearScreen();
         printf("%s\n", "   ___  ______  __");
         printf("%s\n", "  / _ \\/ ___/ |/ /");
         printf("%s\n", " / ___/ (_ /    / ");
@@ -201,6 +279,11 @@ void Run() {
         vnout(VERSION, 0.8, white, true);
         cout << endl;
         Log(LogGrade::INFO, LogCode::GAME_START, "Running main menu Done");
+
+        // 后台存档写入失败时在回到主菜单后提示
+        for (const auto& failedSave : takeFailedSaves()) {
+            platform().showMessage("错误：存档写入失败 " + failedSave, "错误", MessageLevel::ERR);
+        }
         std::vector<std::string> menu_options = {
          "1. 加载游戏",
          "2. 教程",
@@ -208,107 +291,47 @@ void Run() {
          "4. 关于",
          "5. 退出"
         };
-        std::string selected = gum::GumWrapper::choose(
-            menu_options
-        );
+        int selected = chooseFromMenu(menu_options);
         std::string op = "";
-        if (!selected.empty()) {
-            // 提取第一个字符作为选项（"1. 加载游戏" -> "1"）
-            op = selected.substr(0, 1);
-
+        if (selected >= 0) {
+            op = std::to_string(selected + 1);
         }
         else {
             cout << "未选择任何选项" << endl;
         }
         Log(LogGrade::INFO, LogCode::GAME_START, "Running main menu op: " + op);
         if (op == "1") {
-            string basePath = "Novel\\";
+            string basePath = "Novel" PVN_PATH_SEP;
             Log(LogGrade::INFO, LogCode::GAME_START, "Load Game choose Menu.");
             if (!fs::exists(basePath)) {
                 Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "Game directory does not exist");
-                MessageBoxA(NULL, "错误：游戏目录不存在", "错误", MB_ICONERROR | MB_OK);
+                platform().showMessage("错误：游戏目录不存在", "错误", MessageLevel::ERR);
                 continue;
             }
 
-            vector<string> folderNames;
-            vector<pair<int, int>> endingStats;
-            vector<string> saveInfos;
-
+            vector<pair<string, string>> folders;
             for (const auto& entry : fs::directory_iterator(basePath)) {
                 if (entry.is_directory()) {
-                    string folderPath = entry.path().string() + "\\";
-                    string folderName = getGameFolderName(entry.path().string());
-                    folderNames.push_back(folderName);
-
-                    auto stats = getGameEndingStats(folderPath);
-                    endingStats.push_back(stats);
-
-                    string pgnFile = folderPath + folderName + ".pgn";
-                    if (fs::exists(pgnFile)) {
-                        saveInfos.push_back(getSaveInfo(pgnFile));
-                    }
-                    else {
-                        saveInfos.push_back("无游戏文件");
-                    }
+                    folders.push_back({ entry.path().string() + PVN_PATH_SEP, getGameFolderName(entry.path().string()) });
                 }
             }
-            if (folderNames.empty()) {
+            if (folders.empty()) {
                 Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "No game folders found");
-                MessageBoxA(NULL, "错误：没有找到游戏文件夹", "错误", MB_ICONERROR | MB_OK);
+                platform().showMessage("错误：没有找到游戏文件夹", "错误", MessageLevel::ERR);
             }
             else {
-                system("cls");
+                platform().clearScreen();
                 cout << "========== 游戏列表 ==========" << endl;
                 cout << "（括号内为结局收集情况，右侧为存档状态）" << endl;
                 cout << "==============================" << endl;
                 cout << endl;
 
-                for (size_t i = 0; i < folderNames.size(); i++) {
-                    int collected = endingStats[i].first;
-                    int total = endingStats[i].second;
-
-                    cout << i + 1 << ". " << folderNames[i];
-
-                    if (total > 0) {
-                        float percentage = (total > 0) ? (static_cast<float>(collected) / total * 100) : 0;
-
-                        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-
-                        if (collected == total && total > 0) {
-                            SetConsoleTextAttribute(hConsole, 10);
-                            cout << " [" << collected << "/" << total << "]";
-                        }
-                        else if (percentage >= 50) {
-                            SetConsoleTextAttribute(hConsole, 14);
-                            cout << " [" << collected << "/" << total << "]";
-                        }
-                        else if (collected > 0) {
-                            SetConsoleTextAttribute(hConsole, 13);
-                            cout << " [" << collected << "/" << total << "]";
-                        }
-                        else {
-                            SetConsoleTextAttribute(hConsole, 8);
-                            cout << " [" << collected << "/" << total << "]";
-                        }
-
-                        SetConsoleTextAttribute(hConsole, 7);
-                    }
-                    else {
-                        cout << " [无结局]";
-                    }
-
-                    cout << "   ";
-                    if (saveInfos[i] != "无存档") {
-                        SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 10);
-                        cout << saveInfos[i];
-                        SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 7);
-                    }
-                    else {
-                        cout << saveInfos[i];
-                    }
-
-                    cout << endl;
-                }
+                // 各文件夹并发读取（结局统计和存档摘要取自索引缓存），按顺序逐条显示
+                vector<string> folderNames;
+                scanGameLibrary(folders, [&folderNames](size_t i, const GameListEntry& entry) {
+                    folderNames.push_back(entry.folderName);
+                    printGameListEntry(i, entry);
+                });
 
                 cout << endl;
                 cout << "请选择游戏 (输入数字): ";
@@ -317,7 +340,7 @@ void Run() {
             getKeyforGameMenu:
                 string choice_str = getKeyName();
                 int choice_num;
-                Log(LogGrade::DEBUG, LogCode::GAME_START, "menu choice_str: " + choice_str);
+                LOG_DEBUG(LogCode::GAME_START, "menu choice_str: ", choice_str);
                 if (choice_str == "ESC") {
                     Log(LogGrade::INFO, LogCode::GAME_START, "Game choose menu exit.");
                     continue;
@@ -328,26 +351,26 @@ void Run() {
                     choice_num < 1 ||
                     choice_num > static_cast<int>(folderNames.size())) {
                     Log(LogGrade::ERR, LogCode::JUMP_INVALID, "Invalid choice");
-                    MessageBoxA(NULL, "错误：无效的选择", "错误", MB_ICONERROR | MB_OK);
+                    platform().showMessage("错误：无效的选择", "错误", MessageLevel::ERR);
                     goto getKeyforGameMenu;
                 }
 
-                string where = basePath + folderNames[choice_num - 1] + "\\";
+                string where = basePath + folderNames[choice_num - 1] + PVN_PATH_SEP;
                 string file = folderNames[choice_num - 1] + ".pgn";
                 string full_path = where + file;
 
                 Log(LogGrade::INFO, LogCode::GAME_LOADED, "Game choose: " + file);
-                Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Game path: " + full_path);
+                LOG_DEBUG(LogCode::GAME_LOADED, "Game path: ", full_path);
                 if (!fs::exists(full_path)) {
                     Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "Game file not found");
-                    MessageBoxA(NULL, "错误：找不到游戏文件", "错误", MB_ICONERROR | MB_OK);
+                    platform().showMessage("错误：找不到游戏文件", "错误", MessageLevel::ERR);
                     goto getKeyforGameMenu;
                     return;
                 }
 
                 if (hasSaveFile(full_path)) {
                     Log(LogGrade::INFO, LogCode::GAME_LOADED, "Save file found");
-                    system("cls");
+                    platform().clearScreen();
                     cout << "检测到存档文件，是否继续游戏？" << endl;
                     vector<string> save_menu_options = {
                         "1. 继续游戏（从存档开始）",
@@ -356,51 +379,25 @@ void Run() {
                         "4. 返回"
                     };
 
-                    std::string selected = "";
-                    std::string saveChoice = "";
-
-                    if (gum::GumWrapper::is_available()) {
-                        try {
-                            selected = gum::GumWrapper::choose(save_menu_options);
+                    // 按 ESC 取消时返回
+                    int selected = chooseFromMenu(save_menu_options);
+                    std::string saveChoice = selected >= 0 ? std::to_string(selected + 1) : "4";
 
-                            if (!selected.empty()) {
-                                saveChoice = selected.substr(0, 1);
-                            }
-                        }
-                        catch (const std::exception& e) {
-                            Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED, "Gum selection error: " + std::string(e.what()));
-                            saveChoice = "";
-                        }
-                    }
-
-                    if (saveChoice.empty() || !(saveChoice == "1" || saveChoice == "2" || saveChoice == "3" || saveChoice == "4")) {
-                        Log(LogGrade::WARNING, LogCode::FALLBACK_USED, "Falling back to original save menu display");
-                        cout << "==============================" << endl;
-                        cout << "检测到存档文件" << endl;
-                        cout << "1. 继续游戏（从存档开始）" << endl;
-                        cout << "2. 开始新游戏" << endl;
-                        cout << "3. 删除存档" << endl;
-                        cout << "4. 返回" << endl;
-                        cout << "==============================" << endl;
-                        cout << "请选择: ";
-
-                        saveChoice = getKeyName();
-                    }
-
-                    Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Save choice: " + saveChoice);
+                    LOG_DEBUG(LogCode::GAME_LOADED, "Save choice: ", saveChoice);
 
                     if (saveChoice == "1") {
+                        // 菜单保存和自动存档槽位中最近的一个
                         SaveData saveData;
-                        fs::path savePath = fs::path(where) / "saves" / "autosave.sav";
-                        Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Load save path: " + savePath.string());
+                        std::string savePath = findLatestSave(full_path);
+                        LOG_DEBUG(LogCode::GAME_LOADED, "Load save path: ", savePath);
 
-                        if (loadGame(savePath.string(), saveData)) {
+                        if (loadGame(savePath, saveData)) {
                             Log(LogGrade::INFO, LogCode::GAME_LOADED, "Save file loaded");
                             RunPgn(where, file, true, saveData.currentLine, saveData.gameState);
                         }
                         else {
                             Log(LogGrade::ERR, LogCode::SAVE_CORRUPTED, "Save file load failed");
-                            MessageBoxA(NULL, "错误：无法加载存档", "错误", MB_ICONERROR | MB_OK);
+                            platform().showMessage("错误：无法加载存档", "错误", MessageLevel::ERR);
                             RunPgn(where, file);
                         }
                     }
@@ -410,17 +407,21 @@ void Run() {
                     }
                     else if (saveChoice == "3") {
                         Log(LogGrade::INFO, LogCode::GAME_SAVED, "Delete save file");
-                        fs::path savePath = fs::path(where) / "saves" / "autosave.sav";
-                        if (fs::remove(savePath)) {
+                        bool removed = false;
+                        for (const auto& savePath : listSaveFiles(full_path)) {
+                            std::error_code ec;
+                            removed = fs::remove(savePath, ec) || removed;
+                        }
+                        if (removed) {
                             Log(LogGrade::INFO, LogCode::GAME_SAVED, "Save file deleted");
                             cout << "存档已删除" << endl;
-                            Sleep(1000);
+                            platform().sleepMs(1000);
                         }
                         RunPgn(where, file);
                     }
                     else if (saveChoice == "4") {
                         Log(LogGrade::INFO, LogCode::GAME_START, "Return to main menu");
-                        return;
+                        continue;
                     }
                     else {
                         Log(LogGrade::WARNING, LogCode::JUMP_INVALID, "Invalid save choice, default to new game");
@@ -436,19 +437,19 @@ void Run() {
         }
         else if (op == "2") {
             Log(LogGrade::INFO, LogCode::GAME_START, "Tutorial selected");
-            string where = "Novel\\HelloWorld\\";
+            string where = "Novel" PVN_PATH_SEP "HelloWorld" PVN_PATH_SEP;
             string file = "HelloWorld.pgn";
 
             if (fs::exists(where + file)) {
-                Log(LogGrade::DEBUG, LogCode::GAME_LOADED, "Tutorial file found");
+                LOG_DEBUG(LogCode::GAME_LOADED, "Tutorial file found");
                 RunPgn(where, file);
             }
             else {
                 Log(LogGrade::ERR, LogCode::FILE_NOT_FOUND, "Tutorial file not found");
-                MessageBoxA(NULL, "错误：找不到教程文件", "错误", MB_ICONERROR | MB_OK);
+                platform().showMessage("错误：找不到教程文件", "错误", MessageLevel::ERR);
             }
 
-            system("cls");
+            platform().clearScreen();
             continue;
         }
         else if (op == "3") {
@@ -457,15 +458,15 @@ void Run() {
             std::vector<PluginInfo> plugins = readInstalledPlugins();
 
             if (plugins.empty()) {
-                system("cls");
+                platform().clearScreen();
                 std::cout << "========== 插件管理 ==========" << std::endl;
                 std::cout << "当前没有安装任何插件。" << std::endl;
                 std::cout << "==============================" << std::endl;
-                system("pause");
+                platform().waitForKey();
                 continue;
             }
             else {
-                system("cls");
+                platform().clearScreen();
                 std::cout << "========== 已安装插件 ==========" << std::endl;
                 std::cout << "插件数量: " << plugins.size() << std::endl;
                 std::cout << "================================" << std::endl;
@@ -493,13 +494,13 @@ void Run() {
                     std::cout << "   命令: " << plugin.runCommand << " " << plugin.runFile << std::endl;
                     std::cout << std::endl;
                 }
-                system("pause");
+                platform().waitForKey();
                 continue;
             }
         }
         else if (op == "4") {
             Log(LogGrade::INFO, LogCode::GAME_START, "About selected");
-            system("cls");
+            platform().clearScreen();
             printf("%s\n", "   ___                    ");
             printf("%s\n", "  / _ \\___ ____  ___ ____ ");
             printf("%s\n", " / ___/ _ `/ _ \\/ -_) __/ ");
@@ -530,7 +531,7 @@ void Run() {
         else if (op == "5") {
             Log(LogGrade::INFO, LogCode::GAME_START, "Exit selected");
             Log(LogGrade::INFO, LogCode::GAME_START, "Thank you for using PaperVisualNovel");
-            exit(0);
+            return;     // 回到 main，由 ExitCleanup 完成退出前的清理
         }
     }
 }
\ No newline at end of file
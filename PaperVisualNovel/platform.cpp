@@ -0,0 +1,21 @@
+﻿// platform.cpp
+#include "platform.h"
+
+namespace {
+    std::unique_ptr<Platform>& platformInstance() {
+        static std::unique_ptr<Platform> instance;
+        return instance;
+    }
+}
+
+Platform& platform() {
+    auto& instance = platformInstance();
+    if (!instance) {
+        instance = createDefaultPlatform();
+    }
+    return *instance;
+}
+
+void setPlatform(std::unique_ptr<Platform> impl) {
+    platformInstance() = std::move(impl);
+}
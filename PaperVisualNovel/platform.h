@@ -0,0 +1,316 @@
+﻿// platform.h
+#pragma once
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <ctime>
+
+/**
+ * @brief 路径分隔符（可直接与字符串字面量拼接，如 "Novel" PVN_PATH_SEP）
+ */
+#ifdef _WIN32
+#define PVN_PATH_SEP "\\"
+#define PVN_PATH_SEP_CHAR '\\'
+#else
+#define PVN_PATH_SEP "/"
+#define PVN_PATH_SEP_CHAR '/'
+#endif
+
+/**
+ * @brief 对话框类型
+ */
+enum class MessageLevel {
+    INFO,      // 提示
+    WARNING,   // 警告
+    ERR        // 错误
+};
+
+/**
+ * @brief 平台接口
+ *
+ * 解释器核心只通过该接口访问控制台输入、等待、对话框和外部程序，
+ * 不同系统提供各自的实现（platform_win.cpp / platform_posix.cpp）
+ */
+class Platform {
+public:
+    virtual ~Platform() = default;
+
+    // ==================== 输出 ====================
+
+    /**
+     * @brief 输出文本（不附加换行）
+     */
+    virtual void write(const std::string& text) = 0;
+
+    /**
+     * @brief 清屏
+     */
+    virtual void clearScreen() = 0;
+
+    /**
+     * @brief 设置控制台窗口标题
+     */
+    virtual void setTitle(const std::string& title) = 0;
+
+    // ==================== 输入 ====================
+
+    /**
+     * @brief 阻塞读取一个按键
+     * @return 按键名称（ENTER、ESC、F12、UP 或可见字符本身等）
+     */
+    virtual std::string readKey() = 0;
+
+    /**
+     * @brief 等待按键，最多等待 timeoutMs 毫秒
+     * @return 按键名称，超时返回空字符串
+     */
+    virtual std::string readKeyTimeout(int timeoutMs) {
+        sleepMs(timeoutMs);
+        return "";
+    }
+
+    /**
+     * @brief 开始 / 结束一段连续的按键轮询（如文字动画期间反复调用 readKeyTimeout），
+     *        需要切换终端模式的平台在这里只切换一次
+     */
+    virtual void beginKeyPolling() {}
+    virtual void endKeyPolling() {}
+
+    /**
+     * @brief 读取一行输入（不含换行符）
+     * @return 输入流结束时返回 false
+     */
+    virtual bool readLine(std::string& line) = 0;
+
+    /**
+     * @brief 提示并等待任意键
+     */
+    virtual void waitForKey() = 0;
+
+    /**
+     * @brief 由平台直接给出选择结果（批处理等非交互场景）
+     * @param optionCount 选项数量
+     * @return 选择的序号（1-based），返回 -1 表示使用交互菜单
+     */
+    virtual int chooseOption(size_t optionCount) {
+        (void)optionCount;
+        return -1;
+    }
+
+    // ==================== 时间 ====================
+
+    /**
+     * @brief 休眠指定毫秒数
+     */
+    virtual void sleepMs(int milliseconds) = 0;
+
+    // ==================== 对话框与外部程序 ====================
+
+    /**
+     * @brief 显示消息框
+     */
+    virtual void showMessage(const std::string& text, const std::string& title, MessageLevel level) = 0;
+
+    /**
+     * @brief 使用系统默认程序打开文件
+     * @param errorMessage 失败时的错误描述
+     */
+    virtual bool openFile(const std::string& path, std::string& errorMessage) = 0;
+
+    /**
+     * @brief 将读取自游戏文件的文本转换为控制台编码
+     *
+     * 游戏文件以GBK保存，Windows控制台直接使用；其他系统需转换为UTF-8。
+     * 按值传入，无需转换时直接移动返回，整份脚本解码不会多出一份拷贝
+     */
+    virtual std::string decodeText(std::string raw) = 0;
+};
+
+/**
+ * @brief 获取当前平台实现（首次调用时创建默认实现）
+ */
+Platform& platform();
+
+/**
+ * @brief 替换当前平台实现
+ */
+void setPlatform(std::unique_ptr<Platform> impl);
+
+/**
+ * @brief 创建当前系统的默认平台实现
+ */
+std::unique_ptr<Platform> createDefaultPlatform();
+
+// ==================== 持久化写入 ====================
+
+/**
+ * @brief 写入文件并等待数据落盘（fsync / FlushFileBuffers）
+ * @param append true 时追加到文件末尾，否则覆盖
+ */
+bool writeFileDurable(const std::string& path, const std::string& data, bool append);
+
+/**
+ * @brief 用 from 原子地替换 to（同一目录内），完成后 from 不再存在
+ */
+bool replaceFileAtomic(const std::string& from, const std::string& to);
+
+// ==================== 崩溃时写入 ====================
+
+/**
+ * @brief 以追加方式打开文件，返回原始文件描述符
+ * @return 打开失败时返回 -1
+ */
+int openRawAppend(const std::string& path);
+
+/**
+ * @brief 把数据直接写入原始文件描述符
+ *
+ * 不分配内存、不加锁，可以在信号处理函数中调用
+ */
+void writeRaw(int fd, const char* data, size_t size);
+
+/**
+ * @brief 关闭 openRawAppend 打开的文件描述符
+ */
+void closeRaw(int fd);
+
+// ==================== 子进程 ====================
+
+/**
+ * @brief 子进程管道读取结果
+ */
+enum class PipeStatus {
+    OK,        // 读到了要求的字节数
+    TIMEOUT,   // 超时，进程仍在运行
+    CLOSED     // 管道已关闭（进程已退出）
+};
+
+/**
+ * @brief 通过标准输入输出管道通信的子进程（标准错误沿用控制台）
+ *
+ * 析构时强制结束进程
+ */
+class ChildProcess {
+public:
+    virtual ~ChildProcess() = default;
+
+    /**
+     * @brief 向子进程的标准输入写入全部数据
+     * @return 管道已关闭时返回 false
+     */
+    virtual bool write(const std::string& data) = 0;
+
+    /**
+     * @brief 从子进程的标准输出读取恰好 size 字节
+     * @param timeoutMs 本次读取的总等待时间
+     * 未读满时（TIMEOUT / CLOSED）data 保留已读到的部分
+     */
+    virtual PipeStatus read(size_t size, std::string& data, int timeoutMs) = 0;
+
+    /**
+     * @brief 关闭子进程的标准输入（子进程读到 EOF）
+     */
+    virtual void closeInput() = 0;
+
+    /**
+     * @brief 关闭子进程的标准输入并等待其退出
+     * @param exitCode 子进程的退出码（可选，异常结束时为 -1）
+     * @return 超时仍未退出时返回 false
+     */
+    virtual bool closeAndWait(int timeoutMs, int* exitCode = nullptr) = 0;
+
+    /**
+     * @brief 强制结束子进程
+     */
+    virtual void kill() = 0;
+};
+
+/**
+ * @brief 启动子进程（不经过 shell）
+ * @param program 程序名或路径，不含路径时在 PATH 中查找
+ * @param args 传给程序的参数（不含程序名）
+ * @param errorMessage 失败时的错误描述
+ * @return 启动失败时返回空指针
+ */
+std::unique_ptr<ChildProcess> startChildProcess(const std::string& program,
+    const std::vector<std::string>& args, std::string& errorMessage);
+
+// ==================== 动态库 ====================
+
+/**
+ * @brief 已加载的动态库（dlopen / LoadLibrary），析构时卸载
+ */
+class DynamicLibrary {
+public:
+    virtual ~DynamicLibrary() = default;
+
+    /**
+     * @brief 查找导出符号
+     * @return 符号不存在时返回空指针
+     */
+    virtual void* symbol(const char* name) = 0;
+};
+
+/**
+ * @brief 按路径加载动态库
+ *
+ * 只加载给定路径的文件，不在系统搜索路径中查找；库的符号不加入全局命名空间，
+ * 不同插件导出的同名符号互不影响
+ * @param errorMessage 失败时的错误描述
+ * @return 加载失败时返回空指针
+ */
+std::unique_ptr<DynamicLibrary> loadDynamicLibrary(const std::string& path, std::string& errorMessage);
+
+/**
+ * @brief 当前系统动态库的扩展名（".dll" / ".dylib" / ".so"）
+ */
+inline const char* dynamicLibrarySuffix() {
+#if defined(_WIN32)
+    return ".dll";
+#elif defined(__APPLE__)
+    return ".dylib";
+#else
+    return ".so";
+#endif
+}
+
+/**
+ * @brief 控制台编码下 pos 处字符所占的字节数
+ *
+ * Windows 控制台为 GBK（双字节），其他系统为 UTF-8；
+ * 遇到不完整或非法的字节序列时按单字节处理
+ */
+inline size_t consoleCharLength(std::string_view text, size_t pos) {
+    unsigned char c = static_cast<unsigned char>(text[pos]);
+#ifdef _WIN32
+    size_t length = (c >= 0x81 && c <= 0xFE) ? 2 : 1;
+#else
+    size_t length = 1;
+    if ((c & 0xE0) == 0xC0) length = 2;
+    else if ((c & 0xF0) == 0xE0) length = 3;
+    else if ((c & 0xF8) == 0xF0) length = 4;
+    for (size_t k = 1; k < length; k++) {
+        if (pos + k >= text.size() || (static_cast<unsigned char>(text[pos + k]) & 0xC0) != 0x80) {
+            return 1;
+        }
+    }
+#endif
+    return pos + length <= text.size() ? length : 1;
+}
+
+/**
+ * @brief 线程安全的本地时间转换
+ */
+inline bool safeLocalTime(std::time_t time, std::tm& result) {
+#ifdef _WIN32
+    return localtime_s(&result, &time) == 0;
+#else
+    return localtime_r(&time, &result) != nullptr;
+#endif
+}
+
+#endif // PLATFORM_H
@@ -0,0 +1,645 @@
+﻿// platform_posix.cpp
+#ifndef _WIN32
+#include "platform.h"
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <optional>
+#include <chrono>
+#include <iconv.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <csignal>
+#include <dlfcn.h>
+
+namespace {
+    /**
+     * @brief 检查字符串是否为合法UTF-8
+     */
+    bool isValidUtf8(const std::string& text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            // 纯ASCII段每次检查8个字节
+            while (i + 8 <= text.size()) {
+                uint64_t word;
+                std::memcpy(&word, text.data() + i, sizeof(word));
+                if (word & 0x8080808080808080ULL) {
+                    break;
+                }
+                i += 8;
+            }
+            if (i >= text.size()) {
+                break;
+            }
+
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            size_t extra;
+            if (c < 0x80) extra = 0;
+            else if ((c & 0xE0) == 0xC0) extra = 1;
+            else if ((c & 0xF0) == 0xE0) extra = 2;
+            else if ((c & 0xF8) == 0xF0) extra = 3;
+            else return false;
+
+            if (i + extra >= text.size() && extra > 0) {
+                return false;
+            }
+            for (size_t k = 1; k <= extra; k++) {
+                unsigned char cc = static_cast<unsigned char>(text[i + k]);
+                if ((cc & 0xC0) != 0x80) return false;
+            }
+            i += extra + 1;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 终端原始模式（RAII），用于逐键读取
+     */
+    class RawTerminal {
+    public:
+        RawTerminal() {
+            active = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &original) == 0;
+            if (active) {
+                termios raw = original;
+                raw.c_lflag &= ~(ICANON | ECHO);
+                raw.c_cc[VMIN] = 1;
+                raw.c_cc[VTIME] = 0;
+                tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+            }
+        }
+
+        ~RawTerminal() {
+            if (active) {
+                tcsetattr(STDIN_FILENO, TCSANOW, &original);
+            }
+        }
+
+    private:
+        termios original{};
+        bool active = false;
+    };
+
+    /**
+     * @brief 读取一个字节，timeoutMs < 0 表示一直等待
+     * @return 读取到的字节，超时或输入结束返回 -1
+     */
+    int readByte(int timeoutMs) {
+        if (timeoutMs >= 0) {
+            pollfd fd{ STDIN_FILENO, POLLIN, 0 };
+            if (poll(&fd, 1, timeoutMs) <= 0) {
+                return -1;
+            }
+        }
+        unsigned char c;
+        ssize_t n = read(STDIN_FILENO, &c, 1);
+        return n == 1 ? c : -1;
+    }
+
+    /**
+     * @brief 解析 ESC 之后的终端转义序列
+     */
+    std::string readEscapeSequence() {
+        // 单独的 ESC 键后面不会紧跟其他字节
+        int next = readByte(30);
+        if (next < 0) {
+            return "ESC";
+        }
+
+        std::string seq;
+        if (next == '[' || next == 'O') {
+            int c;
+            while ((c = readByte(30)) >= 0) {
+                seq += static_cast<char>(c);
+                if ((c >= 'A' && c <= 'Z') || c == '~') {
+                    break;
+                }
+            }
+        }
+
+        if (next == 'O') {
+            if (seq == "P") return "F1";
+            if (seq == "Q") return "F2";
+            if (seq == "R") return "F3";
+            if (seq == "S") return "F4";
+        }
+        if (seq == "A") return "UP";
+        if (seq == "B") return "DOWN";
+        if (seq == "C") return "RIGHT";
+        if (seq == "D") return "LEFT";
+        if (seq == "H" || seq == "1~") return "HOME";
+        if (seq == "F" || seq == "4~") return "END";
+        if (seq == "2~") return "INSERT";
+        if (seq == "3~") return "DELETE";
+        if (seq == "5~") return "PAGE_UP";
+        if (seq == "6~") return "PAGE_DOWN";
+        if (seq == "15~") return "F5";
+        if (seq == "17~") return "F6";
+        if (seq == "18~") return "F7";
+        if (seq == "19~") return "F8";
+        if (seq == "20~") return "F9";
+        if (seq == "21~") return "F10";
+        if (seq == "23~") return "F11";
+        if (seq == "24~") return "F12";
+        return "UNKNOWN_ESC_" + seq;
+    }
+
+    /**
+     * @brief 读取 UTF-8 多字节字符的剩余字节，返回整个字符
+     */
+    std::string readUtf8Char(int lead) {
+        int extra = (lead & 0xE0) == 0xC0 ? 1 : (lead & 0xF0) == 0xE0 ? 2 : 3;
+        std::string ch(1, static_cast<char>(lead));
+        for (int i = 0; i < extra; i++) {
+            int c = readByte(30);
+            if (c < 0 || (c & 0xC0) != 0x80) {
+                break;
+            }
+            ch += static_cast<char>(c);
+        }
+        return ch;
+    }
+
+    /**
+     * @brief 将读取到的首字节转换为按键名称，多字节的按键（转义序列、UTF-8 字符）一次读完
+     */
+    std::string keyName(int key) {
+        switch (key) {
+        case 8: case 127: return "BACKSPACE";
+        case 9: return "TAB";
+        case 10: case 13: return "ENTER";
+        case 27: return readEscapeSequence();
+        case 32: return "SPACE";
+        default:
+            if (key >= 32 && key <= 126) {
+                return std::string(1, static_cast<char>(key));
+            }
+            if (key >= 0xC0 && key <= 0xF7) {
+                return readUtf8Char(key);
+            }
+            return "UNKNOWN_" + std::to_string(key);
+        }
+    }
+
+    class PosixPlatform : public Platform {
+    public:
+        PosixPlatform() {
+            gbkToUtf8 = iconv_open("UTF-8", "GBK");
+        }
+
+        ~PosixPlatform() override {
+            if (gbkToUtf8 != reinterpret_cast<iconv_t>(-1)) {
+                iconv_close(gbkToUtf8);
+            }
+        }
+
+        void write(const std::string& text) override {
+            std::cout << text << std::flush;
+        }
+
+        void clearScreen() override {
+            if (isatty(STDOUT_FILENO)) {
+                std::cout << "\033[2J\033[H" << std::flush;
+            }
+        }
+
+        void setTitle(const std::string& title) override {
+            if (isatty(STDOUT_FILENO)) {
+                std::cout << "\033]0;" << title << "\007" << std::flush;
+            }
+        }
+
+        std::string readKey() override {
+            std::cout.flush();
+            RawTerminal raw;
+            int key = readByte(-1);
+
+            if (key < 0) {
+                // 输入流已结束（如管道输入耗尽），无法继续交互
+                std::cerr << std::endl << "输入已结束，程序退出" << std::endl;
+                std::exit(0);
+            }
+            return keyName(key);
+        }
+
+        std::string readKeyTimeout(int timeoutMs) override {
+            std::cout.flush();
+            // 输入不是终端（管道、文件）时不轮询，避免吃掉后续提示要读的输入
+            if (!isatty(STDIN_FILENO)) {
+                sleepMs(timeoutMs);
+                return "";
+            }
+
+            std::optional<RawTerminal> raw;
+            if (!pollingRaw) {
+                raw.emplace();
+            }
+            pollfd fd{ STDIN_FILENO, POLLIN, 0 };
+            if (poll(&fd, 1, std::max(timeoutMs, 0)) <= 0) {
+                return "";
+            }
+            unsigned char c;
+            if (read(STDIN_FILENO, &c, 1) != 1) {
+                // 输入已结束，按超时处理，留给 readKey 报告
+                sleepMs(timeoutMs);
+                return "";
+            }
+            return keyName(c);
+        }
+
+        void beginKeyPolling() override {
+            if (pollingDepth++ == 0) {
+                pollingRaw.emplace();
+            }
+        }
+
+        void endKeyPolling() override {
+            if (pollingDepth > 0 && --pollingDepth == 0) {
+                pollingRaw.reset();
+            }
+        }
+
+        bool readLine(std::string& line) override {
+            std::cout.flush();
+            if (!std::getline(std::cin, line)) {
+                return false;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+
+        void waitForKey() override {
+            std::cout << "请按任意键继续. . ." << std::flush;
+            readKey();
+            std::cout << std::endl;
+        }
+
+        void sleepMs(int milliseconds) override {
+            if (milliseconds > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+            }
+        }
+
+        void showMessage(const std::string& text, const std::string& title, MessageLevel level) override {
+            // 无图形界面时输出到标准错误
+            const char* colorCode = "\033[36m";
+            if (level == MessageLevel::WARNING) colorCode = "\033[33m";
+            else if (level == MessageLevel::ERR) colorCode = "\033[31m";
+            std::cerr << colorCode << "[" << title << "] " << text << "\033[37m" << std::endl;
+        }
+
+        bool openFile(const std::string& path, std::string& errorMessage) override {
+#ifdef __APPLE__
+            const char* opener = "open";
+#else
+            const char* opener = "xdg-open";
+#endif
+            pid_t pid = fork();
+            if (pid < 0) {
+                errorMessage = std::string("无法创建进程: ") + std::strerror(errno);
+                return false;
+            }
+            if (pid == 0) {
+                execlp(opener, opener, path.c_str(), static_cast<char*>(nullptr));
+                _exit(127);
+            }
+
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                errorMessage = "无法打开文件。错误代码: " + std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+                return false;
+            }
+            return true;
+        }
+
+        std::string decodeText(std::string raw) override {
+            // 已是UTF-8（纯ASCII或新写入的文件）时直接返回
+            if (isValidUtf8(raw) || gbkToUtf8 == reinterpret_cast<iconv_t>(-1)) {
+                return raw;
+            }
+
+            std::string out(raw.size() * 2 + 4, '\0');
+            char* in = raw.data();
+            size_t inLeft = raw.size();
+            char* dst = &out[0];
+            size_t outLeft = out.size();
+
+            // iconv 句柄带转换状态，游戏列表并发扫描时需要串行使用
+            std::lock_guard<std::mutex> lock(iconvMutex);
+            iconv(gbkToUtf8, nullptr, nullptr, nullptr, nullptr);
+            while (inLeft > 0) {
+                if (iconv(gbkToUtf8, &in, &inLeft, &dst, &outLeft) == static_cast<size_t>(-1)) {
+                    if (errno == E2BIG) {
+                        size_t used = out.size() - outLeft;
+                        out.resize(out.size() * 2);
+                        dst = &out[used];
+                        outLeft = out.size() - used;
+                        continue;
+                    }
+                    // 无法识别的字节原样保留
+                    if (outLeft == 0) {
+                        size_t used = out.size();
+                        out.resize(out.size() * 2);
+                        dst = &out[used];
+                        outLeft = out.size() - used;
+                    }
+                    *dst++ = *in++;
+                    inLeft--;
+                    outLeft--;
+                }
+            }
+            out.resize(out.size() - outLeft);
+            return out;
+        }
+
+    private:
+        iconv_t gbkToUtf8;
+        std::mutex iconvMutex;
+        std::optional<RawTerminal> pollingRaw;  // 按键轮询期间保持的原始模式
+        int pollingDepth = 0;
+    };
+}
+
+std::unique_ptr<Platform> createDefaultPlatform() {
+    return std::make_unique<PosixPlatform>();
+}
+
+// ==================== 子进程 ====================
+
+namespace {
+    class PosixChildProcess : public ChildProcess {
+    public:
+        PosixChildProcess(pid_t pid, int inputFd, int outputFd)
+            : pid(pid), inputFd(inputFd), outputFd(outputFd) {
+        }
+
+        ~PosixChildProcess() override {
+            kill();
+        }
+
+        bool write(const std::string& data) override {
+            const char* cursor = data.data();
+            size_t left = data.size();
+            while (left > 0) {
+                if (inputFd < 0) {
+                    return false;
+                }
+                ssize_t written = ::write(inputFd, cursor, left);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                cursor += written;
+                left -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        PipeStatus read(size_t size, std::string& data, int timeoutMs) override {
+            data.clear();
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            char buffer[4096];
+            while (data.size() < size) {
+                if (outputFd < 0) {
+                    return PipeStatus::CLOSED;
+                }
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                if (remaining <= 0) {
+                    return PipeStatus::TIMEOUT;
+                }
+
+                pollfd fd{ outputFd, POLLIN, 0 };
+                int ready = poll(&fd, 1, static_cast<int>(remaining));
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready == 0) {
+                    return PipeStatus::TIMEOUT;
+                }
+
+                ssize_t n = ::read(outputFd, buffer, std::min(sizeof(buffer), size - data.size()));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    return PipeStatus::CLOSED;
+                }
+                data.append(buffer, static_cast<size_t>(n));
+            }
+            return PipeStatus::OK;
+        }
+
+        void closeInput() override {
+            closeFd(inputFd);
+        }
+
+        bool closeAndWait(int timeoutMs, int* exitCode) override {
+            closeFd(inputFd);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            while (pid > 0) {
+                int status = 0;
+                if (waitpid(pid, &status, WNOHANG) != 0) {
+                    if (exitCode) {
+                        *exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                    }
+                    pid = -1;
+                    break;
+                }
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            closeFd(outputFd);
+            return true;
+        }
+
+        void kill() override {
+            closeFd(inputFd);
+            closeFd(outputFd);
+            if (pid > 0) {
+                ::kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                pid = -1;
+            }
+        }
+
+    private:
+        static void closeFd(int& fd) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        pid_t pid;
+        int inputFd;
+        int outputFd;
+    };
+}
+
+std::unique_ptr<ChildProcess> startChildProcess(const std::string& program,
+    const std::vector<std::string>& args, std::string& errorMessage) {
+    // 子进程退出后继续写入管道时忽略 SIGPIPE，由 write 返回错误
+    static const bool sigpipeIgnored = [] {
+        signal(SIGPIPE, SIG_IGN);
+        return true;
+    }();
+    (void)sigpipeIgnored;
+
+    int toChild[2];
+    int fromChild[2];
+    if (pipe(toChild) != 0) {
+        errorMessage = std::string("pipe failed: ") + std::strerror(errno);
+        return nullptr;
+    }
+    if (pipe(fromChild) != 0) {
+        errorMessage = std::string("pipe failed: ") + std::strerror(errno);
+        close(toChild[0]);
+        close(toChild[1]);
+        return nullptr;
+    }
+    // 父进程持有的一端不能被之后启动的其他子进程继承
+    fcntl(toChild[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fromChild[0], F_SETFD, FD_CLOEXEC);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        errorMessage = std::string("fork failed: ") + std::strerror(errno);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        return nullptr;
+    }
+
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        signal(SIGPIPE, SIG_DFL);
+        execvp(program.c_str(), argv.data());
+        _exit(127);
+    }
+
+    close(toChild[0]);
+    close(fromChild[1]);
+    return std::make_unique<PosixChildProcess>(pid, toChild[1], fromChild[0]);
+}
+
+// ==================== 动态库 ====================
+
+namespace {
+    class PosixDynamicLibrary : public DynamicLibrary {
+    public:
+        explicit PosixDynamicLibrary(void* handle) : handle(handle) {
+        }
+
+        ~PosixDynamicLibrary() override {
+            dlclose(handle);
+        }
+
+        void* symbol(const char* name) override {
+            return dlsym(handle, name);
+        }
+
+    private:
+        void* handle;
+    };
+}
+
+std::unique_ptr<DynamicLibrary> loadDynamicLibrary(const std::string& path, std::string& errorMessage) {
+    // 路径不含 '/' 时 dlopen 会搜索 LD_LIBRARY_PATH 等目录，这里始终传入带目录的路径
+    std::string fullPath = path.find('/') == std::string::npos ? "./" + path : path;
+
+    // RTLD_NOW：缺少依赖符号时在加载时失败，而不是在调用时终止进程
+    void* handle = dlopen(fullPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* error = dlerror();
+        errorMessage = error ? error : "dlopen failed";
+        return nullptr;
+    }
+    return std::make_unique<PosixDynamicLibrary>(handle);
+}
+
+bool writeFileDurable(const std::string& path, const std::string& data, bool append) {
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* cursor = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd, cursor, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return false;
+        }
+        cursor += written;
+        left -= static_cast<size_t>(written);
+    }
+
+    bool ok = fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+}
+
+bool replaceFileAtomic(const std::string& from, const std::string& to) {
+    if (rename(from.c_str(), to.c_str()) != 0) {
+        return false;
+    }
+
+    // 同步目录项，保证改名本身在断电后也生效
+    size_t slash = to.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : to.substr(0, slash);
+    int dirFd = open(dir.empty() ? "/" : dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+// ==================== 崩溃时写入 ====================
+
+int openRawAppend(const std::string& path) {
+    return open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+void writeRaw(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void closeRaw(int fd) {
+    close(fd);
+}
+
+#endif // !_WIN32
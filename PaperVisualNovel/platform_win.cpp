@@ -0,0 +1,407 @@
+﻿// platform_win.cpp
+#ifdef _WIN32
+#include "platform.h"
+#include <Windows.h>
+#include <shellapi.h>
+#include <conio.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+namespace {
+    class WindowsPlatform : public Platform {
+    public:
+        void write(const std::string& text) override {
+            std::cout << text << std::flush;
+        }
+
+        void clearScreen() override {
+            system("cls");
+        }
+
+        void setTitle(const std::string& title) override {
+            // 使用系统代码页转换，保证中文标题正确显示
+            int len = MultiByteToWideChar(CP_ACP, 0, title.c_str(), -1, NULL, 0);
+            std::wstring wtitle(len > 0 ? len : 1, L'\0');
+            MultiByteToWideChar(CP_ACP, 0, title.c_str(), -1, &wtitle[0], len);
+            SetConsoleTitleW(wtitle.c_str());
+        }
+
+        std::string readKey() override {
+            int key = _getch();
+
+            if (key == 0 || key == 224) {
+                int extKey = _getch();
+
+                switch (extKey) {
+                case 59: return "F1";
+                case 60: return "F2";
+                case 61: return "F3";
+                case 62: return "F4";
+                case 63: return "F5";
+                case 64: return "F6";
+                case 65: return "F7";
+                case 66: return "F8";
+                case 67: return "F9";
+                case 68: return "F10";
+                case 133: return "F11";
+                case 134: return "F12";
+                case 72: return "UP";
+                case 80: return "DOWN";
+                case 75: return "LEFT";
+                case 77: return "RIGHT";
+                case 71: return "HOME";
+                case 79: return "END";
+                case 73: return "PAGE_UP";
+                case 81: return "PAGE_DOWN";
+                case 82: return "INSERT";
+                case 83: return "DELETE";
+                case 141: return "NUMPAD_/";
+                default: return "UNKNOWN_EXT_" + std::to_string(extKey);
+                }
+            }
+
+            switch (key) {
+            case 8: return "BACKSPACE";
+            case 9: return "TAB";
+            case 13: return "ENTER";
+            case 27: return "ESC";
+            case 32: return "SPACE";
+            case 33: return "PAGE_UP_ALT";
+            case 34: return "PAGE_DOWN_ALT";
+            case 35: return "END_ALT";
+            case 36: return "HOME_ALT";
+            case 37: return "LEFT_ALT";
+            case 38: return "UP_ALT";
+            case 39: return "RIGHT_ALT";
+            case 40: return "DOWN_ALT";
+            case 45: return "INSERT_ALT";
+            case 46: return "DELETE_ALT";
+            default:
+                if (key >= 32 && key <= 126) {
+                    return std::string(1, static_cast<char>(key));
+                }
+                return "UNKNOWN_" + std::to_string(key);
+            }
+        }
+
+        std::string readKeyTimeout(int timeoutMs) override {
+            std::cout.flush();
+            ULONGLONG deadline = GetTickCount64() + (timeoutMs > 0 ? timeoutMs : 0);
+            while (!_kbhit()) {
+                if (GetTickCount64() >= deadline) {
+                    return "";
+                }
+                Sleep(1);
+            }
+            return readKey();
+        }
+
+        bool readLine(std::string& line) override {
+            return static_cast<bool>(std::getline(std::cin, line));
+        }
+
+        void waitForKey() override {
+            system("pause");
+        }
+
+        void sleepMs(int milliseconds) override {
+            Sleep(milliseconds);
+        }
+
+        void showMessage(const std::string& text, const std::string& title, MessageLevel level) override {
+            UINT icon = MB_ICONINFORMATION;
+            if (level == MessageLevel::WARNING) icon = MB_ICONWARNING;
+            else if (level == MessageLevel::ERR) icon = MB_ICONERROR;
+            MessageBoxA(NULL, text.c_str(), title.c_str(), icon | MB_OK);
+        }
+
+        bool openFile(const std::string& path, std::string& errorMessage) override {
+            HINSTANCE result = ShellExecuteA(
+                NULL,
+                "open",
+                path.c_str(),
+                NULL,
+                NULL,
+                SW_SHOWNORMAL
+            );
+
+            // ShellExecute 返回值小于等于32表示失败
+            if ((INT_PTR)result <= 32) {
+                DWORD error = GetLastError();
+                errorMessage = "无法打开文件。错误代码: " + std::to_string(error);
+                return false;
+            }
+            return true;
+        }
+
+        std::string decodeText(std::string raw) override {
+            return raw;
+        }
+    };
+}
+
+std::unique_ptr<Platform> createDefaultPlatform() {
+    return std::make_unique<WindowsPlatform>();
+}
+
+// ==================== 子进程 ====================
+
+namespace {
+    class WindowsChildProcess : public ChildProcess {
+    public:
+        WindowsChildProcess(HANDLE process, HANDLE input, HANDLE output)
+            : process(process), input(input), output(output) {
+        }
+
+        ~WindowsChildProcess() override {
+            kill();
+        }
+
+        bool write(const std::string& data) override {
+            const char* cursor = data.data();
+            size_t left = data.size();
+            while (left > 0) {
+                DWORD written = 0;
+                if (input == NULL || !WriteFile(input, cursor, static_cast<DWORD>(left), &written, NULL)) {
+                    return false;
+                }
+                cursor += written;
+                left -= written;
+            }
+            return true;
+        }
+
+        PipeStatus read(size_t size, std::string& data, int timeoutMs) override {
+            data.clear();
+            ULONGLONG deadline = GetTickCount64() + (timeoutMs > 0 ? timeoutMs : 0);
+            char buffer[4096];
+            while (data.size() < size) {
+                DWORD available = 0;
+                if (output == NULL || !PeekNamedPipe(output, NULL, 0, NULL, &available, NULL)) {
+                    return PipeStatus::CLOSED;
+                }
+                if (available == 0) {
+                    if (GetTickCount64() >= deadline) {
+                        return PipeStatus::TIMEOUT;
+                    }
+                    Sleep(1);
+                    continue;
+                }
+
+                DWORD want = static_cast<DWORD>(std::min<size_t>({ sizeof(buffer), size - data.size(), available }));
+                DWORD got = 0;
+                if (!ReadFile(output, buffer, want, &got, NULL) || got == 0) {
+                    return PipeStatus::CLOSED;
+                }
+                data.append(buffer, got);
+            }
+            return PipeStatus::OK;
+        }
+
+        void closeInput() override {
+            closeHandle(input);
+        }
+
+        bool closeAndWait(int timeoutMs, int* exitCode) override {
+            closeHandle(input);
+            if (process != NULL && WaitForSingleObject(process, timeoutMs) != WAIT_OBJECT_0) {
+                return false;
+            }
+            if (process != NULL && exitCode) {
+                DWORD code = 0;
+                *exitCode = GetExitCodeProcess(process, &code) ? static_cast<int>(code) : -1;
+            }
+            closeHandle(output);
+            closeHandle(process);
+            return true;
+        }
+
+        void kill() override {
+            closeHandle(input);
+            closeHandle(output);
+            if (process != NULL) {
+                TerminateProcess(process, 1);
+                WaitForSingleObject(process, INFINITE);
+                closeHandle(process);
+            }
+        }
+
+    private:
+        static void closeHandle(HANDLE& handle) {
+            if (handle != NULL) {
+                CloseHandle(handle);
+                handle = NULL;
+            }
+        }
+
+        HANDLE process;
+        HANDLE input;
+        HANDLE output;
+    };
+
+    // 按 CommandLineToArgvW 的规则给参数加引号
+    std::string quoteArgument(const std::string& arg) {
+        if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+            return arg;
+        }
+        std::string quoted = "\"";
+        size_t backslashes = 0;
+        for (char c : arg) {
+            if (c == '\\') {
+                backslashes++;
+                continue;
+            }
+            if (c == '"') {
+                quoted.append(backslashes * 2 + 1, '\\');
+            }
+            else {
+                quoted.append(backslashes, '\\');
+            }
+            backslashes = 0;
+            quoted += c;
+        }
+        quoted.append(backslashes * 2, '\\');
+        quoted += '"';
+        return quoted;
+    }
+}
+
+std::unique_ptr<ChildProcess> startChildProcess(const std::string& program,
+    const std::vector<std::string>& args, std::string& errorMessage) {
+    SECURITY_ATTRIBUTES security{};
+    security.nLength = sizeof(security);
+    security.bInheritHandle = TRUE;
+
+    HANDLE childInput = NULL, parentInput = NULL;
+    HANDLE parentOutput = NULL, childOutput = NULL;
+    if (!CreatePipe(&childInput, &parentInput, &security, 0) ||
+        !CreatePipe(&parentOutput, &childOutput, &security, 0)) {
+        errorMessage = "CreatePipe failed: " + std::to_string(GetLastError());
+        for (HANDLE handle : { childInput, parentInput, parentOutput, childOutput }) {
+            if (handle != NULL) CloseHandle(handle);
+        }
+        return nullptr;
+    }
+    // 父进程持有的一端不被子进程继承
+    SetHandleInformation(parentInput, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(parentOutput, HANDLE_FLAG_INHERIT, 0);
+
+    std::string commandLine = quoteArgument(program);
+    for (const auto& arg : args) {
+        commandLine += " " + quoteArgument(arg);
+    }
+
+    STARTUPINFOA startup{};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childInput;
+    startup.hStdOutput = childOutput;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    PROCESS_INFORMATION info{};
+    BOOL created = CreateProcessA(NULL, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &startup, &info);
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!created) {
+        errorMessage = "CreateProcess failed: " + std::to_string(GetLastError());
+        CloseHandle(parentInput);
+        CloseHandle(parentOutput);
+        return nullptr;
+    }
+
+    CloseHandle(info.hThread);
+    return std::make_unique<WindowsChildProcess>(info.hProcess, parentInput, parentOutput);
+}
+
+bool writeFileDurable(const std::string& path, const std::string& data, bool append) {
+    HANDLE file = CreateFileA(path.c_str(), append ? FILE_APPEND_DATA : GENERIC_WRITE, 0, NULL,
+        append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    const char* cursor = data.data();
+    size_t left = data.size();
+    bool ok = true;
+    while (ok && left > 0) {
+        DWORD chunk = static_cast<DWORD>(left > 0x40000000 ? 0x40000000 : left);
+        DWORD written = 0;
+        ok = WriteFile(file, cursor, chunk, &written, NULL) != 0;
+        cursor += written;
+        left -= written;
+    }
+
+    ok = ok && FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+}
+
+// ==================== 崩溃时写入 ====================
+
+int openRawAppend(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY | _O_NOINHERIT, _S_IREAD | _S_IWRITE);
+}
+
+void writeRaw(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        unsigned int chunk = static_cast<unsigned int>(size > 0x40000000 ? 0x40000000 : size);
+        int written = _write(fd, data, chunk);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void closeRaw(int fd) {
+    _close(fd);
+}
+
+// ==================== 动态库 ====================
+
+namespace {
+    class WindowsDynamicLibrary : public DynamicLibrary {
+    public:
+        explicit WindowsDynamicLibrary(HMODULE module) : module(module) {
+        }
+
+        ~WindowsDynamicLibrary() override {
+            FreeLibrary(module);
+        }
+
+        void* symbol(const char* name) override {
+            return reinterpret_cast<void*>(GetProcAddress(module, name));
+        }
+
+    private:
+        HMODULE module;
+    };
+}
+
+std::unique_ptr<DynamicLibrary> loadDynamicLibrary(const std::string& path, std::string& errorMessage) {
+    char fullPath[MAX_PATH];
+    DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, fullPath, nullptr);
+    if (length == 0 || length >= MAX_PATH) {
+        errorMessage = "invalid library path: " + path;
+        return nullptr;
+    }
+
+    // 使用绝对路径加载，库自身依赖的 DLL 从库所在目录查找，而不是当前工作目录
+    HMODULE module = LoadLibraryExA(fullPath, nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+    if (!module) {
+        errorMessage = "LoadLibrary failed with error " + std::to_string(GetLastError());
+        return nullptr;
+    }
+    return std::make_unique<WindowsDynamicLibrary>(module);
+}
+
+bool replaceFileAtomic(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#endif // _WIN32
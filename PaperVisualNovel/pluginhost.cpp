@@ -0,0 +1,643 @@
+﻿// pluginhost.cpp
+#include "pluginhost.h"
+#include "nativeplugin.h"
+#include "ui.h"
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <system_error>
+
+namespace {
+    // 单条消息（及 console 模式捕获的输出）的长度上限，防止异常输出导致分配过大的缓冲区
+    constexpr uint32_t kMaxFrameSize = 16 * 1024 * 1024;
+
+    // 关闭时等待工作进程自行退出的时间
+    constexpr int kShutdownWaitMs = 500;
+
+    std::string encodeFrame(const std::string& payload) {
+        uint32_t size = static_cast<uint32_t>(payload.size());
+        std::string frame;
+        frame.reserve(4 + payload.size());
+        for (int i = 0; i < 4; i++) {
+            frame += static_cast<char>((size >> (8 * i)) & 0xFF);
+        }
+        frame += payload;
+        return frame;
+    }
+
+    uint32_t decodeFrameSize(const std::string& header) {
+        uint32_t size = 0;
+        for (int i = 3; i >= 0; i--) {
+            size = (size << 8) | static_cast<unsigned char>(header[i]);
+        }
+        return size;
+    }
+
+    int remainingMs(std::chrono::steady_clock::time_point deadline) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        return left > 0 ? static_cast<int>(left) : 0;
+    }
+
+    /**
+     * @brief 解析插件的启动命令，规则与 system() 运行时相同：
+     * RunCommand 为 .exe / bin / / 时直接执行 RunFile，
+     * 插件目录下存在 <RunCommand>.exe 时优先使用它
+     */
+    void resolvePluginCommand(const PluginInfo& plugin, std::string& program,
+        std::vector<std::string>& args) {
+        std::string pluginDir = "Plugins" PVN_PATH_SEP + plugin.name;
+        std::string runFile = fs::path(plugin.runFile).is_relative()
+            ? pluginDir + PVN_PATH_SEP + plugin.runFile
+            : plugin.runFile;
+
+        args.clear();
+        if (plugin.runCommand.empty() || plugin.runCommand == ".exe" ||
+            plugin.runCommand == "bin" || plugin.runCommand == "/") {
+            program = runFile;
+            return;
+        }
+
+        program = plugin.runCommand;
+        if (plugin.runCommand.find_first_of(" \\/") == std::string::npos) {
+            std::string possibleExe = pluginDir + PVN_PATH_SEP + plugin.runCommand + ".exe";
+            if (fs::exists(possibleExe)) {
+                program = possibleExe;
+            }
+        }
+        args.push_back(runFile);
+    }
+
+    /**
+     * @brief 按 shell 的习惯拆分参数：空白分隔，单双引号内的空白不分隔，
+     * 反斜杠只转义引号和反斜杠本身（保留 Windows 路径中的反斜杠）
+     */
+    std::vector<std::string> splitArguments(const std::string& text) {
+        std::vector<std::string> args;
+        std::string current;
+        bool inArg = false;
+        char quote = 0;
+
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size() &&
+                (text[i + 1] == '"' || text[i + 1] == '\\' || text[i + 1] == '\'')) {
+                current += text[++i];
+                inArg = true;
+            }
+            else if (quote != 0) {
+                if (c == quote) {
+                    quote = 0;
+                }
+                else {
+                    current += c;
+                }
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+                inArg = true;
+            }
+            else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                if (inArg) {
+                    args.push_back(current);
+                    current.clear();
+                    inArg = false;
+                }
+            }
+            else {
+                current += c;
+                inArg = true;
+            }
+        }
+        if (inArg) {
+            args.push_back(current);
+        }
+        return args;
+    }
+}
+
+// ==================== 返回变量 ====================
+
+namespace {
+    // 变量名：字母、数字、下划线或非 ASCII 字符，不以数字开头
+    bool isVariableName(const std::string& name) {
+        if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+            return false;
+        }
+        for (char c : name) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (byte < 0x80 && !std::isalnum(byte) && c != '_') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 完整的十进制整数（可带符号，不超出 int 范围）
+    bool parseIntValue(const std::string& text, int& value) {
+        const char* begin = text.data();
+        const char* end = text.data() + text.size();
+        if (begin != end && *begin == '+') {
+            begin++;
+        }
+        auto result = std::from_chars(begin, end, value);
+        return begin != end && result.ec == std::errc() && result.ptr == end;
+    }
+
+    bool variableFromJson(const std::string& name, const JsonValue& value, PluginVariable& variable) {
+        variable.name = name;
+        switch (value.type()) {
+        case JsonValue::Type::BOOL:
+            variable.intValue = value.asBool() ? 1 : 0;
+            return true;
+        case JsonValue::Type::NUMBER: {
+            double number = value.asNumber();
+            if (number == std::floor(number) &&
+                number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max()) {
+                variable.intValue = static_cast<int>(number);
+            }
+            else {
+                variable.isString = true;
+                variable.stringValue = value.dump();
+            }
+            return true;
+        }
+        case JsonValue::Type::STRING:
+            variable.isString = true;
+            variable.stringValue = value.asString();
+            return true;
+        case JsonValue::Type::ARRAY:
+        case JsonValue::Type::OBJECT:
+            variable.isString = true;
+            variable.stringValue = value.dump();
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void collectJsonVariables(const JsonValue& object, std::vector<PluginVariable>& vars) {
+        for (const auto& [name, value] : object.members()) {
+            PluginVariable variable;
+            if (!isVariableName(name) || !variableFromJson(name, value, variable)) {
+                Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+                    "Ignoring plugin variable '" + name + "'");
+                continue;
+            }
+            vars.push_back(std::move(variable));
+        }
+    }
+}
+
+void extractPluginVariables(std::string& output, std::vector<PluginVariable>& vars) {
+    std::string trimmed = trim(output);
+    if (!trimmed.empty() && trimmed.front() == '{') {
+        JsonValue object;
+        if (JsonValue::parse(trimmed, object) && object.isObject()) {
+            collectJsonVariables(object, vars);
+            output.clear();
+            return;
+        }
+    }
+
+    std::string remaining;
+    size_t pos = 0;
+    while (pos < output.size()) {
+        size_t end = output.find('\n', pos);
+        if (end == std::string::npos) {
+            end = output.size();
+        }
+        std::string line = output.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t equalsPos = line.find('=');
+        if (equalsPos != std::string::npos) {
+            std::string name = trim(line.substr(0, equalsPos));
+            std::string value = trim(line.substr(equalsPos + 1));
+            if (isVariableName(name)) {
+                PluginVariable variable;
+                variable.name = name;
+                // 带引号的值总是字符串
+                if (value.length() >= 2 &&
+                    ((value.front() == '"' && value.back() == '"') ||
+                        (value.front() == '\'' && value.back() == '\''))) {
+                    variable.isString = true;
+                    variable.stringValue = value.substr(1, value.length() - 2);
+                }
+                else if (!parseIntValue(value, variable.intValue)) {
+                    variable.isString = true;
+                    variable.stringValue = value;
+                }
+                vars.push_back(std::move(variable));
+                continue;
+            }
+        }
+        remaining += line;
+        if (end < output.size()) {
+            remaining += '\n';
+        }
+    }
+    output = std::move(remaining);
+}
+
+void applyPluginVariables(const std::vector<PluginVariable>& vars, GameState& gameState) {
+    if (vars.empty()) {
+        return;
+    }
+    std::string names;
+    for (const auto& variable : vars) {
+        if (variable.isString) {
+            gameState.setStringVar(variable.name, variable.stringValue);
+        }
+        else {
+            gameState.setVar(variable.name, variable.intValue);
+        }
+        names += (names.empty() ? "" : ", ") + variable.name;
+    }
+    LOG_INFO(LogCode::PLUGIN_LOADED,
+        "Applied ", vars.size(), " plugin variables: ", names);
+}
+
+bool finishPluginCall(const PluginResult& result, GameState* gameState) {
+    if (!result.output.empty()) {
+        std::cout << result.output;
+        if (result.output.back() != '\n') {
+            std::cout << '\n';
+        }
+        std::cout.flush();
+    }
+
+    if (!result.success) {
+        reportPluginError(result.pluginName, result.error);
+        return false;
+    }
+
+    if (gameState) {
+        applyPluginVariables(result.vars, *gameState);
+    }
+    return true;
+}
+
+// ==================== 插件进程 ====================
+
+PluginHost& PluginHost::instance() {
+    static PluginHost host;
+    return host;
+}
+
+PluginHost::~PluginHost() {
+    // 静态析构阶段不写日志
+    shutdown();
+}
+
+PluginHost::Worker& PluginHost::workerFor(const std::string& pluginName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& worker = workers[pluginName];
+    if (!worker) {
+        worker = std::make_unique<Worker>();
+    }
+    return *worker;
+}
+
+bool PluginHost::startWorker(const PluginInfo& plugin, Worker& worker, std::string& errorMessage) {
+    std::string program;
+    std::vector<std::string> args;
+    resolvePluginCommand(plugin, program, args);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    worker.process = startChildProcess(program, args, errorMessage);
+    if (!worker.process) {
+        Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED,
+            "Cannot start plugin worker " + plugin.name + ": " + errorMessage);
+        return false;
+    }
+
+    auto startCost = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+        "Plugin worker started: " + plugin.name + " (" + program +
+        ", took " + std::to_string(startCost) + "ms)");
+    return true;
+}
+
+bool PluginHost::exchange(const PluginInfo& plugin, Worker& worker, const std::string& args,
+    JsonValue& response, std::string& errorMessage, bool& crashed) {
+    crashed = false;
+    uint64_t id = worker.nextId++;
+
+    JsonValue request = JsonValue::object();
+    request.set("id", static_cast<double>(id));
+    request.set("args", args);
+    if (!worker.process->write(encodeFrame(request.dump()))) {
+        crashed = true;
+        errorMessage = "worker input pipe closed";
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(plugin.timeoutMs);
+    std::string header;
+    PipeStatus status = worker.process->read(4, header, remainingMs(deadline));
+    std::string payload;
+    if (status == PipeStatus::OK) {
+        uint32_t size = decodeFrameSize(header);
+        if (size > kMaxFrameSize) {
+            errorMessage = "response frame too large (" + std::to_string(size) + " bytes)";
+            worker.process->kill();
+            worker.process.reset();
+            return false;
+        }
+        status = worker.process->read(size, payload, remainingMs(deadline));
+    }
+
+    if (status == PipeStatus::CLOSED) {
+        crashed = true;
+        errorMessage = "worker exited";
+        return false;
+    }
+    if (status == PipeStatus::TIMEOUT) {
+        // 响应可能稍后才到，结束进程避免与下一个请求错位
+        errorMessage = "timed out after " + std::to_string(plugin.timeoutMs) + "ms";
+        worker.process->kill();
+        worker.process.reset();
+        return false;
+    }
+
+    std::string parseError;
+    if (!JsonValue::parse(payload, response, &parseError) || !response.isObject()) {
+        errorMessage = "invalid response: " + (parseError.empty() ? "not an object" : parseError);
+        worker.process->kill();
+        worker.process.reset();
+        return false;
+    }
+
+    const JsonValue* responseId = response.find("id");
+    if (responseId && responseId->asNumber(-1) != static_cast<double>(id)) {
+        errorMessage = "response id mismatch";
+        worker.process->kill();
+        worker.process.reset();
+        return false;
+    }
+    return true;
+}
+
+bool PluginHost::call(const PluginInfo& plugin, const std::string& args,
+    JsonValue& response, std::string& errorMessage) {
+    Worker& worker = workerFor(plugin.name);
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    // 首次调用启动进程；进程崩溃时重启并重发一次
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!worker.process) {
+            if (attempt > 0 || worker.starts > 0) {
+                Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                    "Restarting plugin worker: " + plugin.name);
+            }
+            if (!startWorker(plugin, worker, errorMessage)) {
+                return false;
+            }
+            worker.starts++;
+        }
+
+        bool crashed = false;
+        if (exchange(plugin, worker, args, response, errorMessage, crashed)) {
+            return true;
+        }
+
+        Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED,
+            "Plugin worker " + plugin.name + " call failed: " + errorMessage);
+        if (!crashed) {
+            return false;
+        }
+        worker.process->kill();
+        worker.process.reset();
+    }
+    return false;
+}
+
+PluginResult PluginHost::run(const PluginInfo& plugin, const std::string& args, const GameState* gameState) {
+    if (plugin.mode == PluginMode::NATIVE) {
+        return NativePlugins::instance().run(plugin, args, gameState);
+    }
+    if (plugin.mode != PluginMode::WORKER) {
+        return runConsoleCaptured(plugin, args);
+    }
+
+    PluginResult result;
+    result.pluginName = plugin.name;
+    JsonValue response;
+    if (!call(plugin, args, response, result.error)) {
+        return result;
+    }
+
+    const JsonValue* output = response.find("output");
+    if (output) {
+        result.output = output->asString();
+    }
+    const JsonValue* vars = response.find("vars");
+    if (vars && vars->isObject()) {
+        collectJsonVariables(*vars, result.vars);
+    }
+    const JsonValue* ok = response.find("ok");
+    result.success = !ok || ok->asBool(false);
+    if (!result.success) {
+        const JsonValue* error = response.find("error");
+        result.error = error ? error->asString("unknown error") : "unknown error";
+    }
+    return result;
+}
+
+PluginResult PluginHost::runConsoleCaptured(const PluginInfo& plugin, const std::string& args) {
+    PluginResult result;
+    result.pluginName = plugin.name;
+
+    std::string program;
+    std::vector<std::string> commandArgs;
+    resolvePluginCommand(plugin, program, commandArgs);
+    for (auto& arg : splitArguments(args)) {
+        commandArgs.push_back(std::move(arg));
+    }
+
+    auto process = startChildProcess(program, commandArgs, result.error);
+    if (!process) {
+        return result;
+    }
+    process->closeInput();
+
+    // 读到进程关闭标准输出为止
+    PipeStatus status = process->read(kMaxFrameSize, result.output, plugin.timeoutMs);
+    if (status == PipeStatus::TIMEOUT) {
+        process->kill();
+        result.error = "timed out after " + std::to_string(plugin.timeoutMs) + "ms";
+        return result;
+    }
+    if (status == PipeStatus::OK) {
+        process->kill();
+        result.error = "output exceeds " + std::to_string(kMaxFrameSize) + " bytes";
+        return result;
+    }
+
+    int exitCode = -1;
+    if (!process->closeAndWait(plugin.timeoutMs, &exitCode)) {
+        process->kill();
+        result.error = "process did not exit after closing its output";
+        return result;
+    }
+    if (exitCode != 0) {
+        result.error = "exited with code " + std::to_string(exitCode);
+        return result;
+    }
+
+    if (plugin.output == PluginOutput::VARS) {
+        extractPluginVariables(result.output, result.vars);
+    }
+    result.success = true;
+    return result;
+}
+
+void PluginHost::shutdown() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : workers) {
+        Worker& worker = *entry.second;
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+        if (worker.process) {
+            if (!worker.process->closeAndWait(kShutdownWaitMs)) {
+                worker.process->kill();
+            }
+            worker.process.reset();
+        }
+    }
+    workers.clear();
+}
+
+// ==================== 后台调用 ====================
+
+PluginTasks& PluginTasks::instance() {
+    static PluginTasks tasks;
+    return tasks;
+}
+
+namespace {
+    // 同时运行的后台插件调用数上限，多出的调用排队
+    constexpr size_t kMaxTaskThreads = 4;
+}
+
+PluginTasks::PluginTasks() {
+    // 先完成 PluginHost 和 NativePlugins 的构造，静态析构时它们晚于本对象销毁，仍在运行的调用可以安全结束
+    PluginHost::instance();
+    NativePlugins::instance();
+}
+
+PluginTasks::~PluginTasks() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool PluginTasks::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(job));
+        if (idleThreads < queue.size() && threads.size() < kMaxTaskThreads) {
+            try {
+                threads.emplace_back(&PluginTasks::workerLoop, this);
+            }
+            catch (const std::system_error& e) {
+                Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                    "Cannot start async plugin thread: " + std::string(e.what()));
+                if (threads.empty()) {
+                    queue.pop_back();
+                    return false;
+                }
+            }
+        }
+    }
+    wake.notify_one();
+    return true;
+}
+
+void PluginTasks::workerLoop() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    for (;;) {
+        idleThreads++;
+        wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+        idleThreads--;
+        if (queue.empty()) {
+            return;     // stopping 且队列已清空
+        }
+        std::function<void()> job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+void PluginTasks::start(int slot, const PluginInfo& plugin, const std::string& args, const GameState& gameState) {
+    std::future<PluginResult> previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = tasks.find(slot);
+        if (it != tasks.end()) {
+            previous = std::move(it->second);
+            tasks.erase(it);
+        }
+    }
+    if (previous.valid()) {
+        Log(LogGrade::WARNING, LogCode::PLUGIN_EXEC_FAILED,
+            "Previous async call for the same variable was never awaited, discarding its result");
+        previous.wait();
+    }
+
+    // 原生插件在工作线程上读取变量，交给它一份游戏状态快照，不与脚本线程共享
+    auto snapshot = std::make_shared<const GameState>(gameState);
+    auto task = std::make_shared<std::packaged_task<PluginResult()>>([plugin, args, snapshot] {
+        return PluginHost::instance().run(plugin, args, snapshot.get());
+    });
+    std::future<PluginResult> future = task->get_future();
+    if (!submit([task] { (*task)(); })) {
+        // 无法创建任何工作线程时在当前线程执行
+        Log(LogGrade::WARNING, LogCode::FALLBACK_USED, "Running async plugin call synchronously");
+        (*task)();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks[slot] = std::move(future);
+}
+
+bool PluginTasks::pending(int slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.find(slot) != tasks.end();
+}
+
+bool PluginTasks::await(int slot, PluginResult& result) {
+    std::future<PluginResult> future;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = tasks.find(slot);
+        if (it == tasks.end()) {
+            return false;
+        }
+        future = std::move(it->second);
+        tasks.erase(it);
+    }
+    result = future.get();
+    return true;
+}
+
+void PluginTasks::discardAll() {
+    std::unordered_map<int, std::future<PluginResult>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        remaining.swap(tasks);
+    }
+    for (auto& entry : remaining) {
+        entry.second.wait();
+    }
+}
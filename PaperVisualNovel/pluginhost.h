@@ -0,0 +1,188 @@
+﻿// pluginhost.h
+#pragma once
+#ifndef PLUGINHOST_H
+#define PLUGINHOST_H
+
+#include "fileutils.h"
+#include "json.h"
+#include "platform.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 插件返回的一个变量赋值
+ */
+struct PluginVariable {
+    std::string name;
+    bool isString = false;
+    int intValue = 0;
+    std::string stringValue;
+};
+
+/**
+ * @brief 捕获输出的插件调用结果
+ */
+struct PluginResult {
+    std::string pluginName;
+    bool success = false;
+    std::string output;     // worker 模式为响应中的 output，console 模式为标准输出（Output = vars 时不含变量行）
+    std::string error;      // 失败原因
+    std::vector<PluginVariable> vars;   // worker 响应的 vars 对象，或 Output = vars 时从标准输出解析
+};
+
+/**
+ * @brief 从插件的标准输出中解析变量赋值（Output = vars）
+ *
+ * 整个输出是 JSON 对象时，每个成员都是一个变量；否则逐行查找 name=value，
+ * 其余行留在 output 中照常显示。整数值写入整型变量，其他值写入字符串变量
+ */
+void extractPluginVariables(std::string& output, std::vector<PluginVariable>& vars);
+
+/**
+ * @brief 把插件返回的变量一次性写入游戏状态
+ */
+void applyPluginVariables(const std::vector<PluginVariable>& vars, GameState& gameState);
+
+/**
+ * @brief 显示插件调用的输出，失败时报告错误，成功时写入返回的变量
+ * @param gameState 变量写入的游戏状态（可选）
+ * @return 调用成功时返回 true
+ */
+bool finishPluginCall(const PluginResult& result, GameState* gameState);
+
+/**
+ * @brief 常驻插件进程管理（about.cfg 中 Mode = worker 的插件）
+ *
+ * 每个插件第一次调用时启动一个工作进程，之后的调用复用同一进程，
+ * 通过标准输入输出交换带长度前缀的 JSON 消息：
+ *   帧格式：4 字节小端无符号长度 + JSON 文本（不含结尾换行）
+ *   请求：{"id": 1, "args": "运行参数"}
+ *   响应：{"id": 1, "ok": true, "output": "显示给玩家的文本", "error": "失败原因"}
+ * 调用超时（about.cfg 的 Timeout，毫秒）时结束工作进程，下次调用重新启动；
+ * 进程崩溃或管道关闭时自动重启并重发一次请求
+ */
+class PluginHost {
+public:
+    static PluginHost& instance();
+
+    /**
+     * @brief 向插件的工作进程发送一次请求并等待响应
+     * @param plugin 插件信息（需已解析 RunCommand / RunFile / Timeout）
+     * @param args 运行参数
+     * @param response 解析后的响应对象
+     * @param errorMessage 失败时的错误描述
+     * @return 收到合法响应时返回 true（响应中的 ok 由调用方检查）
+     */
+    bool call(const PluginInfo& plugin, const std::string& args,
+        JsonValue& response, std::string& errorMessage);
+
+    /**
+     * @brief 运行插件并捕获输出，不写入控制台，可在后台线程调用
+     *
+     * worker 模式发送一次请求；console 模式不经过 shell 启动插件进程（参数按
+     * shell 规则拆分），读取标准输出直到进程退出，超过 Timeout 时结束进程；
+     * native 模式在当前线程调用动态库（不受 Timeout 限制）
+     * @param gameState 原生插件读取变量的游戏状态，后台调用时为调用开始时的快照
+     */
+    PluginResult run(const PluginInfo& plugin, const std::string& args,
+        const GameState* gameState = nullptr);
+
+    /**
+     * @brief 关闭全部工作进程（先关闭输入等待其自行退出，超时后强制结束）
+     */
+    void shutdown();
+
+private:
+    PluginHost() = default;
+    ~PluginHost();
+    PluginHost(const PluginHost&) = delete;
+    PluginHost& operator=(const PluginHost&) = delete;
+
+    /**
+     * @brief 单个插件的工作进程，同一时间只处理一个请求
+     */
+    struct Worker {
+        std::mutex mutex;
+        std::unique_ptr<ChildProcess> process;
+        uint64_t nextId = 1;
+        int starts = 0;           // 已启动的次数，大于 0 时再启动即为重启
+    };
+
+    Worker& workerFor(const std::string& pluginName);
+    bool startWorker(const PluginInfo& plugin, Worker& worker, std::string& errorMessage);
+
+    PluginResult runConsoleCaptured(const PluginInfo& plugin, const std::string& args);
+
+    // 发送一次请求；进程已退出时 crashed 为 true，调用方可重启后重试
+    bool exchange(const PluginInfo& plugin, Worker& worker, const std::string& args,
+        JsonValue& response, std::string& errorMessage, bool& crashed);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<Worker>> workers;
+};
+
+/**
+ * @brief 后台运行的插件调用（plugin async / await）
+ *
+ * 调用按结果变量的槽位登记，交给少量复用的工作线程通过 PluginHost::run 执行，
+ * 脚本继续运行；await 时只在结果尚未就绪时阻塞。工作线程都在忙时调用排队等待。
+ * 原生插件读到的变量是调用开始时游戏状态的快照，之后脚本对变量的修改对本次调用不可见。
+ * 所有调用都受插件的 Timeout 限制，等待不会无限期阻塞
+ */
+class PluginTasks {
+public:
+    static PluginTasks& instance();
+
+    /**
+     * @brief 在后台开始一次插件调用，结果登记到 slot
+     * 该槽位已有未取回的调用时，先等待它结束并丢弃其结果
+     */
+    void start(int slot, const PluginInfo& plugin, const std::string& args, const GameState& gameState);
+
+    // 槽位上有尚未取回的调用
+    bool pending(int slot);
+
+    /**
+     * @brief 等待并取回槽位上的调用结果
+     * @return 没有登记的调用时返回 false
+     */
+    bool await(int slot, PluginResult& result);
+
+    /**
+     * @brief 等待全部后台调用结束并丢弃结果（离开游戏时调用）
+     */
+    void discardAll();
+
+private:
+    PluginTasks();
+    ~PluginTasks();
+    PluginTasks(const PluginTasks&) = delete;
+    PluginTasks& operator=(const PluginTasks&) = delete;
+
+    /**
+     * @brief 把调用交给工作线程，没有空闲线程且未达上限时新建一个
+     * @return 一个工作线程都无法创建时返回 false
+     */
+    bool submit(std::function<void()> job);
+    void workerLoop();
+
+    std::mutex mutex;
+    std::unordered_map<int, std::future<PluginResult>> tasks;
+
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> queue;
+    std::vector<std::thread> threads;
+    size_t idleThreads = 0;
+    bool stopping = false;
+};
+
+#endif // PLUGINHOST_H
@@ -0,0 +1,341 @@
+﻿// pluginregistry.cpp
+#include "pluginregistry.h"
+#include "platform.h"
+#include "ui.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace {
+    const char* const kPluginsDir = "Plugins";
+
+    // 两次检查插件目录是否变化的最小间隔
+    constexpr auto kRevalidateInterval = std::chrono::seconds(1);
+
+    std::string lowerName(const std::string& name) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return lower;
+    }
+
+    // 目录的修改时间，不存在时返回 0
+    int64_t directoryTime(const std::string& path) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(path, ec);
+        if (ec) {
+            return 0;
+        }
+        return static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+
+    // about.cfg 中 Mode / Output / Timeout 项
+    void applyRuntimeKey(PluginInfo& plugin, const std::string& key, const std::string& value) {
+        if (key == "Mode") {
+            std::string mode = lowerName(value);
+            if (mode == "worker") {
+                plugin.mode = PluginMode::WORKER;
+            }
+            else {
+                if (mode != "console") {
+                    Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                        "Unknown plugin mode '" + value + "' for " + plugin.name + ", using console");
+                }
+                plugin.mode = PluginMode::CONSOLE;
+            }
+        }
+        else if (key == "Output") {
+            std::string output = lowerName(value);
+            if (output == "vars") {
+                plugin.output = PluginOutput::VARS;
+            }
+            else {
+                if (output != "console") {
+                    Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                        "Unknown plugin output '" + value + "' for " + plugin.name + ", using console");
+                }
+                plugin.output = PluginOutput::CONSOLE;
+            }
+        }
+        else if (key == "Timeout") {
+            try {
+                int timeout = std::stoi(value);
+                if (timeout > 0) {
+                    plugin.timeoutMs = timeout;
+                }
+            }
+            catch (const std::exception&) {
+                Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                    "Invalid plugin timeout '" + value + "' for " + plugin.name);
+            }
+        }
+    }
+
+    /**
+     * @brief 解析 about.cfg
+     * @return 文件无法打开时返回 false
+     */
+    bool parseManifest(const std::string& path, PluginRecord& record) {
+        std::ifstream aboutFile(path);
+        if (!aboutFile.is_open()) {
+            return false;
+        }
+
+        PluginInfo& plugin = record.info;
+        std::string line;
+        while (std::getline(aboutFile, line)) {
+            std::string trimmedLine = trim(line);
+            if (trimmedLine.empty() || trimmedLine[0] == '#') {
+                continue;
+            }
+
+            size_t equalsPos = trimmedLine.find('=');
+            if (equalsPos == std::string::npos) {
+                continue;
+            }
+
+            std::string key = trim(trimmedLine.substr(0, equalsPos));
+            std::string value = trim(trimmedLine.substr(equalsPos + 1));
+
+            if (value.length() >= 2 &&
+                ((value.front() == '"' && value.back() == '"') ||
+                    (value.front() == '\'' && value.back() == '\''))) {
+                value = value.substr(1, value.length() - 2);
+            }
+
+            if (key == "RunCommand") {
+                plugin.runCommand = value;
+                record.hasRunCommand = true;
+            }
+            else if (key == "RunFile") {
+                plugin.runFile = value;
+                record.hasRunFile = true;
+            }
+            else if (key == "Description") {
+                plugin.description = value;
+            }
+            else if (key == "Version") {
+                plugin.version = value;
+            }
+            else if (key == "Author") {
+                plugin.author = value;
+            }
+            else {
+                applyRuntimeKey(plugin, key, value);
+            }
+        }
+
+        // RunCommand = native 时 RunFile 是进程内加载的动态库，忽略 Mode
+        if (lowerName(plugin.runCommand) == "native") {
+            plugin.mode = PluginMode::NATIVE;
+        }
+        return true;
+    }
+}
+
+PluginRegistry& PluginRegistry::instance() {
+    static PluginRegistry registry;
+    return registry;
+}
+
+// ==================== 扫描与重新验证 ====================
+
+PluginRegistry::Entry PluginRegistry::loadEntry(const std::string& dirName) {
+    std::string pluginDir = std::string(kPluginsDir) + PVN_PATH_SEP + dirName;
+    std::string aboutFilePath = pluginDir + PVN_PATH_SEP "about.cfg";
+
+    Entry entry;
+    entry.dirTime = directoryTime(pluginDir);
+    entry.configStamp = getFileStamp(aboutFilePath);
+    entry.record.info.name = dirName;
+
+    if (!entry.configStamp.exists) {
+        Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
+            "Plugin " + dirName + " missing about.cfg file");
+        return entry;
+    }
+
+    entry.record.hasConfig = parseManifest(aboutFilePath, entry.record);
+    if (!entry.record.hasConfig) {
+        Log(LogGrade::WARNING, LogCode::FILE_OPEN_FAILED,
+            "Cannot open about.cfg for plugin: " + dirName);
+        return entry;
+    }
+
+    const PluginInfo& plugin = entry.record.info;
+    LOG_DEBUG(LogCode::PLUGIN_LOADED,
+        "Plugin ", dirName, " config: RunCommand=", plugin.runCommand,
+        ", RunFile=", plugin.runFile);
+
+    if (entry.record.runnable()) {
+        Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+            "Plugin loaded: " + dirName + (plugin.version.empty() ? "" : " v" + plugin.version));
+    }
+    else {
+        Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
+            "Plugin " + dirName + " missing required fields (RunCommand or RunFile)");
+    }
+    return entry;
+}
+
+void PluginRegistry::scanDirectory() {
+    auto scanStart = std::chrono::high_resolution_clock::now();
+
+    std::unordered_map<std::string, Entry> scanned;
+    rootTime = directoryTime(kPluginsDir);
+    int parsed = 0;
+
+    std::error_code ec;
+    if (!fs::is_directory(kPluginsDir, ec)) {
+        Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
+            std::string("Plugins directory does not exist: ") + kPluginsDir);
+        entries.clear();
+        return;
+    }
+
+    try {
+        for (const auto& dirEntry : fs::directory_iterator(kPluginsDir)) {
+            if (!dirEntry.is_directory()) {
+                continue;
+            }
+            std::string dirName = dirEntry.path().filename().string();
+            std::string key = lowerName(dirName);
+
+            // 未变化的插件沿用上次的解析结果
+            auto old = entries.find(key);
+            if (old != entries.end() && old->second.record.info.name == dirName &&
+                old->second.dirTime == directoryTime(dirEntry.path().string()) &&
+                old->second.configStamp == getFileStamp(dirEntry.path().string() + PVN_PATH_SEP "about.cfg")) {
+                scanned.emplace(key, std::move(old->second));
+                continue;
+            }
+
+            scanned[key] = loadEntry(dirName);
+            parsed++;
+        }
+    }
+    catch (const std::exception& e) {
+        Log(LogGrade::ERR, LogCode::MEMORY_ERROR,
+            "Error reading plugins directory: " + std::string(e.what()));
+
+        formatErrorOutput(
+            logCodeToString(LogCode::MEMORY_ERROR),
+            "FileSystemError",
+            "Cannot read plugins directory",
+            "",
+            0,
+            std::string::npos,
+            "Check if the Plugins directory is accessible and not corrupted",
+            "https://github.com/Colasensei/PaperVisualNovel/tree/master/Docs/errors/E3007.md"
+        );
+
+        platform().showMessage("读取插件目录时出错", "错误", MessageLevel::ERR);
+    }
+
+    entries = std::move(scanned);
+
+    auto scanTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - scanStart).count();
+    Log(LogGrade::INFO, LogCode::PLUGIN_LOADED,
+        "Plugin registry: " + std::to_string(entries.size()) + " plugins, " +
+        std::to_string(parsed) + " manifests parsed (took " + std::to_string(scanTime) + "ms)");
+}
+
+void PluginRegistry::revalidateEntries() {
+    for (auto& [key, entry] : entries) {
+        std::string pluginDir = std::string(kPluginsDir) + PVN_PATH_SEP + entry.record.info.name;
+        if (entry.dirTime != directoryTime(pluginDir) ||
+            entry.configStamp != getFileStamp(pluginDir + PVN_PATH_SEP "about.cfg")) {
+            LOG_DEBUG(LogCode::PLUGIN_LOADED, "Plugin changed, reloading: ", entry.record.info.name);
+            entry = loadEntry(entry.record.info.name);
+        }
+    }
+}
+
+void PluginRegistry::refresh() {
+    auto now = std::chrono::steady_clock::now();
+    if (loaded && now - lastCheck < kRevalidateInterval) {
+        return;
+    }
+    lastCheck = now;
+
+    // 增删插件目录会改变 Plugins/ 的修改时间，此时重新列目录；否则只检查已知插件
+    if (!loaded || directoryTime(kPluginsDir) != rootTime) {
+        scanDirectory();
+        loaded = true;
+    }
+    else {
+        revalidateEntries();
+    }
+}
+
+void PluginRegistry::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded = false;
+}
+
+// ==================== 查询 ====================
+
+bool PluginRegistry::lookup(const std::string& name, PluginRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refresh();
+    auto it = entries.find(lowerName(name));
+    if (it == entries.end()) {
+        return false;
+    }
+    record = it->second.record;
+    return true;
+}
+
+bool PluginRegistry::has(const std::string& name) {
+    PluginRecord record;
+    bool exists = lookup(name, record);
+    LOG_DEBUG(LogCode::PLUGIN_LOADED,
+        "Checking plugin existence: ", name, " - ", (exists ? "found" : "not found"));
+    return exists;
+}
+
+std::vector<PluginInfo> PluginRegistry::list() {
+    std::lock_guard<std::mutex> lock(mutex);
+    refresh();
+    std::vector<PluginInfo> plugins;
+    for (const auto& [key, entry] : entries) {
+        if (entry.record.runnable()) {
+            plugins.push_back(entry.record.info);
+        }
+    }
+    std::sort(plugins.begin(), plugins.end(),
+        [](const PluginInfo& a, const PluginInfo& b) { return lowerName(a.name) < lowerName(b.name); });
+    return plugins;
+}
+
+std::vector<DependencyStatus> PluginRegistry::resolveDependencies(
+    const std::vector<PluginDependency>& dependencies) {
+    std::vector<DependencyStatus> results;
+    results.reserve(dependencies.size());
+
+    for (const auto& dependency : dependencies) {
+        DependencyStatus status;
+        status.dependency = dependency;
+
+        PluginRecord record;
+        status.installed = lookup(dependency.name, record);
+        status.hasConfig = record.hasConfig;
+        status.installedVersion = record.info.version;
+        status.versionMatches = dependency.version.empty() || status.installedVersion.empty() ||
+            status.installedVersion == dependency.version;
+
+        if (!status.installed) {
+            Log(LogGrade::WARNING, LogCode::PLUGIN_MISSING,
+                "Script requires plugin " + dependency.name + " (line " +
+                std::to_string(dependency.line) + "), which is not installed");
+        }
+        else if (!status.versionMatches) {
+            Log(LogGrade::WARNING, LogCode::VERSION_MISMATCH,
+                "Script requires plugin " + dependency.name + " v" + dependency.version +
+                ", installed v" + status.installedVersion);
+        }
+        results.push_back(std::move(status));
+    }
+    return results;
+}
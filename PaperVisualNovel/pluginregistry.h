@@ -0,0 +1,91 @@
+﻿// pluginregistry.h
+#pragma once
+#ifndef PLUGINREGISTRY_H
+#define PLUGINREGISTRY_H
+
+#include "fileutils.h"
+#include "scriptindex.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 单个插件目录的解析结果
+ */
+struct PluginRecord {
+    PluginInfo info;
+    bool hasConfig = false;         // about.cfg 存在且可读
+    bool hasRunCommand = false;     // about.cfg 中出现了 RunCommand
+    bool hasRunFile = false;        // about.cfg 中出现了 RunFile
+
+    // 可以运行（RunCommand 和 RunFile 均已配置）
+    bool runnable() const { return hasConfig && hasRunCommand && hasRunFile; }
+};
+
+/**
+ * @brief 脚本插件依赖（use）的检查结果
+ */
+struct DependencyStatus {
+    PluginDependency dependency;
+    bool installed = false;         // 插件目录存在
+    bool hasConfig = false;         // about.cfg 存在
+    std::string installedVersion;   // about.cfg 中的 Version，可为空
+    bool versionMatches = true;     // 未指定版本或版本一致
+};
+
+/**
+ * @brief 已安装插件的注册表（Plugins/ 目录）
+ *
+ * 首次访问时扫描 Plugins/ 并解析每个插件的 about.cfg，按插件名（不区分大小写）
+ * 存入哈希表，之后的查询只访问内存。每隔一段时间检查一次 Plugins/ 目录、
+ * 各插件目录和 about.cfg 的修改时间，只重新解析发生变化的插件
+ */
+class PluginRegistry {
+public:
+    static PluginRegistry& instance();
+
+    /**
+     * @brief 查找插件
+     * @return 插件目录不存在时返回 false
+     */
+    bool lookup(const std::string& name, PluginRecord& record);
+
+    bool has(const std::string& name);
+
+    // 可运行的插件列表，按名称排序
+    std::vector<PluginInfo> list();
+
+    /**
+     * @brief 在脚本加载时检查 use 声明的插件依赖
+     */
+    std::vector<DependencyStatus> resolveDependencies(const std::vector<PluginDependency>& dependencies);
+
+    // 下次访问时重新扫描整个目录
+    void invalidate();
+
+private:
+    PluginRegistry() = default;
+    PluginRegistry(const PluginRegistry&) = delete;
+    PluginRegistry& operator=(const PluginRegistry&) = delete;
+
+    struct Entry {
+        PluginRecord record;
+        int64_t dirTime = 0;        // 插件目录的修改时间（增删文件、改名替换时变化）
+        FileStamp configStamp;      // about.cfg 的大小和修改时间（原地修改时变化）
+    };
+
+    void refresh();                 // 需要时重新扫描，调用方持有锁
+    void scanDirectory();
+    void revalidateEntries();
+    Entry loadEntry(const std::string& dirName);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;     // 小写插件名 → 解析结果
+    int64_t rootTime = 0;
+    bool loaded = false;
+    std::chrono::steady_clock::time_point lastCheck;
+};
+
+#endif // PLUGINREGISTRY_H
@@ -0,0 +1,121 @@
+﻿// pvn_plugin.h
+// 原生插件接口（C ABI）。插件以动态库形式编译，只需包含本文件，不依赖解释器的其他头文件
+#pragma once
+#ifndef PVN_PLUGIN_H
+#define PVN_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 接口版本
+ *
+ * 只在末尾追加字段时递增；插件声明自己实现的版本，
+ * 解释器接受从 PVN_PLUGIN_MIN_API_VERSION 到 PVN_PLUGIN_API_VERSION 之间的插件
+ */
+#define PVN_PLUGIN_API_VERSION 1
+#define PVN_PLUGIN_MIN_API_VERSION 1
+
+// 插件唯一需要导出的符号
+#define PVN_PLUGIN_ENTRY_NAME "pvn_plugin_entry"
+
+#if defined(_WIN32)
+#define PVN_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define PVN_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+// 日志级别（PvnHostApi::log）
+#define PVN_LOG_INFO 0
+#define PVN_LOG_WARNING 1
+#define PVN_LOG_ERROR 2
+
+/**
+ * @brief 单次调用的上下文（不透明），只在回调执行期间有效
+ */
+typedef struct PvnHost PvnHost;
+
+/**
+ * @brief 脚本命令的处理函数
+ * @param args 命令字之后的参数文本（${var} 已展开）
+ * @return 0 表示成功，非 0 表示失败（可先调用 fail 给出原因）
+ */
+typedef int (*PvnCommandFn)(PvnHost* host, const char* args, void* userData);
+
+/**
+ * @brief 解释器提供给插件的函数表
+ *
+ * 变量写入在调用返回后一次性应用到游戏状态，读取能看到本次调用中已写入的值；
+ * 后台调用（plugin async）读取的是执行 plugin async 时游戏状态的快照，之后脚本对变量的修改
+ * 对这次调用不可见。init 中没有游戏状态，读取其他变量得到 0 / 空字符串
+ */
+typedef struct PvnHostApi {
+    uint32_t apiVersion;    // 解释器实现的接口版本
+    uint32_t size;          // sizeof(PvnHostApi)
+
+    int (*getInt)(PvnHost* host, const char* name);
+    void (*setInt)(PvnHost* host, const char* name, int value);
+
+    /**
+     * @brief 读取字符串变量
+     * 写入 buffer 时截断到 bufferSize - 1 字节并以 '\0' 结尾
+     * @return 变量的完整长度（不含 '\0'），可用于重新分配缓冲区
+     */
+    size_t (*getString)(PvnHost* host, const char* name, char* buffer, size_t bufferSize);
+    void (*setString)(PvnHost* host, const char* name, const char* value);
+
+    // 追加显示给玩家的文本
+    void (*write)(PvnHost* host, const char* text);
+
+    // 设置本次调用的失败原因
+    void (*fail)(PvnHost* host, const char* message);
+
+    // 写入解释器日志（PVN_LOG_*）
+    void (*log)(PvnHost* host, int level, const char* message);
+
+    /**
+     * @brief 注册脚本命令，只能在 init 中调用
+     *
+     * 命令名由字母、数字和下划线组成，区分大小写；
+     * 与内置命令或其他插件已注册的命令重名时注册失败
+     * @return 0 表示成功
+     */
+    int (*registerCommand)(PvnHost* host, const char* name, PvnCommandFn handler, void* userData);
+} PvnHostApi;
+
+/**
+ * @brief 插件描述，由入口函数返回，需在插件卸载前保持有效
+ */
+typedef struct PvnPlugin {
+    uint32_t apiVersion;    // 插件实现的接口版本
+    uint32_t size;          // sizeof(PvnPlugin)
+    const char* name;
+    const char* version;
+
+    // 加载后调用一次，可注册命令；返回非 0 时放弃加载
+    int (*init)(PvnHost* host);
+
+    // plugin <名称> "<参数>" 时调用，可为空
+    int (*run)(PvnHost* host, const char* args);
+
+    // 卸载前调用一次（init 返回非 0 时也会调用，用于释放 init 中已分配的资源），可为空
+    void (*shutdown)(void);
+} PvnPlugin;
+
+/**
+ * @brief 插件入口（导出名 pvn_plugin_entry）
+ *
+ * api 在插件卸载前一直有效。插件不支持解释器的接口版本时返回 NULL。
+ * 同一插件的调用由解释器串行执行；回调不得抛出 C++ 异常
+ */
+typedef const PvnPlugin* (*PvnPluginEntryFn)(const PvnHostApi* api);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PVN_PLUGIN_H
@@ -0,0 +1,35 @@
+﻿// rewind.cpp
+#include "rewind.h"
+
+RewindHistory::RewindHistory(size_t capacity) : capacity(capacity) {
+}
+
+void RewindHistory::record(size_t line, const GameState& gameState) {
+    if (capacity == 0) {
+        return;
+    }
+    // 同一行重复执行（如回退后重新显示）时只保留最新一份
+    if (!points.empty() && points.back().line == line) {
+        points.back().state = gameState;
+        return;
+    }
+    if (points.size() >= capacity) {
+        points.pop_front();
+    }
+    points.push_back({ line, gameState });
+}
+
+bool RewindHistory::rewind(size_t& line, GameState& gameState) {
+    // 最后一个记录是当前所在的位置，需要回到它之前的一个
+    if (points.size() < 2) {
+        return false;
+    }
+    points.pop_back();
+
+    // 回退点重新执行时会再次记录，这里直接取出
+    Point& target = points.back();
+    line = target.line;
+    gameState = std::move(target.state);
+    points.pop_back();
+    return true;
+}
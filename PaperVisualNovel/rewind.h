@@ -0,0 +1,43 @@
+﻿// rewind.h
+#pragma once
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "gamestate.h"
+#include <deque>
+
+/**
+ * @brief 回退历史
+ *
+ * 在每条 say / choose 执行前记录当前行号和游戏状态。GameState 内部为写时复制结构，
+ * 记录一次只增加引用计数，不复制变量表和选择历史。回退时直接恢复快照，
+ * 不需要从脚本开头重新执行
+ */
+class RewindHistory {
+public:
+    explicit RewindHistory(size_t capacity = 200);
+
+    // 记录回退点，超过容量时丢弃最早的记录
+    void record(size_t line, const GameState& gameState);
+
+    /**
+     * @brief 回到上一个回退点
+     * @param line 输出回退点的行号
+     * @param gameState 输出回退点的游戏状态
+     * @return 没有更早的回退点时返回 false，参数保持不变
+     */
+    bool rewind(size_t& line, GameState& gameState);
+
+    size_t size() const { return points.size(); }
+
+private:
+    struct Point {
+        size_t line;
+        GameState state;
+    };
+
+    std::deque<Point> points;
+    size_t capacity;
+};
+
+#endif // REWIND_H
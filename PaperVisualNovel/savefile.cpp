@@ -0,0 +1,727 @@
+﻿// savefile.cpp
+#include "savefile.h"
+#include "fileutils.h"
+#include "ui.h"
+#include "platform.h"
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+    constexpr char kSaveMagic[4] = { 'P', 'V', 'N', 'S' };
+    constexpr uint16_t kSaveVersion = 1;
+    constexpr size_t kFileHeaderSize = 8;
+    constexpr size_t kRecordHeaderSize = 9;
+    constexpr uint32_t kMaxRecordSize = 256u * 1024 * 1024;
+
+    // 超过此数量的增量记录或文件超过完整快照若干倍时压缩
+    constexpr int kMaxDeltaRecords = 32;
+    constexpr uintmax_t kMaxGrowthFactor = 4;
+
+    enum class RecordType : uint8_t {
+        FULL = 1,
+        DELTA = 2
+    };
+
+    /**
+     * @brief 存档内容的按名视图（与槽位编号无关，可跨进程保存）
+     */
+    struct SaveImage {
+        std::string scriptPath;
+        uint64_t currentLine = 0;
+        std::string saveTime;
+        std::map<std::string, int> variables;
+        std::map<std::string, std::string> stringVariables;
+        std::vector<std::string> choiceHistory;
+        std::vector<std::string> collectedEndings;
+    };
+
+    /**
+     * @brief 本进程最近一次写入某个存档后的状态，用于计算下一次的增量
+     */
+    struct SaveChain {
+        SaveImage image;
+        FileStamp stamp;            // 写入后的文件指纹，不一致说明文件被外部修改或删除
+        int deltaCount = 0;
+        uintmax_t fullSize = 0;     // 最近一次完整快照的文件大小
+    };
+
+    std::mutex chainMutex;
+    std::map<std::string, SaveChain> chains;
+
+    std::mutex failureMutex;
+    std::vector<std::string> failedSaves;
+
+    // ==================== CRC32 ====================
+
+    const std::array<uint32_t, 256>& crcTable() {
+        static const std::array<uint32_t, 256> table = []() {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                }
+                result[i] = c;
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    uint32_t crc32(const char* data, size_t size) {
+        const auto& table = crcTable();
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            c = table[(c ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (c >> 8);
+        }
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    // ==================== 编码 ====================
+
+    class ByteWriter {
+    public:
+        void u8(uint8_t value) { out.push_back(static_cast<char>(value)); }
+        void u16(uint16_t value) { for (int i = 0; i < 2; i++) u8(static_cast<uint8_t>(value >> (8 * i))); }
+        void u32(uint32_t value) { for (int i = 0; i < 4; i++) u8(static_cast<uint8_t>(value >> (8 * i))); }
+        void u64(uint64_t value) { for (int i = 0; i < 8; i++) u8(static_cast<uint8_t>(value >> (8 * i))); }
+        void i32(int value) { u32(static_cast<uint32_t>(value)); }
+        void str(const std::string& value) {
+            u32(static_cast<uint32_t>(value.size()));
+            out.append(value);
+        }
+        void raw(const std::string& value) { out.append(value); }
+
+        std::string out;
+    };
+
+    class ByteReader {
+    public:
+        ByteReader(const char* data, size_t size) : data(data), size(size) {}
+
+        bool u8(uint8_t& value) {
+            if (pos + 1 > size) return false;
+            value = static_cast<uint8_t>(data[pos++]);
+            return true;
+        }
+        bool u16(uint16_t& value) { uint64_t v; if (!readLE(2, v)) return false; value = static_cast<uint16_t>(v); return true; }
+        bool u32(uint32_t& value) { uint64_t v; if (!readLE(4, v)) return false; value = static_cast<uint32_t>(v); return true; }
+        bool u64(uint64_t& value) { return readLE(8, value); }
+        bool i32(int& value) { uint32_t v; if (!u32(v)) return false; value = static_cast<int>(v); return true; }
+        bool str(std::string& value) {
+            uint32_t length;
+            if (!u32(length) || length > size - pos) return false;
+            value.assign(data + pos, length);
+            pos += length;
+            return true;
+        }
+        bool atEnd() const { return pos == size; }
+
+    private:
+        bool readLE(int bytes, uint64_t& value) {
+            if (pos + bytes > size) return false;
+            value = 0;
+            for (int i = 0; i < bytes; i++) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            pos += bytes;
+            return true;
+        }
+
+        const char* data;
+        size_t size;
+        size_t pos = 0;
+    };
+
+    SaveImage imageFromSaveData(const SaveData& saveData) {
+        SaveImage image;
+        image.scriptPath = saveData.scriptPath;
+        image.currentLine = saveData.currentLine;
+        image.saveTime = saveData.saveTime;
+        image.variables = saveData.gameState.getAllVariables();
+        image.stringVariables = saveData.gameState.getAllStringVariables();
+        image.choiceHistory = saveData.gameState.getChoiceHistory();
+        image.collectedEndings = saveData.gameState.getCollectedEndings();
+        return image;
+    }
+
+    void imageToSaveData(const SaveImage& image, SaveData& saveData) {
+        saveData.scriptPath = image.scriptPath;
+        saveData.currentLine = static_cast<size_t>(image.currentLine);
+        saveData.saveTime = image.saveTime;
+        saveData.gameState = GameState();
+        for (const auto& [name, value] : image.variables) {
+            saveData.gameState.setVar(name, value);
+        }
+        for (const auto& [name, value] : image.stringVariables) {
+            saveData.gameState.setStringVar(name, value);
+        }
+        for (const auto& choice : image.choiceHistory) {
+            saveData.gameState.recordChoice(choice);
+        }
+        for (const auto& ending : image.collectedEndings) {
+            saveData.gameState.addEnding(ending);
+        }
+    }
+
+    void writeList(ByteWriter& writer, const std::vector<std::string>& list, size_t from) {
+        writer.u32(static_cast<uint32_t>(list.size() - from));
+        for (size_t i = from; i < list.size(); i++) {
+            writer.str(list[i]);
+        }
+    }
+
+    size_t commonPrefix(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+        size_t n = std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < n && a[i] == b[i]) {
+            i++;
+        }
+        return i;
+    }
+
+    std::string encodeFull(const SaveImage& image) {
+        ByteWriter writer;
+        writer.str(image.scriptPath);
+        writer.u64(image.currentLine);
+        writer.str(image.saveTime);
+        writer.u32(static_cast<uint32_t>(image.variables.size()));
+        for (const auto& [name, value] : image.variables) {
+            writer.str(name);
+            writer.i32(value);
+        }
+        writer.u32(static_cast<uint32_t>(image.stringVariables.size()));
+        for (const auto& [name, value] : image.stringVariables) {
+            writer.str(name);
+            writer.str(value);
+        }
+        writeList(writer, image.choiceHistory, 0);
+        writeList(writer, image.collectedEndings, 0);
+        return writer.out;
+    }
+
+    /**
+     * @brief 编码 base → image 的变化
+     *
+     * 列表（选择历史、结局）只追加时记录保留的前缀长度和新增部分
+     */
+    std::string encodeDelta(const SaveImage& base, const SaveImage& image) {
+        ByteWriter writer;
+        writer.u64(image.currentLine);
+        writer.str(image.saveTime);
+
+        auto encodeMap = [&writer](const auto& oldMap, const auto& newMap, auto writeValue) {
+            uint32_t changed = 0;
+            ByteWriter changes;
+            for (const auto& [name, value] : newMap) {
+                auto it = oldMap.find(name);
+                if (it == oldMap.end() || it->second != value) {
+                    changes.str(name);
+                    writeValue(changes, value);
+                    changed++;
+                }
+            }
+            uint32_t removed = 0;
+            ByteWriter removals;
+            for (const auto& [name, value] : oldMap) {
+                if (newMap.find(name) == newMap.end()) {
+                    removals.str(name);
+                    removed++;
+                }
+            }
+            writer.u32(changed);
+            writer.raw(changes.out);
+            writer.u32(removed);
+            writer.raw(removals.out);
+        };
+
+        encodeMap(base.variables, image.variables, [](ByteWriter& w, int value) { w.i32(value); });
+        encodeMap(base.stringVariables, image.stringVariables, [](ByteWriter& w, const std::string& value) { w.str(value); });
+
+        size_t keptChoices = commonPrefix(base.choiceHistory, image.choiceHistory);
+        writer.u32(static_cast<uint32_t>(keptChoices));
+        writeList(writer, image.choiceHistory, keptChoices);
+
+        size_t keptEndings = commonPrefix(base.collectedEndings, image.collectedEndings);
+        writer.u32(static_cast<uint32_t>(keptEndings));
+        writeList(writer, image.collectedEndings, keptEndings);
+
+        return writer.out;
+    }
+
+    bool readList(ByteReader& reader, std::vector<std::string>& list) {
+        uint32_t count;
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string item;
+            if (!reader.str(item)) return false;
+            list.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    bool decodeFull(const char* data, size_t size, SaveImage& image) {
+        ByteReader reader(data, size);
+        SaveImage result;
+        uint32_t count;
+
+        if (!reader.str(result.scriptPath) || !reader.u64(result.currentLine) || !reader.str(result.saveTime)) {
+            return false;
+        }
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name;
+            int value;
+            if (!reader.str(name) || !reader.i32(value)) return false;
+            result.variables[name] = value;
+        }
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name, value;
+            if (!reader.str(name) || !reader.str(value)) return false;
+            result.stringVariables[name] = value;
+        }
+        if (!readList(reader, result.choiceHistory) || !readList(reader, result.collectedEndings) || !reader.atEnd()) {
+            return false;
+        }
+
+        image = std::move(result);
+        return true;
+    }
+
+    bool decodeDelta(const char* data, size_t size, SaveImage& image) {
+        ByteReader reader(data, size);
+        SaveImage result = image;
+        uint32_t count;
+
+        if (!reader.u64(result.currentLine) || !reader.str(result.saveTime)) {
+            return false;
+        }
+
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name;
+            int value;
+            if (!reader.str(name) || !reader.i32(value)) return false;
+            result.variables[name] = value;
+        }
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name;
+            if (!reader.str(name)) return false;
+            result.variables.erase(name);
+        }
+
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name, value;
+            if (!reader.str(name) || !reader.str(value)) return false;
+            result.stringVariables[name] = value;
+        }
+        if (!reader.u32(count)) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name;
+            if (!reader.str(name)) return false;
+            result.stringVariables.erase(name);
+        }
+
+        uint32_t kept;
+        if (!reader.u32(kept) || kept > result.choiceHistory.size()) return false;
+        result.choiceHistory.resize(kept);
+        if (!readList(reader, result.choiceHistory)) return false;
+
+        if (!reader.u32(kept) || kept > result.collectedEndings.size()) return false;
+        result.collectedEndings.resize(kept);
+        if (!readList(reader, result.collectedEndings) || !reader.atEnd()) return false;
+
+        image = std::move(result);
+        return true;
+    }
+
+    std::string encodeRecord(RecordType type, const std::string& payload) {
+        ByteWriter writer;
+        writer.u8(static_cast<uint8_t>(type));
+        writer.u32(static_cast<uint32_t>(payload.size()));
+        writer.u32(crc32(payload.data(), payload.size()));
+        writer.raw(payload);
+        return writer.out;
+    }
+
+    std::string encodeFileHeader() {
+        ByteWriter writer;
+        writer.raw(std::string(kSaveMagic, sizeof(kSaveMagic)));
+        writer.u16(kSaveVersion);
+        writer.u16(0);
+        return writer.out;
+    }
+
+    /**
+     * @brief 依次应用存档中的记录
+     * @param recordCount 返回有效记录数（0 表示文件无效）
+     * @param deltaCount 返回最后一条完整快照之后的增量记录数
+     * @param validSize 返回有效部分的字节数（末尾有损坏记录时小于文件大小）
+     */
+    bool replaySaveFile(const std::string& savePath, SaveImage& image, int& recordCount, int& deltaCount, size_t& validSize) {
+        recordCount = 0;
+        deltaCount = 0;
+        validSize = 0;
+
+        std::ifstream fin(savePath, std::ios::binary);
+        if (!fin.is_open()) {
+            Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Cannot open save file: " + savePath);
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << fin.rdbuf();
+        std::string data = buffer.str();
+
+        uint16_t version = 0;
+        if (data.size() < kFileHeaderSize || std::memcmp(data.data(), kSaveMagic, sizeof(kSaveMagic)) != 0) {
+            Log(LogGrade::ERR, LogCode::SAVE_CORRUPTED, "Not a binary save file: " + savePath);
+            return false;
+        }
+        ByteReader versionReader(data.data() + sizeof(kSaveMagic), data.size() - sizeof(kSaveMagic));
+        versionReader.u16(version);
+        if (version > kSaveVersion) {
+            Log(LogGrade::ERR, LogCode::SAVE_CORRUPTED,
+                "Save file version " + std::to_string(version) + " is newer than supported version " + std::to_string(kSaveVersion));
+            return false;
+        }
+
+        size_t pos = kFileHeaderSize;
+        while (pos < data.size()) {
+            ByteReader reader(data.data() + pos, data.size() - pos);
+            uint8_t type;
+            uint32_t payloadSize, checksum;
+            bool valid = reader.u8(type) && reader.u32(payloadSize) && reader.u32(checksum) &&
+                payloadSize <= kMaxRecordSize && payloadSize <= data.size() - pos - kRecordHeaderSize;
+
+            const char* payload = data.data() + pos + kRecordHeaderSize;
+            valid = valid && crc32(payload, payloadSize) == checksum;
+
+            if (valid) {
+                if (type == static_cast<uint8_t>(RecordType::FULL)) {
+                    valid = decodeFull(payload, payloadSize, image);
+                    deltaCount = 0;
+                }
+                else if (type == static_cast<uint8_t>(RecordType::DELTA) && recordCount > 0) {
+                    valid = decodeDelta(payload, payloadSize, image);
+                    deltaCount++;
+                }
+                else {
+                    valid = false;
+                }
+            }
+
+            if (!valid) {
+                // 通常是追加时被中断，之前的记录仍然完整
+                Log(LogGrade::WARNING, LogCode::SAVE_CORRUPTED,
+                    "Invalid save record at offset " + std::to_string(pos) + " in " + savePath +
+                    ", using " + std::to_string(recordCount) + " valid record(s)");
+                break;
+            }
+
+            recordCount++;
+            pos += kRecordHeaderSize + payloadSize;
+            validSize = pos;
+        }
+
+        return recordCount > 0;
+    }
+
+    bool writeWholeFile(const std::string& savePath, const std::string& content, std::ios::openmode mode) {
+        std::ofstream fout(savePath, std::ios::binary | mode);
+        if (!fout.is_open()) {
+            Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Cannot open save file for writing: " + savePath);
+            return false;
+        }
+        fout.write(content.data(), static_cast<std::streamsize>(content.size()));
+        fout.close();
+        if (!fout) {
+            Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to write save file: " + savePath);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 存档写入任务
+     */
+    struct SaveJob {
+        std::string path;
+        SaveData saveData;
+        std::function<void(bool, size_t)> onComplete;
+    };
+
+    /**
+     * @brief 本进程写过的存档仍保持写入后的样子时追加增量，否则写完整快照
+     *
+     * 完整快照先写入 <存档>.tmp 并落盘，再原子替换正式文件，任何时刻中断都会留下旧存档或新存档之一；
+     * 增量记录直接追加并落盘，追加中断只会留下读取时被校验丢弃的半条记录
+     */
+    bool writeSaveNow(const std::string& savePath, const SaveData& saveData, size_t& saveSize) {
+        SaveImage image = imageFromSaveData(saveData);
+
+        std::lock_guard<std::mutex> lock(chainMutex);
+        auto it = chains.find(savePath);
+        FileStamp current = getFileStamp(savePath);
+
+        bool appendDelta = it != chains.end() && it->second.stamp == current && current.exists &&
+            it->second.deltaCount < kMaxDeltaRecords &&
+            current.size < it->second.fullSize * kMaxGrowthFactor &&
+            it->second.image.scriptPath == image.scriptPath;
+
+        if (appendDelta) {
+            SaveChain& chain = it->second;
+            std::string record = encodeRecord(RecordType::DELTA, encodeDelta(chain.image, image));
+            if (!writeFileDurable(savePath, record, true)) {
+                Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to append save record: " + savePath);
+                chains.erase(it);
+                return false;
+            }
+            chain.image = std::move(image);
+            chain.stamp = getFileStamp(savePath);
+            chain.deltaCount++;
+            saveSize = static_cast<size_t>(chain.stamp.size);
+            LOG_DEBUG(LogCode::GAME_SAVED, "Appended delta record #", chain.deltaCount, " (", record.size(), " bytes)");
+            return true;
+        }
+
+        std::string content = encodeFileHeader() + encodeRecord(RecordType::FULL, encodeFull(image));
+        std::string tempPath = savePath + ".tmp";
+        if (!writeFileDurable(tempPath, content, false) || !replaceFileAtomic(tempPath, savePath)) {
+            Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to write save file: " + savePath);
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            if (it != chains.end()) chains.erase(it);
+            return false;
+        }
+
+        SaveChain& chain = chains[savePath];
+        chain.image = std::move(image);
+        chain.stamp = getFileStamp(savePath);
+        chain.deltaCount = 0;
+        chain.fullSize = chain.stamp.size;
+        saveSize = content.size();
+        LOG_DEBUG(LogCode::GAME_SAVED, "Wrote full snapshot (", content.size(), " bytes)");
+        return true;
+    }
+
+    /**
+     * @brief 后台存档写入线程
+     *
+     * 调用线程只复制一份游戏状态后入队，转换、编码和写盘都在此线程按提交顺序完成
+     */
+    class SaveWriter {
+    public:
+        static SaveWriter& instance() {
+            static SaveWriter writer;
+            return writer;
+        }
+
+        void submit(SaveJob job) {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (!thread.joinable()) {
+                    thread = std::thread(&SaveWriter::writerLoop, this);
+                }
+                // 同一存档还在排队（尚未开始写）时只保留最新的数据，
+                // 回调合并到一起，写完后都会收到结果
+                for (SaveJob& queued : queue) {
+                    if (queued.path == job.path) {
+                        queued.saveData = std::move(job.saveData);
+                        if (job.onComplete) {
+                            auto previous = std::move(queued.onComplete);
+                            auto next = std::move(job.onComplete);
+                            queued.onComplete = [previous, next](bool ok, size_t saveSize) {
+                                if (previous) {
+                                    previous(ok, saveSize);
+                                }
+                                next(ok, saveSize);
+                            };
+                        }
+                        return;
+                    }
+                }
+                queue.push_back(std::move(job));
+                busy++;
+            }
+            wake.notify_one();
+        }
+
+        void waitIdle() {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            idle.wait(lock, [this]() { return busy == 0; });
+        }
+
+        ~SaveWriter() {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+
+    private:
+        SaveWriter() = default;
+
+        void writerLoop() {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            for (;;) {
+                wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;     // stopping 且已写完
+                }
+                SaveJob job = std::move(queue.front());
+                queue.pop_front();
+                lock.unlock();
+
+                size_t saveSize = 0;
+                bool ok = writeSaveNow(job.path, job.saveData, saveSize);
+                if (!ok) {
+                    std::lock_guard<std::mutex> failureLock(failureMutex);
+                    failedSaves.push_back(job.path);
+                }
+                if (job.onComplete) {
+                    job.onComplete(ok, saveSize);
+                }
+
+                lock.lock();
+                busy--;
+                if (busy == 0) {
+                    idle.notify_all();
+                }
+            }
+        }
+
+        std::mutex queueMutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<SaveJob> queue;
+        size_t busy = 0;                        // 已提交未完成的任务数
+        bool stopping = false;
+        std::thread thread;
+    };
+}
+
+// ==================== 二进制存档 ====================
+
+bool isBinarySaveFile(const std::string& savePath) {
+    waitForPendingSaves();
+    std::ifstream fin(savePath, std::ios::binary);
+    char magic[sizeof(kSaveMagic)] = {};
+    fin.read(magic, sizeof(magic));
+    return fin.gcount() == sizeof(magic) && std::memcmp(magic, kSaveMagic, sizeof(magic)) == 0;
+}
+
+void writeSaveFile(const std::string& savePath, SaveData saveData,
+    std::function<void(bool, size_t)> onComplete) {
+    SaveJob job;
+    job.path = savePath;
+    job.saveData = std::move(saveData);
+    job.onComplete = std::move(onComplete);
+    SaveWriter::instance().submit(std::move(job));
+}
+
+void waitForPendingSaves() {
+    SaveWriter::instance().waitIdle();
+}
+
+std::vector<std::string> takeFailedSaves() {
+    std::lock_guard<std::mutex> lock(failureMutex);
+    std::vector<std::string> result;
+    result.swap(failedSaves);
+    return result;
+}
+
+bool readSaveFile(const std::string& savePath, SaveData& saveData) {
+    waitForPendingSaves();
+
+    SaveImage image;
+    int recordCount = 0;
+    int deltaCount = 0;
+    size_t validSize = 0;
+    if (!replaySaveFile(savePath, image, recordCount, deltaCount, validSize)) {
+        return false;
+    }
+    LOG_DEBUG(LogCode::GAME_LOADED, "Save records replayed: ", recordCount, " (", deltaCount, " delta)");
+
+    // 记下读取到的状态，之后在同一存档上保存可以直接追加增量；
+    // 末尾有损坏记录时不记录，下次保存重写完整快照
+    {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        FileStamp stamp = getFileStamp(savePath);
+        if (stamp.size == validSize) {
+            SaveChain& chain = chains[savePath];
+            chain.image = image;
+            chain.stamp = stamp;
+            chain.deltaCount = deltaCount;
+            chain.fullSize = deltaCount == 0 ? stamp.size : kFileHeaderSize + kRecordHeaderSize + encodeFull(image).size();
+        }
+        else {
+            chains.erase(savePath);
+        }
+    }
+
+    imageToSaveData(image, saveData);
+    return true;
+}
+
+// ==================== 文本导出 ====================
+
+std::string formatSaveText(const SaveData& saveData) {
+    std::stringstream ss;
+    ss << "[SAVE_INFO]" << std::endl;
+    ss << "script_path=" << saveData.scriptPath << std::endl;
+    ss << "current_line=" << saveData.currentLine << std::endl;
+    ss << "save_time=" << saveData.saveTime << std::endl;
+    ss << std::endl;
+    ss << saveData.gameState.serialize();
+    return ss.str();
+}
+
+bool exportSaveText(const std::string& savePath, const std::string& textPath) {
+    SaveData saveData;
+    if (!loadGame(savePath, saveData)) {
+        return false;
+    }
+    if (!writeWholeFile(textPath, formatSaveText(saveData), std::ios::trunc)) {
+        return false;
+    }
+    Log(LogGrade::INFO, LogCode::GAME_SAVED, "Save exported as text: " + textPath);
+    return true;
+}
+
+int runExportSave(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "用法: --export-save <存档.sav> [输出.txt]" << std::endl;
+        return 2;
+    }
+
+    std::string savePath = argv[2];
+    std::string textPath = argc > 3 ? argv[3] : fs::path(savePath).replace_extension(".txt").string();
+
+    if (!fs::exists(savePath)) {
+        std::cerr << "存档不存在: " << savePath << std::endl;
+        return 2;
+    }
+    if (!exportSaveText(savePath, textPath)) {
+        std::cerr << "导出失败: " << savePath << std::endl;
+        return 1;
+    }
+    std::cout << "已导出: " << textPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+﻿// savefile.h
+#pragma once
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include "header.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * 二进制存档格式（版本 1，整数均为小端）
+ *
+ *   文件头: "PVNS" | u16 版本 | u16 保留
+ *   记录:   u8 类型 | u32 数据长度 | u32 CRC32 | 数据
+ *
+ * 第一条记录为完整快照（FULL），之后每次保存只追加与上一次保存相比的变化（DELTA）。
+ * 增量记录超过一定数量或文件明显膨胀时重写为单条完整快照（压缩）。
+ * 读取时逐条校验，末尾记录损坏（如写入中断）时回退到最后一条有效记录
+ */
+
+/**
+ * @brief 提交存档写入，能追加增量时只追加变化部分，否则写完整快照
+ *
+ * 存档数据移交给后台线程，编码和写盘都在后台完成，函数立即返回。
+ * 完整快照经临时文件、落盘、原子改名写入，写入中断不会破坏已有存档。
+ * 写入是否成功只能通过 onComplete 或 takeFailedSaves 得知
+ *
+ * @param onComplete 写入完成后在后台线程上回调 (是否成功, 文件大小)
+ */
+void writeSaveFile(const std::string& savePath, SaveData saveData,
+    std::function<void(bool, size_t)> onComplete = nullptr);
+
+/**
+ * @brief 等待所有已提交的存档写入完成（读取存档和退出程序前调用）
+ */
+void waitForPendingSaves();
+
+/**
+ * @brief 取出上次调用以来写入失败的存档路径
+ */
+std::vector<std::string> takeFailedSaves();
+
+/**
+ * @brief 读取二进制存档
+ * @return 文件不是二进制存档或第一条记录无效时返回false
+ */
+bool readSaveFile(const std::string& savePath, SaveData& saveData);
+
+/**
+ * @brief 判断文件是否为二进制存档（否则按旧版文本存档读取）
+ */
+bool isBinarySaveFile(const std::string& savePath);
+
+/**
+ * @brief 按文本存档格式输出（[SAVE_INFO] + GameState::serialize()）
+ */
+std::string formatSaveText(const SaveData& saveData);
+
+/**
+ * @brief 导出存档为文本格式，二进制和文本存档均可作为输入
+ */
+bool exportSaveText(const std::string& savePath, const std::string& textPath);
+
+/**
+ * @brief 命令行导出：--export-save <存档.sav> [输出.txt]
+ * @return 进程退出码
+ */
+int runExportSave(int argc, char* argv[]);
+
+#endif // SAVEFILE_H
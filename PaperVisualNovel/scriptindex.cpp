@@ -0,0 +1,132 @@
+﻿// scriptindex.cpp
+#include "scriptindex.h"
+#include "parser.h"
+#include "fileutils.h"
+#include "ui.h"
+#include <chrono>
+
+namespace {
+    std::string_view trimView(std::string_view text, std::string_view chars) {
+        size_t start = text.find_first_not_of(chars);
+        if (start == std::string_view::npos) {
+            return {};
+        }
+        size_t end = text.find_last_not_of(chars);
+        return text.substr(start, end - start + 1);
+    }
+
+    /**
+     * @brief choose 命令：choose <数量> 标签:文本 ...
+     */
+    void indexChoose(std::string_view rest, size_t lineNumber, std::vector<JumpRef>& jumps) {
+        std::string_view countToken = firstToken(rest, &rest);
+        int optionCount = 0;
+        try {
+            optionCount = std::stoi(std::string(countToken));
+        }
+        catch (const std::exception&) {
+            return;
+        }
+
+        for (int i = 0; i < optionCount; i++) {
+            std::string_view option = firstToken(rest, &rest);
+            if (option.empty()) {
+                break;
+            }
+            size_t colonPos = option.find(':');
+            std::string_view label = colonPos != std::string_view::npos ? option.substr(0, colonPos) : option;
+            jumps.push_back({ std::string(label), "choose", lineNumber });
+        }
+    }
+}
+
+// ==================== 脚本索引 ====================
+
+ScriptIndex buildScriptIndex(const std::vector<std::string_view>& lines) {
+    auto indexStart = std::chrono::high_resolution_clock::now();
+
+    ScriptIndex index;
+    index.lineCount = lines.size();
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        size_t lineNumber = i + 1;
+        std::string_view rest;
+        std::string_view cmd = firstToken(lines[i], &rest);
+        if (cmd.empty()) {
+            continue;
+        }
+
+        if (cmd.back() == ':') {
+            std::string label(cmd.substr(0, cmd.length() - 1));
+            auto [it, inserted] = index.labels.emplace(label, static_cast<int>(lineNumber));
+            if (!inserted) {
+                index.duplicateLabels.push_back({ label, static_cast<size_t>(it->second) });
+                it->second = static_cast<int>(lineNumber);
+            }
+        }
+        else if (cmd == "endname" || cmd == "ENDNAME") {
+            std::string_view name = trimView(rest, " \t\r");
+            if (!name.empty()) {
+                index.endings.push_back({ std::string(name), lineNumber });
+                index.endingNames.emplace(name);
+            }
+        }
+        else if (cmd == "use" || cmd == "USE") {
+            std::string_view name = firstToken(rest, &rest);
+            if (!name.empty()) {
+                index.plugins.push_back({ std::string(name), std::string(firstToken(rest)), lineNumber });
+            }
+        }
+        else if (cmd == "jump" || cmd == "JUMP") {
+            std::string_view target = firstToken(rest);
+            if (!target.empty()) {
+                index.jumps.push_back({ std::string(target), "jump", lineNumber });
+            }
+        }
+        else if (cmd == "if" || cmd == "IF") {
+            // 与编译器一致：最后一个空格之后为跳转目标
+            size_t lastSpace = rest.find_last_of(' ');
+            if (lastSpace != std::string_view::npos) {
+                index.jumps.push_back({ std::string(rest.substr(lastSpace + 1)), "if", lineNumber });
+            }
+        }
+        else if (cmd == "choose" || cmd == "CHOOSE") {
+            indexChoose(rest, lineNumber, index.jumps);
+        }
+    }
+
+    // 标签收集完后再解析跳转目标（允许向后引用）
+    for (JumpRef& jump : index.jumps) {
+        bool isLabel = false;
+        int jumpLine = parseJumpTarget(jump.target, index.labels, isLabel);
+        jump.jumpLine = (jumpLine > 0 && jumpLine <= static_cast<int>(lines.size())) ? jumpLine : -1;
+    }
+
+    auto indexEnd = std::chrono::high_resolution_clock::now();
+    auto indexTime = std::chrono::duration_cast<std::chrono::milliseconds>(indexEnd - indexStart).count();
+
+    LOG_DEBUG(LogCode::TOKEN_COMPLETE,
+        "Indexed ", lines.size(), " lines: ", index.labels.size(), " labels, ",
+        index.endingNames.size(), " endings, ", index.plugins.size(), " plugin dependencies, ",
+        index.jumps.size(), " jump targets (took ", indexTime, "ms)");
+
+    return index;
+}
+
+bool indexScriptFile(const std::string& scriptPath, ScriptIndex& index) {
+    ScriptSource source;
+    if (!source.load(scriptPath)) {
+        return false;
+    }
+    index = buildScriptIndex(source.lines());
+    return true;
+}
+
+void registerEndings(const ScriptIndex& index, GameState& gameState) {
+    for (const auto& ending : index.endings) {
+        gameState.registerEnding(ending.name);
+    }
+
+    Log(LogGrade::INFO, LogCode::ENDING_SAVED,
+        "Registered " + std::to_string(index.endings.size()) + " total endings from script");
+}
@@ -0,0 +1,74 @@
+﻿// scriptindex.h
+#pragma once
+#ifndef SCRIPTINDEX_H
+#define SCRIPTINDEX_H
+
+#include "gamestate.h"
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 脚本中的结局声明（endname）
+ */
+struct EndingDecl {
+    std::string name;
+    size_t line = 0;            // 1-based
+};
+
+/**
+ * @brief 脚本声明的插件依赖（use）
+ */
+struct PluginDependency {
+    std::string name;
+    std::string version;        // 可为空
+    size_t line = 0;
+};
+
+/**
+ * @brief 跳转引用（jump / if / choose 的目标）
+ */
+struct JumpRef {
+    std::string target;         // 标签名或行号原文
+    std::string cmd;            // 所在命令
+    size_t line = 0;
+    int jumpLine = -1;          // 解析后的行号（1-based，-1表示无效）
+};
+
+/**
+ * @brief 单遍扫描得到的脚本索引
+ *
+ * 标签、结局、插件依赖和跳转目标在加载时一次收集，
+ * 编译、结局统计和游戏列表都使用同一份结果，不再各自重新扫描脚本
+ */
+struct ScriptIndex {
+    size_t lineCount = 0;
+    std::map<std::string, int> labels;                          // 标签名 → 行号（同名取最后一个）
+    std::vector<std::pair<std::string, size_t>> duplicateLabels; // 被后面同名标签覆盖的标签
+    std::vector<EndingDecl> endings;                            // 按出现顺序
+    std::set<std::string> endingNames;                          // 去重后的结局名
+    std::vector<PluginDependency> plugins;
+    std::vector<JumpRef> jumps;
+
+    int totalEndings() const { return static_cast<int>(endingNames.size()); }
+};
+
+/**
+ * @brief 扫描脚本，建立索引
+ */
+ScriptIndex buildScriptIndex(const std::vector<std::string_view>& lines);
+
+/**
+ * @brief 读取脚本文件并建立索引
+ * @return 文件无法打开时返回false
+ */
+bool indexScriptFile(const std::string& scriptPath, ScriptIndex& index);
+
+/**
+ * @brief 将索引中的所有结局注册到游戏状态（用于统计总数）
+ */
+void registerEndings(const ScriptIndex& index, GameState& gameState);
+
+#endif // SCRIPTINDEX_H
@@ -0,0 +1,219 @@
+﻿// selector.cpp
+#include "selector.h"
+#include "config.h"
+#include "gum_wrapper.h"
+#include "platform.h"
+#include "ui.h"
+#include <cctype>
+
+namespace {
+    // 同时显示的最多选项数，超出时随光标滚动
+    constexpr size_t kMaxVisible = 10;
+
+    std::string toLowerAscii(std::string text) {
+        for (char& c : text) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return text;
+    }
+
+    // 删除末尾的一个完整字符
+    void popLastChar(std::string& text) {
+        size_t last = 0;
+        for (size_t pos = 0; pos < text.size(); pos += consoleCharLength(text, pos)) {
+            last = pos;
+        }
+        text.erase(last);
+    }
+
+    // 按键对应的输入文字（可见字符、输入法产生的整个字符或非 ASCII 字节），其他按键返回空字符串
+    std::string keyText(const std::string& key) {
+        if (key.size() == 1 || (!key.empty() && static_cast<unsigned char>(key[0]) >= 0x80)) {
+            return key;
+        }
+        if (key == "SPACE") {
+            return " ";
+        }
+        if (key.rfind("UNKNOWN_", 0) == 0) {
+            try {
+                int byte = std::stoi(key.substr(8));
+                if (byte >= 128 && byte <= 255) {
+                    return std::string(1, static_cast<char>(byte));
+                }
+            }
+            catch (const std::exception&) {
+            }
+        }
+        return "";
+    }
+
+    /**
+     * @brief 是否使用 gum 作为菜单后端（每个进程只检查一次）
+     */
+    bool useGumBackend() {
+        static const bool useGum = [] {
+            if (ConfigStore::instance().getString("MenuBackend", "builtin") != "gum") {
+                return false;
+            }
+            if (!gum::GumWrapper::is_available()) {
+                Log(LogGrade::WARNING, LogCode::FALLBACK_USED,
+                    "MenuBackend is gum but gum is not available, using built-in selector");
+                return false;
+            }
+            return true;
+        }();
+        return useGum;
+    }
+
+    int chooseWithGum(const std::vector<std::string>& options, const std::string& header) {
+        if (!header.empty()) {
+            std::cout << header << std::endl;
+        }
+        std::string selected = gum::GumWrapper::choose(options);
+        for (size_t i = 0; i < options.size(); i++) {
+            if (options[i] == selected) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief 内置选择控件
+     *
+     * 每次按键后整体重绘（回到控件首行并清除到屏幕末尾），一帧只写入一次
+     */
+    int chooseBuiltin(const std::vector<std::string>& options, const std::string& header) {
+        std::vector<size_t> visible;
+        std::string filter;
+        size_t cursor = 0;
+        size_t top = 0;
+        size_t drawnLines = 0;
+
+        auto applyFilter = [&]() {
+            visible.clear();
+            std::string needle = toLowerAscii(filter);
+            for (size_t i = 0; i < options.size(); i++) {
+                if (needle.empty() || toLowerAscii(options[i]).find(needle) != std::string::npos) {
+                    visible.push_back(i);
+                }
+            }
+            cursor = 0;
+            top = 0;
+        };
+        applyFilter();
+
+        std::cout.flush();
+        platform().write("\033[?25l");
+
+        int result = -1;
+        while (true) {
+            if (cursor < top) {
+                top = cursor;
+            }
+            else if (cursor >= top + kMaxVisible) {
+                top = cursor - kMaxVisible + 1;
+            }
+
+            std::string frame;
+            if (drawnLines > 0) {
+                frame += "\033[" + std::to_string(drawnLines) + "F\033[J";
+            }
+            drawnLines = 0;
+
+            if (!header.empty()) {
+                frame += "\033[37m" + header + "\n";
+                drawnLines++;
+            }
+            for (size_t row = top; row < visible.size() && row < top + kMaxVisible; row++) {
+                if (row == cursor) {
+                    frame += "\033[36m> " + options[visible[row]] + "\033[37m\n";
+                }
+                else {
+                    frame += "\033[37m  " + options[visible[row]] + "\n";
+                }
+                drawnLines++;
+            }
+            if (visible.empty()) {
+                frame += "\033[90m  （没有匹配的选项）\033[37m\n";
+                drawnLines++;
+            }
+            frame += "\033[90m↑↓ 移动  回车确认  数字键直接选择  输入文字过滤";
+            if (!filter.empty()) {
+                frame += "  过滤：" + filter;
+            }
+            frame += "\033[37m\n";
+            drawnLines++;
+            platform().write(frame);
+
+            std::string key = platform().readKey();
+            if (key == "UP") {
+                cursor = cursor > 0 ? cursor - 1 : (visible.empty() ? 0 : visible.size() - 1);
+            }
+            else if (key == "DOWN") {
+                cursor = visible.empty() ? 0 : (cursor + 1) % visible.size();
+            }
+            else if (key == "HOME" || key == "PAGE_UP") {
+                cursor = 0;
+            }
+            else if (key == "END" || key == "PAGE_DOWN") {
+                cursor = visible.empty() ? 0 : visible.size() - 1;
+            }
+            else if (key == "ENTER") {
+                if (!visible.empty()) {
+                    result = static_cast<int>(visible[cursor]);
+                    break;
+                }
+            }
+            else if (key == "ESC") {
+                // 有过滤条件时先清除过滤，再按一次取消
+                if (filter.empty()) {
+                    break;
+                }
+                filter.clear();
+                applyFilter();
+            }
+            else if (key == "BACKSPACE") {
+                if (!filter.empty()) {
+                    popLastChar(filter);
+                    applyFilter();
+                }
+            }
+            else if (filter.empty() && key.size() == 1 && std::isdigit(static_cast<unsigned char>(key[0])) &&
+                key[0] != '0' && static_cast<size_t>(key[0] - '0') <= options.size()) {
+                result = key[0] - '1';
+                break;
+            }
+            else {
+                std::string text = keyText(key);
+                if (!text.empty()) {
+                    filter += text;
+                    applyFilter();
+                }
+            }
+        }
+
+        // 清除控件，恢复光标
+        platform().write("\033[" + std::to_string(drawnLines) + "F\033[J\033[?25h");
+        return result;
+    }
+}
+
+int chooseFromMenu(const std::vector<std::string>& options, const std::string& header) {
+    if (options.empty()) {
+        return -1;
+    }
+
+    if (useGumBackend()) {
+        try {
+            return chooseWithGum(options, header);
+        }
+        catch (const std::exception& e) {
+            Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED, "Gum selection error: " + std::string(e.what()));
+            Log(LogGrade::WARNING, LogCode::FALLBACK_USED, "Falling back to built-in selector");
+        }
+    }
+    return chooseBuiltin(options, header);
+}
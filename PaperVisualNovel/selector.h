@@ -0,0 +1,22 @@
+﻿// selector.h
+#pragma once
+#ifndef SELECTOR_H
+#define SELECTOR_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief 显示选择菜单并返回选中的序号
+ *
+ * 默认使用内置的选择控件：直接在控制台绘制，方向键移动、回车确认、
+ * 数字键直接选择、输入文字过滤选项，不启动任何外部进程。
+ * data.cfg 中 MenuBackend = gum 且已安装 gum 时改用 gum choose
+ *
+ * @param options 选项文本
+ * @param header 显示在选项上方的标题（可选）
+ * @return 选中项的序号（0-based），按 ESC 取消时返回 -1
+ */
+int chooseFromMenu(const std::vector<std::string>& options, const std::string& header = "");
+
+#endif // SELECTOR_H
@@ -1,50 +1,19 @@
 ﻿// ui.cpp
 #include "ui.h"
-#include <Windows.h>
+#include "platform.h"
 #include <chrono>
+#include <future>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
-#include <conio.h>
 #include <vector>
 #include "fileutils.h"
 #include "gamestate.h"
+#include "logger.h"
+#include "selector.h"
+#include "config.h"
 
 
-extern bool DebugLogEnabled;
-
-/**
- * @brief 检查并清理日志文件
- */
-bool checkAndCleanLogFile(const std::string& logFilePath) {
-    namespace fs = std::filesystem;
-
-    if (!fs::exists(logFilePath)) {
-        return true;
-    }
-
-    try {
-        auto fileSize = fs::file_size(logFilePath);
-        const size_t MAX_LOG_SIZE = 20 * 1024 * 1024;
-
-        if (fileSize > MAX_LOG_SIZE) {
-            std::ofstream outFile(logFilePath, std::ios::trunc);
-            if (!outFile.is_open()) {
-                return false;
-            }
-
-            outFile << "[" << logtimer() << "] INFO [I1000] 日志文件已超过20MB，自动清空" << std::endl;
-            outFile.close();
-
-            std::cout << "日志文件已超过20MB，已自动清空" << std::endl;
-        }
-        return true;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "检查日志文件时出错: " << e.what() << std::endl;
-        return false;
-    }
-}
 
 std::string logGradeToString(LogGrade logGrade) {
     switch (logGrade) {
@@ -107,6 +76,9 @@ const std::map<std::string, LogGrade> logGradeMap = {
 
 // ==================== 控制台颜色输出 ====================
 
+// 文字动画的帧间隔（毫秒）
+constexpr int kFrameMs = 16;
+
 void vnout(const std::string& out, double time, color color,
     bool with_newline, bool use_typewriter_effect) {
     // 设置颜色
@@ -131,30 +103,65 @@ void vnout(const std::string& out, double time, color color,
 
     int total_delay_ms = static_cast<int>(time * 1000);
     if (total_delay_ms <= 0) {
-        std::cout << out;
+        platform().write(out);
         if (with_newline) std::cout << std::endl;
         std::cout << "\033[37m";
         return;
     }
 
-    int char_delay = total_delay_ms / static_cast<int>(out.length());
+    // 按字符（而不是字节）切分，记录每个字符结束的位置和出现的时刻
+    std::vector<std::pair<size_t, int>> glyphs;
+    for (size_t pos = 0; pos < out.length(); pos += consoleCharLength(out, pos)) {
+        glyphs.push_back({ pos + consoleCharLength(out, pos), 0 });
+    }
+
+    int char_delay = total_delay_ms / static_cast<int>(glyphs.size());
     if (char_delay < 10) char_delay = 10;
 
-    for (size_t i = 0; i < out.length(); i++) {
-        std::cout << out[i] << std::flush;
-        if (use_typewriter_effect) {
-            if (out[i] == ',' || out[i] == ';') {
-                Sleep(char_delay * 3);
-            }
-            else if (out[i] == '!' || out[i] == '?') {
-                Sleep(char_delay * 5);
-            }
-            else {
-                Sleep(char_delay);
-            }
+    int due = 0;
+    for (auto& glyph : glyphs) {
+        glyph.second = due;
+        char last = out[glyph.first - 1];
+        if (use_typewriter_effect && (last == ',' || last == ';')) {
+            due += char_delay * 3;
+        }
+        else if (use_typewriter_effect && (last == '!' || last == '?')) {
+            due += char_delay * 5;
         }
         else {
-            Sleep(char_delay);
+            due += char_delay;
+        }
+    }
+
+    // 按固定帧间隔输出：每帧把已到时刻的字符合并为一次写入，按任意键立即显示整行；
+    // 整行输出期间只进入一次按键轮询（终端原始模式）
+    struct KeyPolling {
+        KeyPolling() { platform().beginKeyPolling(); }
+        ~KeyPolling() { platform().endKeyPolling(); }
+    } keyPolling;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t shown = 0;
+    size_t written = 0;
+    while (true) {
+        int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        while (shown < glyphs.size() && glyphs[shown].second <= elapsed) {
+            shown++;
+        }
+
+        size_t end = shown > 0 ? glyphs[shown - 1].first : 0;
+        if (end > written) {
+            platform().write(out.substr(written, end - written));
+            written = end;
+        }
+        if (shown == glyphs.size()) {
+            break;
+        }
+
+        if (!platform().readKeyTimeout(kFrameMs - elapsed % kFrameMs).empty()) {
+            platform().write(out.substr(written));
+            break;
         }
     }
 
@@ -314,72 +321,28 @@ void simpleProgressBar(float progress) {
 // ==================== 获取当前时间字符串 ====================
 
 std::string logtimer() {
+    // 同一秒内复用已格式化的时间字符串
+    thread_local time_t cachedTime = 0;
+    thread_local std::string cachedStr;
+
     time_t now = time(nullptr);
+    if (now == cachedTime && !cachedStr.empty()) {
+        return cachedStr;
+    }
+
     tm tm_struct;
-    localtime_s(&tm_struct, &now);
+    safeLocalTime(now, tm_struct);
     std::stringstream ss;
     ss << std::put_time(&tm_struct, "%Y-%m-%d %H:%M:%S");
-    return '[' + ss.str() + ']';
+    cachedTime = now;
+    cachedStr = '[' + ss.str() + ']';
+    return cachedStr;
 }
 
 // ==================== 获取按键名称 ====================
 
 std::string getKeyName() {
-    int key = _getch();
-
-    if (key == 0 || key == 224) {
-        int extKey = _getch();
-
-        switch (extKey) {
-        case 59: return "F1";
-        case 60: return "F2";
-        case 61: return "F3";
-        case 62: return "F4";
-        case 63: return "F5";
-        case 64: return "F6";
-        case 65: return "F7";
-        case 66: return "F8";
-        case 67: return "F9";
-        case 68: return "F10";
-        case 133: return "F11";
-        case 134: return "F12";
-        case 72: return "UP";
-        case 80: return "DOWN";
-        case 75: return "LEFT";
-        case 77: return "RIGHT";
-        case 71: return "HOME";
-        case 79: return "END";
-        case 73: return "PAGE_UP";
-        case 81: return "PAGE_DOWN";
-        case 82: return "INSERT";
-        case 83: return "DELETE";
-        case 141: return "NUMPAD_/";
-        default: return "UNKNOWN_EXT_" + std::to_string(extKey);
-        }
-    }
-
-    switch (key) {
-    case 8: return "BACKSPACE";
-    case 9: return "TAB";
-    case 13: return "ENTER";
-    case 27: return "ESC";
-    case 32: return "SPACE";
-    case 33: return "PAGE_UP_ALT";
-    case 34: return "PAGE_DOWN_ALT";
-    case 35: return "END_ALT";
-    case 36: return "HOME_ALT";
-    case 37: return "LEFT_ALT";
-    case 38: return "UP_ALT";
-    case 39: return "RIGHT_ALT";
-    case 40: return "DOWN_ALT";
-    case 45: return "INSERT_ALT";
-    case 46: return "DELETE_ALT";
-    default:
-        if (key >= 32 && key <= 126) {
-            return std::string(1, static_cast<char>(key));
-        }
-        return "UNKNOWN_" + std::to_string(key);
-    }
+    return platform().readKey();
 }
 
 // ==================== 计算编辑距离 ====================
@@ -430,36 +393,20 @@ bool isSimilar(const std::string& input, const std::string& target, int maxDista
 // ==================== 日志输出函数（带编号） ====================
 
 void Log(LogGrade logGrade, LogCode code, const std::string& out) {
-    if (logGrade == LogGrade::DEBUG && !DebugLogEnabled) {
+    if (!isLogEnabled(logGrade)) {
         return;
     }
 
-    // 日志文件路径
-    const std::string LOG_FILE_PATH = "pvn_engine.log";
-
-    // 检查并清理日志文件
-    if (!checkAndCleanLogFile(LOG_FILE_PATH)) {
-        std::cerr << "无法清理日志文件，日志写入可能失败" << std::endl;
-    }
-
-    // 格式化日志字符串
-    std::stringstream logStream;
-    logStream << logtimer() << " "
-        << logGradeToString(logGrade) << " "
-        << "[" << logCodeToString(code) << "] "
-        << out;
+    // 格式化日志字符串，写入由后台线程完成
+    std::string logMessage = logtimer();
+    logMessage += ' ';
+    logMessage += logGradeToString(logGrade);
+    logMessage += " [";
+    logMessage += logCodeToString(code);
+    logMessage += "] ";
+    logMessage += out;
 
-    std::string logMessage = logStream.str();
-
-    // 写入到日志文件
-    std::ofstream logFile(LOG_FILE_PATH, std::ios::app);
-    if (!logFile.is_open()) {
-        std::cerr << "无法打开日志文件: " << LOG_FILE_PATH << std::endl;
-        return;
-    }
-
-    logFile << logMessage << std::endl;
-    logFile.close();
+    Logger::instance().write(std::move(logMessage));
 }
 
 // ==================== 操作处理函数 ====================
@@ -467,7 +414,6 @@ void Log(LogGrade logGrade, LogCode code, const std::string& out) {
 int operate() {
     // 外部全局变量声明
     extern CurrentGameInfo g_currentGameInfo;
-    extern bool saveGame(const std::string&, size_t, const GameState&, const std::string&);
     extern void Run();
 
     while (true) {
@@ -476,6 +422,11 @@ int operate() {
             std::cout << std::endl;
             return 0;
         }
+        // 左方向键回到上一句
+        if (op == "LEFT") {
+            std::cout << std::endl;
+            return 4;
+        }
         if (op == "ESC") {
             Log(LogGrade::INFO, LogCode::GAME_START, "Start to print menu");
             cout << std::endl;
@@ -483,45 +434,14 @@ int operate() {
             std::vector<std::string> menu_options = {
                 "1. 继续游戏",
                 "2. 保存并退出",
-                "3. 不保存退出"
+                "3. 不保存退出",
+                "4. 回到上一句"
             };
 
-            std::string selected = "";
-            std::string op2 = "";
-
-            // 检查gum是否可用
-            if (gum::GumWrapper::is_available()) {
-                try {
-                    // 使用gum显示菜单选择
-                    Log(LogGrade::INFO, LogCode::GAME_START, "Using gum for menu selection");
-                    selected = gum::GumWrapper::choose(menu_options);
-
-                    if (!selected.empty()) {
-                        // 提取第一个字符作为选项数字
-                        op2 = selected.substr(0, 1);
-                    }
-                }
-                catch (const std::exception& e) {
-                    Log(LogGrade::ERR, LogCode::PLUGIN_EXEC_FAILED, "Gum selection error: " + std::string(e.what()));
-                    op2 = ""; // 清空，使用回退逻辑
-                }
-            }
-
-            // 如果gum不可用或失败，回退到原始方法
-            if (op2.empty() || !(op2 == "1" || op2 == "2" || op2 == "3")) {
-                Log(LogGrade::WARNING, LogCode::FALLBACK_USED, "Falling back to original menu display");
-                std::cout << std::endl;
-                std::cout << "\033[90m";
-                std::cout << "-----游戏菜单-----" << std::endl;
-                std::cout << "1. 继续游戏" << std::endl;
-                std::cout << "2. 保存并退出" << std::endl;
-                std::cout << "3. 不保存退出" << std::endl;
-                std::cout << "------------------" << std::endl;
-                std::cout << "\033[937m";
-                Log(LogGrade::INFO, LogCode::GAME_START, "End to print menu");
-
-                op2 = getKeyName();
-            }
+            // 按 ESC 取消菜单时继续游戏
+            int selected = chooseFromMenu(menu_options, "-----游戏菜单-----");
+            std::string op2 = selected >= 0 ? std::to_string(selected + 1) : "1";
+            Log(LogGrade::INFO, LogCode::GAME_START, "End to print menu");
 
             Log(LogGrade::INFO, LogCode::GAME_START, "Menu selection: " + op2);
 
@@ -535,17 +455,20 @@ int operate() {
                 Log(LogGrade::INFO, LogCode::GAME_SAVED, "Start to save game");
                 if (g_currentGameInfo.gameState != nullptr &&
                     !g_currentGameInfo.scriptPath.empty()) {
-                    if (saveGame(g_currentGameInfo.scriptPath,
+                    // 退出前等后台写入完成，按实际结果提示
+                    auto saveResult = std::make_shared<std::promise<bool>>();
+                    std::future<bool> saved = saveResult->get_future();
+                    saveGame(g_currentGameInfo.scriptPath,
                         g_currentGameInfo.currentLine,
-                        *g_currentGameInfo.gameState, "autosave")) {
+                        *g_currentGameInfo.gameState, "autosave",
+                        [saveResult](bool ok) { saveResult->set_value(ok); });
+                    if (saved.get()) {
                         Log(LogGrade::INFO, LogCode::GAME_SAVED, "Game saved");
                         std::cout << ANSI_GREEN << "游戏已保存" << "\033[37m" << std::endl;
-                        Sleep(800);
                     }
                     else {
                         Log(LogGrade::ERR, LogCode::FILE_OPEN_FAILED, "Failed to save game");
-                        std::cout << ANSI_RED << "保存失败" << "\033[37m" << std::endl;
-                        Sleep(800);
+                        platform().showMessage("保存失败", "错误", MessageLevel::ERR);
                     }
                 }
                 return 1; // 保存并退出
@@ -554,6 +477,10 @@ int operate() {
                 Log(LogGrade::INFO, LogCode::GAME_START, "Quit game without saving");
                 return 1;
             }
+            else if (op2 == "4") {
+                Log(LogGrade::INFO, LogCode::GAME_START, "Rewind to previous line");
+                return 4;
+            }
             else {
                 // 无效输入，默认继续游戏
                 Log(LogGrade::WARNING, LogCode::COMMAND_UNKNOWN, "Invalid menu selection, default to continue");
@@ -564,7 +491,7 @@ int operate() {
         if (op == "F12") {
             Log(LogGrade::INFO, LogCode::GAME_START, "Enter debug mode");
             std::cout << std::endl;
-            if (readCfg("DevModeEnabled") == "1")
+            if (ConfigStore::instance().getBool("DevModeEnabled"))
             {
                 Log(LogGrade::INFO, LogCode::GAME_START, "Debug mode enabled");
                 std::cout << "\033[90m键入'help'以获取帮助" << std::endl;
@@ -575,8 +502,10 @@ int operate() {
 
                     // 获取用户输入
                     std::string command;
-                    std::getline(std::cin, command);
-                    Log(LogGrade::DEBUG, LogCode::GAME_START, "Debug command: " + command);
+                    if (!platform().readLine(command)) {
+                        break;
+                    }
+                    LOG_DEBUG(LogCode::GAME_START, "Debug command: ", command);
                     if (command == "exit" || command == "quit") {
                         Log(LogGrade::INFO, LogCode::GAME_START, "DEBUG COMMAND: Exit debug mode");
                         std::cout << "退出调试终端" << std::endl;
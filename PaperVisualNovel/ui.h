@@ -4,6 +4,9 @@
 #define UI_H
 
 #include <string>
+#include <string_view>
+#include <sstream>
+#include <type_traits>
 #include "header.h"
 
 /**
@@ -97,14 +100,127 @@ enum class LogCode {
  */
 void Log(LogGrade logGrade, LogCode code, const std::string& out);
 std::string logCodeToString(LogCode code);
+
+// ==================== 延迟格式化日志 ====================
+
+/**
+ * @brief 编译期最低日志等级（0=DEBUG 1=INFO 2=WARNING 3=ERR）
+ *
+ * 低于该等级的 LOG_* 调用在编译期被整体移除；
+ * Release 构建（定义了 NDEBUG）默认移除 DEBUG 日志，可用 -DPVN_MIN_LOG_LEVEL=N 覆盖
+ */
+#ifndef PVN_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define PVN_MIN_LOG_LEVEL 1
+#else
+#define PVN_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+extern bool DebugLogEnabled;
+
+/**
+ * @brief 日志等级的严重程度（与 PVN_MIN_LOG_LEVEL 对应）
+ */
+constexpr int logGradeSeverity(LogGrade logGrade) {
+    switch (logGrade) {
+    case LogGrade::DEBUG: return 0;
+    case LogGrade::INFO: return 1;
+    case LogGrade::WARNING: return 2;
+    case LogGrade::ERR: return 3;
+    }
+    return 0;
+}
+
+/**
+ * @brief 判断某一等级的日志当前是否会被输出
+ */
+inline bool isLogEnabled(LogGrade logGrade) {
+    return logGradeSeverity(logGrade) >= PVN_MIN_LOG_LEVEL &&
+        (logGrade != LogGrade::DEBUG || DebugLogEnabled);
+}
+
+namespace logdetail {
+    template<typename T>
+    void append(std::string& out, const T& value) {
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            out += std::string_view(value);
+        }
+        else if constexpr (std::is_same_v<T, char>) {
+            out += value;
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            out += value ? '1' : '0';
+        }
+        else if constexpr (std::is_arithmetic_v<T>) {
+            out += std::to_string(value);
+        }
+        else {
+            std::ostringstream ss;
+            ss << value;
+            out += ss.str();
+        }
+    }
+}
+
+/**
+ * @brief 将多个参数依次拼接为日志内容（数值按 std::to_string 格式化）
+ */
+template<typename... Args>
+std::string logFormat(const Args&... args) {
+    std::string out;
+    (logdetail::append(out, args), ...);
+    return out;
+}
+
+/**
+ * @brief 延迟格式化的日志宏
+ *
+ * 参数只有在该等级启用时才会被求值和拼接，未启用时只有一次判断
+ */
+#define PVN_LOG(grade, code, ...) \
+    do { \
+        if (isLogEnabled(grade)) { \
+            Log(grade, code, logFormat(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+/**
+ * @brief 被编译期等级移除的日志：参数仍参与类型检查，但不会生成任何代码
+ */
+#define PVN_LOG_DISCARD(grade, code, ...) \
+    do { \
+        if (false) { \
+            Log(grade, code, logFormat(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+#if PVN_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(code, ...) PVN_LOG(LogGrade::DEBUG, code, __VA_ARGS__)
+#else
+#define LOG_DEBUG(code, ...) PVN_LOG_DISCARD(LogGrade::DEBUG, code, __VA_ARGS__)
+#endif
+
+#if PVN_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(code, ...) PVN_LOG(LogGrade::INFO, code, __VA_ARGS__)
+#else
+#define LOG_INFO(code, ...) PVN_LOG_DISCARD(LogGrade::INFO, code, __VA_ARGS__)
+#endif
+
+#if PVN_MIN_LOG_LEVEL <= 2
+#define LOG_WARN(code, ...) PVN_LOG(LogGrade::WARNING, code, __VA_ARGS__)
+#else
+#define LOG_WARN(code, ...) PVN_LOG_DISCARD(LogGrade::WARNING, code, __VA_ARGS__)
+#endif
+
+#define LOG_ERR(code, ...) PVN_LOG(LogGrade::ERR, code, __VA_ARGS__)
+
 /**
  * @brief 性能评估日志（便捷宏）
  */
 #define LOG_PERF(operation, result, time_ms, memory_kb) \
-    Log(LogGrade::DEBUG, LogCode::PERFORMANCE, \
-        operation + " " + result + " (took " + \
-        std::to_string(static_cast<int>(time_ms)) + "ms " + \
-        std::to_string(static_cast<int>(memory_kb)) + "KB)")
+    LOG_DEBUG(LogCode::PERFORMANCE, operation, " ", result, " (took ", \
+        static_cast<int>(time_ms), "ms ", static_cast<int>(memory_kb), "KB)")
 
  /**
   * @brief 格式化错误输出（带位置指示）